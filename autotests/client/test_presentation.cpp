@@ -0,0 +1,339 @@
+/********************************************************************
+Copyright 2020  agent <agent@local>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) version 3, or any
+later version accepted by the membership of KDE e.V. (or its
+successor approved by the membership of KDE e.V.), which shall
+act as a proxy defined in Section 6 of version 3 of the license.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+// Qt
+#include <QtTest>
+// KWin
+#include "../../src/client/compositor.h"
+#include "../../src/client/connection_thread.h"
+#include "../../src/client/event_queue.h"
+#include "../../src/client/output.h"
+#include "../../src/client/presentation.h"
+#include "../../src/client/registry.h"
+#include "../../src/client/surface.h"
+#include "../../src/server/display.h"
+#include "../../src/server/compositor_interface.h"
+#include "../../src/server/output_interface.h"
+#include "../../src/server/presentation_interface.h"
+#include "../../src/server/surface_interface.h"
+
+/**
+ * A clock the test advances manually, used to generate reproducible presentation timestamps.
+ **/
+class FakeClock
+{
+public:
+    std::chrono::nanoseconds now() const {
+        return m_now;
+    }
+    std::chrono::nanoseconds advance(std::chrono::nanoseconds duration) {
+        m_now += duration;
+        return m_now;
+    }
+
+private:
+    // beyond 32 bit seconds to cover the split into the hi and lo parts
+    std::chrono::nanoseconds m_now = std::chrono::seconds(0x100000005ll) + std::chrono::nanoseconds(123);
+};
+
+class TestPresentation : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TestPresentation(QObject *parent = nullptr);
+private Q_SLOTS:
+    void init();
+    void cleanup();
+
+    void testClockId();
+    void testPresented();
+    void testDiscardedByCommit();
+    void testPresentationDiscarded();
+    void testDestroySurface();
+
+private:
+    KWayland::Server::SurfaceInterface *createSurface(QScopedPointer<KWayland::Client::Surface> &surface);
+
+    KWayland::Server::Display *m_display = nullptr;
+    KWayland::Server::CompositorInterface *m_compositorInterface = nullptr;
+    KWayland::Server::OutputInterface *m_outputInterface = nullptr;
+    KWayland::Server::PresentationInterface *m_presentationInterface = nullptr;
+
+    KWayland::Client::ConnectionThread *m_connection = nullptr;
+    KWayland::Client::Compositor *m_compositor = nullptr;
+    KWayland::Client::Output *m_output = nullptr;
+    KWayland::Client::Presentation *m_presentation = nullptr;
+    KWayland::Client::EventQueue *m_queue = nullptr;
+    QThread *m_thread = nullptr;
+    KWayland::Client::Registry *m_registry = nullptr;
+    FakeClock m_clock;
+};
+
+static const QString s_socketName = QStringLiteral("kwayland-test-presentation-0");
+
+TestPresentation::TestPresentation(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void TestPresentation::init()
+{
+    using namespace KWayland::Server;
+    using namespace KWayland::Client;
+
+    delete m_display;
+    m_display = new Display(this);
+    m_display->setSocketName(s_socketName);
+    m_display->start();
+    QVERIFY(m_display->isRunning());
+
+    m_compositorInterface = m_display->createCompositor(m_display);
+    m_compositorInterface->create();
+    QVERIFY(m_compositorInterface->isValid());
+    m_outputInterface = m_display->createOutput(m_display);
+    m_outputInterface->create();
+    QVERIFY(m_outputInterface->isValid());
+    m_presentationInterface = m_display->createPresentation(m_display);
+    QCOMPARE(m_presentationInterface->clockId(), CLOCK_MONOTONIC);
+    m_presentationInterface->setClockId(CLOCK_REALTIME);
+    QCOMPARE(m_presentationInterface->clockId(), CLOCK_REALTIME);
+    m_presentationInterface->create();
+    QVERIFY(m_presentationInterface->isValid());
+
+    // setup connection
+    m_connection = new KWayland::Client::ConnectionThread;
+    QSignalSpy connectedSpy(m_connection, &ConnectionThread::connected);
+    QVERIFY(connectedSpy.isValid());
+    m_connection->setSocketName(s_socketName);
+
+    m_thread = new QThread(this);
+    m_connection->moveToThread(m_thread);
+    m_thread->start();
+
+    m_connection->initConnection();
+    QVERIFY(connectedSpy.wait());
+
+    m_queue = new EventQueue(this);
+    m_queue->setup(m_connection);
+    QVERIFY(m_queue->isValid());
+
+    m_registry = new Registry();
+    QSignalSpy interfacesAnnouncedSpy(m_registry, &Registry::interfacesAnnounced);
+    QVERIFY(interfacesAnnouncedSpy.isValid());
+    m_registry->setEventQueue(m_queue);
+    m_registry->create(m_connection);
+    QVERIFY(m_registry->isValid());
+    m_registry->setup();
+    QVERIFY(interfacesAnnouncedSpy.wait());
+
+    const auto compositor = m_registry->interface(Registry::Interface::Compositor);
+    m_compositor = m_registry->createCompositor(compositor.name, compositor.version, this);
+    QVERIFY(m_compositor->isValid());
+
+    const auto output = m_registry->interface(Registry::Interface::Output);
+    m_output = m_registry->createOutput(output.name, output.version, this);
+    QVERIFY(m_output->isValid());
+    // the server sends done once it bound the output
+    QSignalSpy outputChangedSpy(m_output, &Output::changed);
+    QVERIFY(outputChangedSpy.isValid());
+    QVERIFY(outputChangedSpy.wait());
+
+    const auto presentation = m_registry->interface(Registry::Interface::Presentation);
+    QVERIFY(presentation.name != 0);
+    m_presentation = m_registry->createPresentation(presentation.name, presentation.version, this);
+    QVERIFY(m_presentation->isValid());
+    QSignalSpy clockIdChangedSpy(m_presentation, &Presentation::clockIdChanged);
+    QVERIFY(clockIdChangedSpy.isValid());
+    QVERIFY(clockIdChangedSpy.wait());
+}
+
+void TestPresentation::cleanup()
+{
+#define CLEANUP(variable) \
+    if (variable) { \
+        delete variable; \
+        variable = nullptr; \
+    }
+    CLEANUP(m_presentation)
+    CLEANUP(m_output)
+    CLEANUP(m_compositor)
+    CLEANUP(m_queue)
+    CLEANUP(m_registry)
+    if (m_thread) {
+        m_thread->quit();
+        m_thread->wait();
+        delete m_thread;
+        m_thread = nullptr;
+    }
+    CLEANUP(m_connection)
+    CLEANUP(m_display)
+#undef CLEANUP
+    // these are the children of the display
+    m_compositorInterface = nullptr;
+    m_outputInterface = nullptr;
+    m_presentationInterface = nullptr;
+}
+
+KWayland::Server::SurfaceInterface *TestPresentation::createSurface(QScopedPointer<KWayland::Client::Surface> &surface)
+{
+    using namespace KWayland::Server;
+    QSignalSpy surfaceCreatedSpy(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    if (!surfaceCreatedSpy.isValid()) {
+        return nullptr;
+    }
+    surface.reset(m_compositor->createSurface());
+    if (!surfaceCreatedSpy.wait()) {
+        return nullptr;
+    }
+    return surfaceCreatedSpy.first().first().value<SurfaceInterface*>();
+}
+
+void TestPresentation::testClockId()
+{
+    // the clock got announced in init
+    QCOMPARE(m_presentation->clockId(), CLOCK_REALTIME);
+}
+
+void TestPresentation::testPresented()
+{
+    using namespace KWayland::Client;
+    using namespace KWayland::Server;
+    QScopedPointer<Surface> surface;
+    SurfaceInterface *serverSurface = createSurface(surface);
+    QVERIFY(serverSurface);
+    QSignalSpy committedSpy(serverSurface, &SurfaceInterface::committed);
+    QVERIFY(committedSpy.isValid());
+
+    QScopedPointer<PresentationFeedback> feedback(m_presentation->createFeedback(surface.data()));
+    QVERIFY(feedback->isValid());
+    QSignalSpy presentedSpy(feedback.data(), &PresentationFeedback::presented);
+    QVERIFY(presentedSpy.isValid());
+    surface->commit(Surface::CommitFlag::None);
+    QVERIFY(committedSpy.wait());
+
+    const auto timestamp = m_clock.advance(std::chrono::milliseconds(16));
+    serverSurface->presented(m_outputInterface, timestamp, std::chrono::nanoseconds(16666667), 0x100000002ull,
+                             PresentationInterface::Kind::Vsync | PresentationInterface::Kind::HwClock);
+    QVERIFY(presentedSpy.wait());
+    QVERIFY(feedback->isPresented());
+    QVERIFY(!feedback->isDiscarded());
+    QVERIFY(!feedback->isValid());
+    QCOMPARE(feedback->timestamp(), timestamp);
+    QCOMPARE(feedback->refresh(), std::chrono::nanoseconds(16666667));
+    QCOMPARE(feedback->sequence(), 0x100000002ull);
+    QCOMPARE(feedback->kinds(), PresentationFeedback::Kind::Vsync | PresentationFeedback::Kind::HwClock);
+    QCOMPARE(feedback->syncOutputs(), QVector<Output*>{m_output});
+
+    // the feedback is only reported once
+    QScopedPointer<PresentationFeedback> feedback2(m_presentation->createFeedback(surface.data()));
+    QSignalSpy presented2Spy(feedback2.data(), &PresentationFeedback::presented);
+    QVERIFY(presented2Spy.isValid());
+    surface->commit(Surface::CommitFlag::None);
+    QVERIFY(committedSpy.wait());
+    serverSurface->presented(nullptr, m_clock.advance(std::chrono::milliseconds(16)), std::chrono::nanoseconds(0), 0, PresentationInterface::Kinds());
+    QVERIFY(presented2Spy.wait());
+    QCOMPARE(presentedSpy.count(), 1);
+    QCOMPARE(feedback2->timestamp(), m_clock.now());
+    QCOMPARE(feedback2->refresh(), std::chrono::nanoseconds(0));
+    QCOMPARE(feedback2->kinds(), PresentationFeedback::Kinds());
+    QVERIFY(feedback2->syncOutputs().isEmpty());
+}
+
+void TestPresentation::testDiscardedByCommit()
+{
+    // a commit replacing the content before it got presented discards the feedback
+    using namespace KWayland::Client;
+    using namespace KWayland::Server;
+    QScopedPointer<Surface> surface;
+    SurfaceInterface *serverSurface = createSurface(surface);
+    QVERIFY(serverSurface);
+    QSignalSpy committedSpy(serverSurface, &SurfaceInterface::committed);
+    QVERIFY(committedSpy.isValid());
+
+    QScopedPointer<PresentationFeedback> feedback(m_presentation->createFeedback(surface.data()));
+    QSignalSpy discardedSpy(feedback.data(), &PresentationFeedback::discarded);
+    QVERIFY(discardedSpy.isValid());
+    surface->commit(Surface::CommitFlag::None);
+    QVERIFY(committedSpy.wait());
+
+    QScopedPointer<PresentationFeedback> feedback2(m_presentation->createFeedback(surface.data()));
+    QSignalSpy presentedSpy(feedback2.data(), &PresentationFeedback::presented);
+    QVERIFY(presentedSpy.isValid());
+    surface->commit(Surface::CommitFlag::None);
+    QVERIFY(discardedSpy.wait());
+    QVERIFY(feedback->isDiscarded());
+    QVERIFY(!feedback->isPresented());
+    QVERIFY(!feedback->isValid());
+
+    serverSurface->presented(m_outputInterface, m_clock.advance(std::chrono::milliseconds(8)), std::chrono::nanoseconds(8333333), 1, PresentationInterface::Kind::Vsync);
+    QVERIFY(presentedSpy.wait());
+    QVERIFY(feedback2->isPresented());
+    QCOMPARE(feedback2->timestamp(), m_clock.now());
+    QCOMPARE(feedback2->sequence(), 1ull);
+}
+
+void TestPresentation::testPresentationDiscarded()
+{
+    using namespace KWayland::Client;
+    using namespace KWayland::Server;
+    QScopedPointer<Surface> surface;
+    SurfaceInterface *serverSurface = createSurface(surface);
+    QVERIFY(serverSurface);
+    QSignalSpy committedSpy(serverSurface, &SurfaceInterface::committed);
+    QVERIFY(committedSpy.isValid());
+
+    QScopedPointer<PresentationFeedback> feedback(m_presentation->createFeedback(surface.data()));
+    QSignalSpy discardedSpy(feedback.data(), &PresentationFeedback::discarded);
+    QVERIFY(discardedSpy.isValid());
+    // feedback of uncommitted content is not affected
+    serverSurface->presentationDiscarded();
+    surface->commit(Surface::CommitFlag::None);
+    QVERIFY(committedSpy.wait());
+    QVERIFY(feedback->isValid());
+
+    serverSurface->presentationDiscarded();
+    QVERIFY(discardedSpy.wait());
+    QVERIFY(feedback->isDiscarded());
+    QVERIFY(!feedback->isValid());
+}
+
+void TestPresentation::testDestroySurface()
+{
+    // destroying the surface discards the pending feedback
+    using namespace KWayland::Client;
+    using namespace KWayland::Server;
+    QScopedPointer<Surface> surface;
+    SurfaceInterface *serverSurface = createSurface(surface);
+    QVERIFY(serverSurface);
+    QSignalSpy committedSpy(serverSurface, &SurfaceInterface::committed);
+    QVERIFY(committedSpy.isValid());
+
+    QScopedPointer<PresentationFeedback> feedback(m_presentation->createFeedback(surface.data()));
+    QSignalSpy discardedSpy(feedback.data(), &PresentationFeedback::discarded);
+    QVERIFY(discardedSpy.isValid());
+    surface->commit(Surface::CommitFlag::None);
+    QVERIFY(committedSpy.wait());
+
+    surface.reset();
+    QVERIFY(discardedSpy.wait());
+    QVERIFY(feedback->isDiscarded());
+}
+
+QTEST_GUILESS_MAIN(TestPresentation)
+#include "test_presentation.moc"
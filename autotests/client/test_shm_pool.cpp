@@ -46,7 +46,10 @@ private Q_SLOTS:
     void testCreateBufferFromImage();
     void testCreateBufferFromImageWithAlpha();
     void testCreateBufferFromData();
+    void testCopyRegion();
     void testReuseBuffer();
+    void testReclaimStaleBuffers();
+    void testHugePagesResize();
     void testDestroy();
 
 private:
@@ -191,6 +194,30 @@ void TestShmPool::testCreateBufferFromData()
     QCOMPARE(img2, img);
 }
 
+void TestShmPool::testCopyRegion()
+{
+    // only the pixels inside the region get copied and premultiplied
+    QVERIFY(m_shmPool->isValid());
+    QImage img(24, 24, QImage::Format_ARGB32_Premultiplied);
+    img.fill(Qt::black);
+    auto buffer = m_shmPool->createBuffer(img).toStrongRef();
+    QVERIFY(buffer);
+
+    QImage update(24, 24, QImage::Format_ARGB32);
+    update.fill(QColor(255, 0, 0, 100));
+    const QRegion region = QRegion(2, 3, 10, 5) + QRegion(15, 10, 20, 20);
+    buffer->copy(update, region);
+
+    const QImage premultiplied = update.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    const QImage img2(buffer->address(), img.width(), img.height(), QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < img2.height(); ++y) {
+        for (int x = 0; x < img2.width(); ++x) {
+            const QRgb expected = region.contains(QPoint(x, y)) ? premultiplied.pixel(x, y) : img.pixel(x, y);
+            QCOMPARE(img2.pixel(x, y), expected);
+        }
+    }
+}
+
 void TestShmPool::testReuseBuffer()
 {
     QVERIFY(m_shmPool->isValid());
@@ -222,6 +249,96 @@ void TestShmPool::testReuseBuffer()
     QVERIFY(buffer4 != buffer3);
 }
 
+void TestShmPool::testHugePagesResize()
+{
+    // the contents of the existing Buffers survive growing a pool using huge pages
+    using namespace KWayland::Client;
+    Registry registry;
+    QSignalSpy shmSpy(&registry, &Registry::shmAnnounced);
+    QVERIFY(shmSpy.isValid());
+    registry.create(m_connection->display());
+    QVERIFY(registry.isValid());
+    registry.setup();
+    QVERIFY(shmSpy.wait());
+
+    ShmPool pool;
+    pool.setHugePagesEnabled(true);
+    QVERIFY(pool.isHugePagesEnabled());
+    pool.setup(registry.bindShm(shmSpy.first().first().value<quint32>(), shmSpy.first().last().value<quint32>()));
+    QVERIFY(pool.isValid());
+    QSignalSpy resizedSpy(&pool, &ShmPool::poolResized);
+    QVERIFY(resizedSpy.isValid());
+
+    // one MiB per Buffer, the pool starts with at most one huge page and at least doubles
+    QVector<QImage> images;
+    QVector<QSharedPointer<Buffer>> buffers;
+    for (int i = 0; resizedSpy.count() < 3; ++i) {
+        QVERIFY(i < 64);
+        QImage image(512, 512, QImage::Format_ARGB32_Premultiplied);
+        for (int y = 0; y < image.height(); ++y) {
+            QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+            for (int x = 0; x < image.width(); ++x) {
+                line[x] = qRgba(x & 0xff, y & 0xff, i & 0xff, 0xff);
+            }
+        }
+        auto buffer = pool.createBuffer(image).toStrongRef();
+        QVERIFY(buffer);
+        images << image;
+        buffers << buffer;
+    }
+
+    for (int i = 0; i < buffers.count(); ++i) {
+        const QSharedPointer<Buffer> &buffer = buffers.at(i);
+        const QImage contents(buffer->address(), buffer->size().width(), buffer->size().height(),
+                              buffer->stride(), QImage::Format_ARGB32_Premultiplied);
+        QCOMPARE(contents, images.at(i));
+    }
+}
+
+void TestShmPool::testReclaimStaleBuffers()
+{
+    QVERIFY(m_shmPool->isValid());
+    QVERIFY(!m_shmPool->isReclaimStaleBuffersEnabled());
+    m_shmPool->setReclaimStaleBuffersEnabled(true);
+    QVERIFY(m_shmPool->isReclaimStaleBuffersEnabled());
+
+    // simulate an interactive resize, every frame needs a Buffer of a new size
+    auto first = m_shmPool->getBuffer(QSize(10, 10), 40);
+    QVERIFY(first);
+    first.toStrongRef()->setReleased(true);
+    int32_t poolSize = 0;
+    for (int i = 1; i < 300; ++i) {
+        if (i == 100) {
+            poolSize = m_shmPool->poolSize();
+        }
+        const QSize size(10 + i % 100, 10 + i % 100);
+        const int32_t stride = size.width() * 4;
+        auto buffer = m_shmPool->getBuffer(size, stride).toStrongRef();
+        QVERIFY(buffer);
+        QCOMPARE(buffer->size(), size);
+        // the server released the buffer
+        buffer->setReleased(true);
+    }
+    // the first Buffer got destroyed to reuse its memory
+    QVERIFY(!first);
+    // only the recently requested Buffers are kept, so the pool does not grow anymore
+    QCOMPARE(m_shmPool->poolSize(), poolSize);
+
+    // Buffers in use are not reclaimed
+    auto used = m_shmPool->getBuffer(QSize(10, 10), 40).toStrongRef();
+    QVERIFY(used);
+    used->setUsed(true);
+    used->setReleased(true);
+    QWeakPointer<KWayland::Client::Buffer> usedPtr = used;
+    used.clear();
+    for (int i = 1; i < 20; ++i) {
+        auto buffer = m_shmPool->getBuffer(QSize(20 + i, 20), 80 + i * 4).toStrongRef();
+        QVERIFY(buffer);
+        buffer->setReleased(true);
+    }
+    QVERIFY(usedPtr);
+}
+
 void TestShmPool::testDestroy()
 {
     using namespace KWayland::Client;
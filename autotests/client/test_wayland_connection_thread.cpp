@@ -46,6 +46,8 @@ private Q_SLOTS:
     void testConnectionThread();
     void testConnectFd();
     void testConnectFdNoSocketName();
+    void testReaderThread();
+    void testDirectDispatch();
 
 private:
     KWayland::Server::Display *m_display;
@@ -53,6 +55,30 @@ private:
 
 static const QString s_socketName = QStringLiteral("kwin-test-wayland-connection-0");
 
+/**
+ * Performs a blocking roundtrip on its own event queue.
+ **/
+class RoundtripThread : public QThread
+{
+public:
+    RoundtripThread(wl_display *display, wl_event_queue *queue)
+        : m_display(display)
+        , m_queue(queue)
+    {
+    }
+
+    int result = 0;
+
+protected:
+    void run() override {
+        result = wl_display_roundtrip_queue(m_display, m_queue);
+    }
+
+private:
+    wl_display *m_display;
+    wl_event_queue *m_queue;
+};
+
 TestWaylandConnectionThread::TestWaylandConnectionThread(QObject *parent)
     : QObject(parent)
     , m_display(nullptr)
@@ -297,5 +323,112 @@ void TestWaylandConnectionThread::testConnectFdNoSocketName()
     delete connectionThread;
 }
 
+void TestWaylandConnectionThread::testReaderThread()
+{
+    using namespace KWayland::Client;
+    QScopedPointer<ConnectionThread> connection(new ConnectionThread);
+    QVERIFY(!connection->isReaderThreadEnabled());
+    connection->setReaderThreadEnabled(true);
+    QVERIFY(connection->isReaderThreadEnabled());
+    connection->setSocketName(s_socketName);
+    QSignalSpy connectedSpy(connection.data(), &ConnectionThread::connected);
+    QVERIFY(connectedSpy.isValid());
+    connection->initConnection();
+    QVERIFY(connectedSpy.wait());
+
+    // one Registry on an EventQueue, which gets woken up by the reader thread,
+    // one on the default queue, which gets dispatched by the ConnectionThread
+    QScopedPointer<EventQueue> queue(new EventQueue);
+    queue->setup(connection.data());
+    QScopedPointer<Registry> queuedRegistry(new Registry);
+    QSignalSpy queuedAnnouncedSpy(queuedRegistry.data(), &Registry::interfacesAnnounced);
+    QVERIFY(queuedAnnouncedSpy.isValid());
+    queuedRegistry->create(connection.data());
+    queuedRegistry->setEventQueue(queue.data());
+    queuedRegistry->setup();
+
+    Registry registry;
+    QSignalSpy announcedSpy(&registry, &Registry::interfacesAnnounced);
+    QVERIFY(announcedSpy.isValid());
+    registry.create(connection.data());
+    registry.setup();
+
+    QVERIFY(announcedSpy.wait());
+    if (queuedAnnouncedSpy.isEmpty()) {
+        QVERIFY(queuedAnnouncedSpy.wait());
+    }
+    QCOMPARE(announcedSpy.count(), 1);
+    QCOMPARE(queuedAnnouncedSpy.count(), 1);
+
+    // a blocking roundtrip takes part in the read protocol of the reader thread, it has to run
+    // on another thread as the server needs the event loop of this thread to answer
+    wl_event_queue *roundtripQueue = wl_display_create_queue(connection->display());
+    RoundtripThread roundtripThread(connection->display(), roundtripQueue);
+    roundtripThread.start();
+    QTRY_VERIFY(roundtripThread.isFinished());
+    QVERIFY(roundtripThread.result >= 0);
+    wl_event_queue_destroy(roundtripQueue);
+
+    queuedRegistry.reset();
+    registry.release();
+    queue.reset();
+    connection.reset();
+}
+
+void TestWaylandConnectionThread::testDirectDispatch()
+{
+    using namespace KWayland::Client;
+    QScopedPointer<ConnectionThread> connection(new ConnectionThread);
+    connection->setSocketName(s_socketName);
+    QSignalSpy connectedSpy(connection.data(), &ConnectionThread::connected);
+    QVERIFY(connectedSpy.isValid());
+    connection->initConnection();
+    QVERIFY(connectedSpy.wait());
+
+    QScopedPointer<EventQueue> queue(new EventQueue);
+    QVERIFY(!queue->isDirectDispatchEnabled());
+    queue->setDirectDispatchEnabled(true);
+    QVERIFY(queue->isDirectDispatchEnabled());
+    queue->setup(connection.data());
+    QCOMPARE(queue->dispatchCount(), 0ull);
+    QCOMPARE(queue->dispatchedEventCount(), 0ull);
+    QCOMPARE(queue->dispatchTime(), std::chrono::nanoseconds::zero());
+
+    // connected after the queue, so the queue got dispatched by the time this gets called
+    quint64 dispatchedWhileEmitting = 0;
+    connect(connection.data(), &ConnectionThread::eventsRead, this,
+        [&queue, &dispatchedWhileEmitting] {
+            dispatchedWhileEmitting = queue->dispatchedEventCount();
+        }
+    );
+
+    Registry registry;
+    QSignalSpy announcedSpy(&registry, &Registry::interfacesAnnounced);
+    QVERIFY(announcedSpy.isValid());
+    registry.create(connection.data());
+    registry.setEventQueue(queue.data());
+    registry.setup();
+    QVERIFY(announcedSpy.wait());
+
+    QVERIFY(queue->dispatchCount() > 0);
+    QVERIFY(queue->dispatchedEventCount() > 0);
+    QVERIFY(dispatchedWhileEmitting > 0);
+    QVERIFY(queue->dispatchTime() > std::chrono::nanoseconds::zero());
+
+    queue->resetStatistics();
+    QCOMPARE(queue->dispatchCount(), 0ull);
+    QCOMPARE(queue->dispatchedEventCount(), 0ull);
+    QCOMPARE(queue->dispatchTime(), std::chrono::nanoseconds::zero());
+
+    // nothing to dispatch
+    queue->dispatch();
+    QCOMPARE(queue->dispatchCount(), 1ull);
+    QCOMPARE(queue->dispatchedEventCount(), 0ull);
+
+    registry.release();
+    queue.reset();
+    connection.reset();
+}
+
 QTEST_GUILESS_MAIN(TestWaylandConnectionThread)
 #include "test_wayland_connection_thread.moc"
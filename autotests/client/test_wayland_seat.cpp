@@ -79,6 +79,7 @@ private Q_SLOTS:
     void testPointerPinchGesture_data();
     void testPointerPinchGesture();
     void testPointerAxis();
+    void testPointerCoalescing();
     void testKeyboardSubSurfaceTreeFromPointer();
     void testCursor();
     void testCursorDamage();
@@ -1249,6 +1250,105 @@ void TestWaylandSeat::testPointerAxis()
     QCOMPARE(axisStoppedSpy.count(), 1);
 }
 
+void TestWaylandSeat::testPointerCoalescing()
+{
+    using namespace KWayland::Client;
+    using namespace KWayland::Server;
+
+    // first create the pointer
+    QSignalSpy hasPointerChangedSpy(m_seat, &Seat::hasPointerChanged);
+    QVERIFY(hasPointerChangedSpy.isValid());
+    m_seatInterface->setHasPointer(true);
+    QVERIFY(hasPointerChangedSpy.wait());
+    QScopedPointer<Pointer> pointer(m_seat->createPointer());
+    QVERIFY(pointer);
+
+    // now create a surface
+    QSignalSpy surfaceCreatedSpy(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(surfaceCreatedSpy.isValid());
+    QScopedPointer<Surface> surface(m_compositor->createSurface());
+    QVERIFY(surfaceCreatedSpy.wait());
+    auto serverSurface = surfaceCreatedSpy.first().first().value<SurfaceInterface*>();
+    QVERIFY(serverSurface);
+    m_seatInterface->setFocusedPointerSurface(serverSurface);
+    QVERIFY(m_seatInterface->focusedPointer());
+    QSignalSpy frameSpy(pointer.data(), &Pointer::frame);
+    QVERIFY(frameSpy.isValid());
+    QVERIFY(frameSpy.wait());
+    QCOMPARE(frameSpy.count(), 1);
+
+    QVERIFY(!m_seatInterface->isPointerCoalescingEnabled());
+    m_seatInterface->setPointerCoalescingEnabled(true);
+    QVERIFY(m_seatInterface->isPointerCoalescingEnabled());
+    QCOMPARE(m_seatInterface->pointerCoalescingInterval(), 0);
+    QCOMPARE(m_seatInterface->coalescedPointerEvents(), 0ull);
+
+    QSignalSpy motionSpy(pointer.data(), &Pointer::motion);
+    QVERIFY(motionSpy.isValid());
+    QSignalSpy axisSpy(pointer.data(), &Pointer::axisChanged);
+    QVERIFY(axisSpy.isValid());
+    QSignalSpy buttonSpy(pointer.data(), &Pointer::buttonStateChanged);
+    QVERIFY(buttonSpy.isValid());
+
+    // the motion events are merged into the last position
+    m_seatInterface->setTimestamp(1);
+    m_seatInterface->setPointerPos(QPointF(10, 10));
+    m_seatInterface->setTimestamp(2);
+    m_seatInterface->setPointerPos(QPointF(20, 15));
+    m_seatInterface->setTimestamp(3);
+    m_seatInterface->setPointerPos(QPointF(30, 20));
+    QCOMPARE(m_seatInterface->pointerPos(), QPointF(30, 20));
+    QCOMPARE(m_seatInterface->coalescedPointerEvents(), 2ull);
+    QVERIFY(!frameSpy.wait(100));
+    m_seatInterface->flushPointerEvents();
+    QVERIFY(frameSpy.wait());
+    QCOMPARE(frameSpy.count(), 2);
+    QCOMPARE(motionSpy.count(), 1);
+    QCOMPARE(motionSpy.first().at(0).toPointF(), QPointF(30, 20));
+    QCOMPARE(motionSpy.first().at(1).value<quint32>(), quint32(3));
+
+    // axis events are summed up, a button event flushes them first
+    int axisEventsBeforeButton = -1;
+    connect(pointer.data(), &Pointer::buttonStateChanged, this,
+        [&axisEventsBeforeButton, &axisSpy] {
+            axisEventsBeforeButton = axisSpy.count();
+        }
+    );
+    m_seatInterface->setTimestamp(4);
+    m_seatInterface->pointerAxisV5(Qt::Vertical, 10, 1, PointerAxisSource::Wheel);
+    m_seatInterface->pointerAxisV5(Qt::Vertical, 5, 1, PointerAxisSource::Wheel);
+    QCOMPARE(m_seatInterface->coalescedPointerEvents(), 3ull);
+    m_seatInterface->pointerButtonPressed(Qt::LeftButton);
+    QVERIFY(buttonSpy.wait());
+    QCOMPARE(axisEventsBeforeButton, 1);
+    QCOMPARE(axisSpy.count(), 1);
+    QCOMPARE(axisSpy.first().at(1).value<Pointer::Axis>(), Pointer::Axis::Vertical);
+    QCOMPARE(axisSpy.first().at(2).value<qreal>(), 15.0);
+    QTRY_COMPARE(frameSpy.count(), 4);
+
+    // with an interval the events get flushed without the compositor
+    m_seatInterface->setPointerCoalescingInterval(10);
+    QCOMPARE(m_seatInterface->pointerCoalescingInterval(), 10);
+    m_seatInterface->setPointerPos(QPointF(40, 25));
+    QVERIFY(motionSpy.wait());
+    QCOMPARE(motionSpy.count(), 2);
+    QCOMPARE(motionSpy.last().at(0).toPointF(), QPointF(40, 25));
+
+    // disabling the coalescing flushes the pending events
+    m_seatInterface->setPointerCoalescingInterval(0);
+    m_seatInterface->setPointerPos(QPointF(50, 30));
+    m_seatInterface->setPointerCoalescingEnabled(false);
+    QVERIFY(motionSpy.wait());
+    QCOMPARE(motionSpy.count(), 3);
+    QCOMPARE(motionSpy.last().at(0).toPointF(), QPointF(50, 30));
+
+    // and events are sent right away again
+    m_seatInterface->setPointerPos(QPointF(60, 35));
+    QVERIFY(motionSpy.wait());
+    QCOMPARE(motionSpy.count(), 4);
+    QCOMPARE(m_seatInterface->coalescedPointerEvents(), 3ull);
+}
+
 void TestWaylandSeat::testKeyboardSubSurfaceTreeFromPointer()
 {
     // this test verifies that when clicking on a sub-surface the keyboard focus passes to it
@@ -61,6 +61,8 @@ private Q_SLOTS:
     void testSurfaceAt();
     void testDestroyAttachedBuffer();
     void testDestroyParentSurface();
+    void testDamageHistory();
+    void testDamageHistoryDestroySurface();
 
 private:
     KWayland::Server::Display *m_display;
@@ -1026,6 +1028,27 @@ void TestSubSurface::testSurfaceAt()
     // outside the geometries should be no surface
     QVERIFY(!parentServerSurface->surfaceAt(QPointF(-1, -1)));
     QVERIFY(!parentServerSurface->surfaceAt(QPointF(101, 101)));
+    QVERIFY(!parentServerSurface->inputSurfaceAt(QPointF(-1, -1)));
+    QVERIFY(!parentServerSurface->inputSurfaceAt(QPointF(101, 101)));
+
+    // moving a grand child has to update the input shapes
+    QSignalSpy positionChangedSpy(childFor2ServerSurface->subSurface().data(), &SubSurfaceInterface::positionChanged);
+    QVERIFY(positionChangedSpy.isValid());
+    childFor2SubSurface->setPosition(QPoint(0, 50));
+    QVERIFY(positionChangedSpy.wait());
+    QCOMPARE(parentServerSurface->inputSurfaceAt(QPointF(0, 50)), childFor2ServerSurface);
+    QCOMPARE(parentServerSurface->inputSurfaceAt(QPointF(25, 75)), childFor2ServerSurface);
+    QCOMPARE(parentServerSurface->inputSurfaceAt(QPointF(40, 60)), parentServerSurface);
+    QCOMPARE(parentServerSurface->inputSurfaceAt(QPointF(75, 75)), parentServerSurface);
+
+    // and so has changing the input region
+    QSignalSpy inputChangedSpy(childFor2ServerSurface, &SurfaceInterface::inputChanged);
+    QVERIFY(inputChangedSpy.isValid());
+    childFor2->setInputRegion(nullptr);
+    childFor2->commit(Surface::CommitFlag::None);
+    QVERIFY(inputChangedSpy.wait());
+    QCOMPARE(parentServerSurface->inputSurfaceAt(QPointF(40, 60)), childFor2ServerSurface);
+    QCOMPARE(parentServerSurface->inputSurfaceAt(QPointF(75, 75)), parentServerSurface);
 }
 
 void TestSubSurface::testDestroyAttachedBuffer()
@@ -1107,5 +1130,157 @@ void TestSubSurface::testDestroyParentSurface()
     QVERIFY(destroySpy.wait());
 }
 
+void TestSubSurface::testDamageHistory()
+{
+    // this test verifies that the damage history of a surface includes the damage of its sub-surfaces
+    using namespace KWayland::Client;
+    using namespace KWayland::Server;
+
+    QSignalSpy surfaceCreatedSpy(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(surfaceCreatedSpy.isValid());
+    QScopedPointer<Surface> surface(m_compositor->createSurface());
+    QVERIFY(surfaceCreatedSpy.wait());
+    auto childSurface = surfaceCreatedSpy.first().first().value<SurfaceInterface*>();
+    QVERIFY(childSurface);
+    QScopedPointer<Surface> parent(m_compositor->createSurface());
+    QVERIFY(surfaceCreatedSpy.wait());
+    auto parentSurface = surfaceCreatedSpy.last().first().value<SurfaceInterface*>();
+    QVERIFY(parentSurface);
+    QCOMPARE(parentSurface->commitSequence(), 0ull);
+    QVERIFY(parentSurface->damageSince(0).isEmpty());
+
+    QSignalSpy subSurfaceCreatedSpy(m_subcompositorInterface, &SubCompositorInterface::subSurfaceCreated);
+    QVERIFY(subSurfaceCreatedSpy.isValid());
+    QScopedPointer<SubSurface> subSurface(m_subCompositor->createSubSurface(QPointer<Surface>(surface.data()), QPointer<Surface>(parent.data())));
+    QVERIFY(subSurfaceCreatedSpy.wait());
+    auto serverSubSurface = subSurfaceCreatedSpy.first().first().value<SubSurfaceInterface*>();
+    QVERIFY(serverSubSurface);
+
+    // the synchronized sub-surface is applied together with the parent and shares the commit sequence
+    QImage image(QSize(200, 200), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::black);
+    surface->attachBuffer(m_shm->createBuffer(image));
+    surface->damage(QRect(0, 0, 200, 200));
+    surface->commit(Surface::CommitFlag::None);
+    QImage image2(QSize(400, 400), QImage::Format_ARGB32_Premultiplied);
+    image2.fill(Qt::red);
+    parent->attachBuffer(m_shm->createBuffer(image2));
+    parent->damage(QRect(0, 0, 400, 400));
+    QSignalSpy childDamagedSpy(childSurface, &SurfaceInterface::damaged);
+    QVERIFY(childDamagedSpy.isValid());
+    parent->commit(Surface::CommitFlag::None);
+    QVERIFY(childDamagedSpy.wait());
+    QCOMPARE(parentSurface->commitSequence(), 1ull);
+    QCOMPARE(childSurface->commitSequence(), 1ull);
+    QCOMPARE(parentSurface->damageSince(0), QRegion(0, 0, 400, 400));
+    QVERIFY(parentSurface->damageSince(1).isEmpty());
+
+    // moving a desynchronized sub-surface damages the old and the new geometry
+    QSignalSpy modeChangedSpy(serverSubSurface, &SubSurfaceInterface::modeChanged);
+    QVERIFY(modeChangedSpy.isValid());
+    subSurface->setMode(SubSurface::Mode::Desynchronized);
+    QVERIFY(modeChangedSpy.wait());
+    QSignalSpy positionChangedSpy(serverSubSurface, &SubSurfaceInterface::positionChanged);
+    QVERIFY(positionChangedSpy.isValid());
+    subSurface->setPosition(QPoint(50, 50));
+    QVERIFY(positionChangedSpy.wait());
+    QCOMPARE(parentSurface->commitSequence(), 2ull);
+    QCOMPARE(childSurface->commitSequence(), 1ull);
+    const QRegion moveDamage = QRegion(0, 0, 200, 200).united(QRect(50, 50, 200, 200));
+    QCOMPARE(parentSurface->damageSince(1), moveDamage);
+
+    // damage of the sub-surface is translated to the parent
+    surface->attachBuffer(m_shm->createBuffer(image));
+    surface->damage(QRect(10, 10, 20, 20));
+    surface->commit(Surface::CommitFlag::None);
+    QVERIFY(childDamagedSpy.wait());
+    QCOMPARE(childSurface->commitSequence(), 2ull);
+    QCOMPARE(childSurface->damageSince(1), QRegion(10, 10, 20, 20));
+    QCOMPARE(parentSurface->commitSequence(), 3ull);
+    QCOMPARE(parentSurface->damageSince(2), QRegion(60, 60, 20, 20));
+    QCOMPARE(parentSurface->damageSince(1), moveDamage.united(QRect(60, 60, 20, 20)));
+    QCOMPARE(parentSurface->damageSince(0), QRegion(0, 0, 400, 400));
+
+    // only the last commits are kept, afterwards the complete geometry is returned
+    QSignalSpy parentDamagedSpy(parentSurface, &SurfaceInterface::damaged);
+    QVERIFY(parentDamagedSpy.isValid());
+    for (int i = 0; i < 16; ++i) {
+        parent->attachBuffer(m_shm->createBuffer(image2));
+        parent->damage(QRect(0, 0, 1, 1));
+        parent->commit(Surface::CommitFlag::None);
+        QVERIFY(parentDamagedSpy.wait());
+    }
+    QCOMPARE(parentSurface->commitSequence(), 19ull);
+    QCOMPARE(parentSurface->damageSince(3), QRegion(0, 0, 1, 1));
+    QCOMPARE(parentSurface->damageSince(2), QRegion(0, 0, 400, 400));
+}
+
+void TestSubSurface::testDamageHistoryDestroySurface()
+{
+    // this test verifies that destroying the wl_surface of a sub-surface damages the area it covered
+    using namespace KWayland::Client;
+    using namespace KWayland::Server;
+
+    QSignalSpy surfaceCreatedSpy(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(surfaceCreatedSpy.isValid());
+    QScopedPointer<Surface> surface(m_compositor->createSurface());
+    QVERIFY(surfaceCreatedSpy.wait());
+    auto childSurface = surfaceCreatedSpy.first().first().value<SurfaceInterface*>();
+    QVERIFY(childSurface);
+    QScopedPointer<Surface> parent(m_compositor->createSurface());
+    QVERIFY(surfaceCreatedSpy.wait());
+    auto parentSurface = surfaceCreatedSpy.last().first().value<SurfaceInterface*>();
+    QVERIFY(parentSurface);
+
+    QSignalSpy subSurfaceCreatedSpy(m_subcompositorInterface, &SubCompositorInterface::subSurfaceCreated);
+    QVERIFY(subSurfaceCreatedSpy.isValid());
+    QScopedPointer<SubSurface> subSurface(m_subCompositor->createSubSurface(QPointer<Surface>(surface.data()), QPointer<Surface>(parent.data())));
+    QVERIFY(subSurfaceCreatedSpy.wait());
+    auto serverSubSurface = subSurfaceCreatedSpy.first().first().value<SubSurfaceInterface*>();
+    QVERIFY(serverSubSurface);
+    QSignalSpy modeChangedSpy(serverSubSurface, &SubSurfaceInterface::modeChanged);
+    QVERIFY(modeChangedSpy.isValid());
+    subSurface->setMode(SubSurface::Mode::Desynchronized);
+    QVERIFY(modeChangedSpy.wait());
+    QSignalSpy positionChangedSpy(serverSubSurface, &SubSurfaceInterface::positionChanged);
+    QVERIFY(positionChangedSpy.isValid());
+    subSurface->setPosition(QPoint(50, 50));
+    QVERIFY(positionChangedSpy.wait());
+
+    QImage image(QSize(400, 400), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::red);
+    QSignalSpy parentDamagedSpy(parentSurface, &SurfaceInterface::damaged);
+    QVERIFY(parentDamagedSpy.isValid());
+    parent->attachBuffer(m_shm->createBuffer(image));
+    parent->damage(QRect(0, 0, 400, 400));
+    parent->commit(Surface::CommitFlag::None);
+    QVERIFY(parentDamagedSpy.wait());
+    QImage image2(QSize(200, 200), QImage::Format_ARGB32_Premultiplied);
+    image2.fill(Qt::black);
+    QSignalSpy childDamagedSpy(childSurface, &SurfaceInterface::damaged);
+    QVERIFY(childDamagedSpy.isValid());
+    surface->attachBuffer(m_shm->createBuffer(image2));
+    surface->damage(QRect(0, 0, 200, 200));
+    surface->commit(Surface::CommitFlag::None);
+    QVERIFY(childDamagedSpy.wait());
+    const quint64 sequence = parentSurface->commitSequence();
+
+    // the wl_subsurface stays around, it just becomes inert
+    QSignalSpy childDestroyedSpy(childSurface, &QObject::destroyed);
+    QVERIFY(childDestroyedSpy.isValid());
+    surface.reset();
+    QVERIFY(childDestroyedSpy.wait());
+    QVERIFY(parentSurface->childSubSurfaces().isEmpty());
+    QCOMPARE(parentSurface->commitSequence(), sequence + 1);
+    QCOMPARE(parentSurface->damageSince(sequence), QRegion(50, 50, 200, 200));
+
+    // destroying the inert wl_subsurface doesn't add the area again
+    QSignalSpy subSurfaceDestroyedSpy(serverSubSurface, &QObject::destroyed);
+    QVERIFY(subSurfaceDestroyedSpy.isValid());
+    subSurface.reset();
+    QVERIFY(subSurfaceDestroyedSpy.wait());
+    QCOMPARE(parentSurface->commitSequence(), sequence + 1);
+}
+
 QTEST_GUILESS_MAIN(TestSubSurface)
 #include "test_wayland_subsurface.moc"
@@ -35,12 +35,67 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include "../../src/server/compositor_interface.h"
 #include "../../src/server/display.h"
 #include "../../src/server/idleinhibit_interface.h"
+#include "../../src/server/region_interface.h"
 #include "../../src/server/surface_interface.h"
 // Wayland
 #include <wayland-client-protocol.h>
+#include <wayland-server.h>
 
 using KWayland::Client::Registry;
 
+#ifdef __GLIBC__
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+}
+
+// counts the heap allocations of the thread enabling it, operator new ends up in malloc as well
+static thread_local bool s_countAllocations = false;
+static thread_local int s_allocations = 0;
+
+extern "C" void *malloc(size_t size) noexcept
+{
+    if (s_countAllocations) {
+        s_allocations++;
+    }
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) noexcept
+{
+    if (s_countAllocations) {
+        s_allocations++;
+    }
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) noexcept
+{
+    if (s_countAllocations) {
+        s_allocations++;
+    }
+    return __libc_realloc(ptr, size);
+}
+
+static void countCommitAllocations(void *data, wl_protocol_logger_type type, const wl_protocol_logger_message *message)
+{
+    // the logger is invoked after the request got demarshalled and right before it is dispatched
+    if (type == WL_PROTOCOL_LOGGER_REQUEST && message->resource == static_cast<wl_resource*>(data) &&
+            qstrcmp(message->message->name, "commit") == 0) {
+        s_countAllocations = true;
+    }
+}
+#endif
+
+static void recordBufferDamage(void *data, wl_protocol_logger_type type, const wl_protocol_logger_message *message)
+{
+    if (type == WL_PROTOCOL_LOGGER_REQUEST && qstrcmp(message->message->name, "damage_buffer") == 0) {
+        const wl_argument *a = message->arguments;
+        static_cast<QVector<QRect>*>(data)->append(QRect(a[0].i, a[1].i, a[2].i, a[3].i));
+    }
+}
+
 class TestWaylandSurface : public QObject
 {
     Q_OBJECT
@@ -52,8 +107,17 @@ private Q_SLOTS:
 
     void testStaticAccessor();
     void testDamage();
+    void testDamagePolicy();
     void testFrameCallback();
+    void testFrameThrottling();
     void testAttachBuffer();
+    void testReattachBuffer();
+    void testBatchedBufferRelease();
+    void testEarlyShmBufferRelease();
+    void testRefAfterEarlyShmBufferRelease();
+    void testDestroyCompositorInterface();
+    void testCopyDamage();
+    void testUpdateBuffer();
     void testMultipleSurfaces();
     void testOpaque();
     void testInput();
@@ -67,6 +131,8 @@ private Q_SLOTS:
     void testOutput();
     void testDisconnect();
     void testInhibit();
+    void testCommitAllocations();
+    void benchmarkCommit();
 
 private:
     KWayland::Server::Display *m_display;
@@ -82,6 +148,19 @@ private:
 
 static const QString s_socketName = QStringLiteral("kwin-test-wayland-surface-0");
 
+// records when the server destroys the resource of a frame callback, which it does right after sending it
+struct FrameCallbackSentListener
+{
+    FrameCallbackSentListener() {
+        listener.notify = [] (wl_listener *listener, void *data) {
+            Q_UNUSED(data)
+            reinterpret_cast<FrameCallbackSentListener*>(listener)->sent.start();
+        };
+    }
+    wl_listener listener;
+    QElapsedTimer sent;
+};
+
 TestWaylandSurface::TestWaylandSurface(QObject *parent)
     : QObject(parent)
     , m_display(nullptr)
@@ -215,6 +294,8 @@ void TestWaylandSurface::testStaticAccessor()
     QVERIFY(serverSurface1);
     QCOMPARE(KWayland::Server::SurfaceInterface::get(serverSurface1->resource()), serverSurface1);
     QCOMPARE(KWayland::Server::SurfaceInterface::get(serverSurface1->id(), serverSurface1->client()), serverSurface1);
+    // a resource of a different interface must not be resolved
+    QVERIFY(!KWayland::Server::RegionInterface::get(serverSurface1->resource()));
 
     QVERIFY(!s1->size().isValid());
     QSignalSpy sizeChangedSpy(s1, SIGNAL(sizeChanged(QSize)));
@@ -348,6 +429,87 @@ void TestWaylandSurface::testDamage()
     QVERIFY(serverSurface->isMapped());
 }
 
+void TestWaylandSurface::testDamagePolicy()
+{
+    // this test verifies that the damage rectangles get combined according to the policy of the compositor
+    using namespace KWayland::Client;
+    using namespace KWayland::Server;
+    QCOMPARE(m_compositorInterface->damageRectsThreshold(), 64);
+    QCOMPARE(m_compositorInterface->damageAreaOverhead(), 0.25);
+    m_compositorInterface->setDamageRectsThreshold(4);
+    QCOMPARE(m_compositorInterface->damageRectsThreshold(), 4);
+
+    QSignalSpy serverSurfaceCreated(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(serverSurfaceCreated.isValid());
+    QScopedPointer<Surface> s(m_compositor->createSurface());
+    QVERIFY(serverSurfaceCreated.wait());
+    SurfaceInterface *serverSurface = serverSurfaceCreated.first().first().value<KWayland::Server::SurfaceInterface*>();
+    QVERIFY(serverSurface);
+    QSignalSpy damageSpy(serverSurface, &SurfaceInterface::damaged);
+    QVERIFY(damageSpy.isValid());
+    QCOMPARE(serverSurface->damageStatistics().commits, 0ull);
+
+    QImage img(QSize(100, 100), QImage::Format_ARGB32_Premultiplied);
+    img.fill(Qt::black);
+    // four rectangles stay exact
+    s->attachBuffer(m_shm->createBuffer(img));
+    QRegion exact;
+    for (int i = 0; i < 4; ++i) {
+        s->damage(QRect(i * 20, i * 20, 5, 5));
+        exact += QRect(i * 20, i * 20, 5, 5);
+    }
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    QCOMPARE(serverSurface->damage(), exact);
+    auto statistics = serverSurface->damageStatistics();
+    QCOMPARE(statistics.commits, 1ull);
+    QCOMPARE(statistics.rects, 4ull);
+    QCOMPARE(statistics.maxRectsPerCommit, 4ull);
+    QCOMPARE(statistics.boundingBoxCommits, 0ull);
+
+    // five rectangles get combined into the bounding box
+    s->attachBuffer(m_shm->createBuffer(img));
+    for (int i = 0; i < 5; ++i) {
+        s->damage(QRect(i * 20, i * 20, 5, 5));
+    }
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    QCOMPARE(serverSurface->damage(), QRegion(0, 0, 85, 85));
+    statistics = serverSurface->damageStatistics();
+    QCOMPARE(statistics.commits, 2ull);
+    QCOMPARE(statistics.rects, 9ull);
+    QCOMPARE(statistics.maxRectsPerCommit, 5ull);
+    QCOMPARE(statistics.boundingBoxCommits, 1ull);
+
+    // adjacent rectangles with little overhead get combined as well, also through damage_buffer
+    m_compositorInterface->setDamageRectsThreshold(-1);
+    s->attachBuffer(m_shm->createBuffer(img));
+    s->damage(QRect(0, 0, 50, 10));
+    s->damage(QRect(0, 10, 45, 10));
+    s->damageBuffer(QRect(0, 20, 50, 10));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    QCOMPARE(serverSurface->damage(), QRegion(0, 0, 50, 30));
+    QCOMPARE(serverSurface->damageStatistics().boundingBoxCommits, 2ull);
+
+    // but not if the overhead is disabled
+    m_compositorInterface->setDamageAreaOverhead(-1);
+    s->attachBuffer(m_shm->createBuffer(img));
+    s->damage(QRect(0, 0, 50, 10));
+    s->damage(QRect(0, 10, 45, 10));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    QCOMPARE(serverSurface->damage(), QRegion(0, 0, 50, 10) + QRegion(0, 10, 45, 10));
+    QCOMPARE(serverSurface->damageStatistics().boundingBoxCommits, 2ull);
+
+    serverSurface->resetDamageStatistics();
+    statistics = serverSurface->damageStatistics();
+    QCOMPARE(statistics.commits, 0ull);
+    QCOMPARE(statistics.rects, 0ull);
+    QCOMPARE(statistics.maxRectsPerCommit, 0ull);
+    QCOMPARE(statistics.boundingBoxCommits, 0ull);
+}
+
 void TestWaylandSurface::testFrameCallback()
 {
     QSignalSpy serverSurfaceCreated(m_compositorInterface, SIGNAL(surfaceCreated(KWayland::Server::SurfaceInterface*)));
@@ -375,6 +537,105 @@ void TestWaylandSurface::testFrameCallback()
     QVERIFY(!frameRenderedSpy.isEmpty());
 }
 
+void TestWaylandSurface::testFrameThrottling()
+{
+    using namespace KWayland::Server;
+    QSignalSpy serverSurfaceCreated(m_compositorInterface, SIGNAL(surfaceCreated(KWayland::Server::SurfaceInterface*)));
+    QVERIFY(serverSurfaceCreated.isValid());
+    KWayland::Client::Surface *s = m_compositor->createSurface();
+    QVERIFY(serverSurfaceCreated.wait());
+    SurfaceInterface *serverSurface = serverSurfaceCreated.first().first().value<KWayland::Server::SurfaceInterface*>();
+    QVERIFY(serverSurface);
+    QCOMPARE(serverSurface->frameThrottling(), SurfaceInterface::FrameThrottling::None);
+    QCOMPARE(serverSurface->frameThrottlingInterval(), 1000);
+    QCOMPARE(serverSurface->frameSuspendTimeout(), 0);
+
+    QSignalSpy committedSpy(serverSurface, &SurfaceInterface::committed);
+    QVERIFY(committedSpy.isValid());
+    QSignalSpy frameRenderedSpy(s, &KWayland::Client::Surface::frameRendered);
+    QVERIFY(frameRenderedSpy.isValid());
+    QImage img(QSize(10, 10), QImage::Format_ARGB32_Premultiplied);
+    img.fill(Qt::black);
+    s->attachBuffer(m_shm->createBuffer(img));
+    s->damage(QRect(0, 0, 10, 10));
+    s->commit();
+    QVERIFY(committedSpy.wait());
+
+    ClientConnection *client = serverSurface->client();
+    auto frameCallback = [s] {
+        wl_callback *callback = wl_surface_frame(*s);
+        s->commit(KWayland::Client::Surface::CommitFlag::None);
+        return callback;
+    };
+    // the server destroys the resource of a frame callback right after sending it
+    auto resource = [client] (wl_callback *callback) {
+        return client->getResource(wl_proxy_get_id(reinterpret_cast<wl_proxy*>(callback)));
+    };
+
+    // a suspended surface holds the frame callback
+    serverSurface->setFrameThrottling(SurfaceInterface::FrameThrottling::Suspended);
+    QCOMPARE(serverSurface->frameThrottling(), SurfaceInterface::FrameThrottling::Suspended);
+    wl_callback *callback = frameCallback();
+    QVERIFY(committedSpy.wait());
+    serverSurface->frameRendered(10);
+    QVERIFY(resource(callback));
+
+    // and releases it once it is no longer throttled
+    serverSurface->setFrameThrottling(SurfaceInterface::FrameThrottling::None);
+    QTRY_VERIFY(!resource(callback));
+    wl_callback_destroy(callback);
+    QVERIFY(frameRenderedSpy.wait());
+    QCOMPARE(frameRenderedSpy.count(), 1);
+
+    // with a suspend timeout the held frame callback gets released anyway
+    serverSurface->setFrameSuspendTimeout(100);
+    serverSurface->setFrameThrottling(SurfaceInterface::FrameThrottling::Suspended);
+    callback = frameCallback();
+    QVERIFY(committedSpy.wait());
+    serverSurface->frameRendered(20);
+    QVERIFY(resource(callback));
+    QTRY_VERIFY(!resource(callback));
+    wl_callback_destroy(callback);
+
+    // low rate sends at most one frame callback per interval
+    const int interval = 100;
+    serverSurface->setFrameThrottlingInterval(interval);
+    serverSurface->setFrameThrottling(SurfaceInterface::FrameThrottling::LowRate);
+    FrameCallbackSentListener first;
+    callback = frameCallback();
+    QVERIFY(committedSpy.wait());
+    wl_resource_add_destroy_listener(resource(callback), &first.listener);
+    serverSurface->frameRendered(30);
+    QTRY_VERIFY(first.sent.isValid());
+    wl_callback_destroy(callback);
+    FrameCallbackSentListener second;
+    callback = frameCallback();
+    QVERIFY(committedSpy.wait());
+    wl_resource_add_destroy_listener(resource(callback), &second.listener);
+    serverSurface->frameRendered(40);
+    QTRY_VERIFY(second.sent.isValid());
+    wl_callback_destroy(callback);
+    // the elapsed milliseconds are truncated on both ends
+    QVERIFY(first.sent.msecsTo(second.sent) >= interval - 1);
+
+    // destroying the surface while holding a frame callback releases it and stops the throttling
+    serverSurface->setFrameThrottlingInterval(60000);
+    callback = frameCallback();
+    QVERIFY(committedSpy.wait());
+    serverSurface->frameRendered(50);
+    QVERIFY(resource(callback));
+    QSignalSpy destroyedSpy(serverSurface, &QObject::destroyed);
+    QVERIFY(destroyedSpy.isValid());
+    delete s;
+    QVERIFY(destroyedSpy.wait());
+    QVERIFY(!resource(callback));
+    wl_callback_destroy(callback);
+    s = m_compositor->createSurface();
+    QVERIFY(serverSurfaceCreated.wait());
+    QVERIFY(!m_connection->hasError());
+    delete s;
+}
+
 void TestWaylandSurface::testAttachBuffer()
 {
     // create the surface
@@ -518,6 +779,474 @@ void TestWaylandSurface::testAttachBuffer()
     buffer->unref();
 }
 
+void TestWaylandSurface::testReattachBuffer()
+{
+    // this test verifies that a wl_buffer keeps its BufferInterface when getting attached again
+    using namespace KWayland::Client;
+    using namespace KWayland::Server;
+    QSignalSpy serverSurfaceCreated(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(serverSurfaceCreated.isValid());
+    QScopedPointer<Surface> s(m_compositor->createSurface());
+    QVERIFY(serverSurfaceCreated.wait());
+    SurfaceInterface *serverSurface = serverSurfaceCreated.first().first().value<SurfaceInterface*>();
+    QVERIFY(serverSurface);
+    QSignalSpy damageSpy(serverSurface, &SurfaceInterface::damaged);
+    QVERIFY(damageSpy.isValid());
+
+    QImage black(24, 24, QImage::Format_RGB32);
+    black.fill(Qt::black);
+    QImage red(24, 24, QImage::Format_ARGB32_Premultiplied);
+    red.fill(QColor(255, 0, 0, 128));
+    QSharedPointer<Buffer> blackBuffer = m_shm->createBuffer(black).toStrongRef();
+    QVERIFY(blackBuffer);
+    QSharedPointer<Buffer> redBuffer = m_shm->createBuffer(red).toStrongRef();
+    QVERIFY(redBuffer);
+
+    s->attachBuffer(blackBuffer.data());
+    s->damage(QRect(0, 0, 24, 24));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    BufferInterface *serverBlack = serverSurface->buffer();
+    QVERIFY(serverBlack);
+    QVERIFY(serverBlack->isReferenced());
+    QCOMPARE(serverBlack->surface(), serverSurface);
+
+    // attaching the same buffer again keeps it referenced
+    s->attachBuffer(blackBuffer.data());
+    s->damage(QRect(0, 0, 10, 10));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    QCOMPARE(serverSurface->buffer(), serverBlack);
+    QVERIFY(serverBlack->isReferenced());
+
+    // attach another buffer, the black one gets released but stays around
+    s->attachBuffer(redBuffer.data());
+    s->damage(QRect(0, 0, 24, 24));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    BufferInterface *serverRed = serverSurface->buffer();
+    QVERIFY(serverRed != serverBlack);
+    QVERIFY(!serverBlack->isReferenced());
+    QTRY_VERIFY(blackBuffer->isReleased());
+
+    // and attaching the black buffer again reuses the BufferInterface
+    blackBuffer->setReleased(false);
+    s->attachBuffer(blackBuffer.data());
+    s->damage(QRect(0, 0, 24, 24));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    QCOMPARE(serverSurface->buffer(), serverBlack);
+    QVERIFY(serverBlack->isReferenced());
+    QVERIFY(!serverRed->isReferenced());
+    QCOMPARE(serverBlack->data(), black);
+}
+
+void TestWaylandSurface::testBatchedBufferRelease()
+{
+    // this test verifies that batched buffer releases are only sent on flushBufferReleases
+    using namespace KWayland::Client;
+    using namespace KWayland::Server;
+    QVERIFY(!m_compositorInterface->isBufferReleaseBatchingEnabled());
+    m_compositorInterface->setBufferReleaseBatchingEnabled(true);
+    QVERIFY(m_compositorInterface->isBufferReleaseBatchingEnabled());
+
+    QSignalSpy serverSurfaceCreated(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(serverSurfaceCreated.isValid());
+    QScopedPointer<Surface> s(m_compositor->createSurface());
+    QVERIFY(serverSurfaceCreated.wait());
+    SurfaceInterface *serverSurface = serverSurfaceCreated.first().first().value<SurfaceInterface*>();
+    QVERIFY(serverSurface);
+    QSignalSpy damageSpy(serverSurface, &SurfaceInterface::damaged);
+    QVERIFY(damageSpy.isValid());
+    QSignalSpy frameRenderedSpy(s.data(), &Surface::frameRendered);
+    QVERIFY(frameRenderedSpy.isValid());
+
+    QImage black(24, 24, QImage::Format_RGB32);
+    black.fill(Qt::black);
+    QImage red(24, 24, QImage::Format_ARGB32_Premultiplied);
+    red.fill(QColor(255, 0, 0, 128));
+    QSharedPointer<Buffer> blackBuffer = m_shm->createBuffer(black).toStrongRef();
+    QVERIFY(blackBuffer);
+    QSharedPointer<Buffer> redBuffer = m_shm->createBuffer(red).toStrongRef();
+    QVERIFY(redBuffer);
+
+    s->attachBuffer(blackBuffer.data());
+    s->damage(QRect(0, 0, 24, 24));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    BufferInterface *serverBlack = serverSurface->buffer();
+    QVERIFY(serverBlack);
+
+    s->attachBuffer(redBuffer.data());
+    s->damage(QRect(0, 0, 24, 24));
+    s->commit();
+    QVERIFY(damageSpy.wait());
+    QVERIFY(!serverBlack->isReferenced());
+    // the frame callback is sent after the release would have been, so it's queued
+    serverSurface->frameRendered(1);
+    QVERIFY(frameRenderedSpy.wait());
+    QVERIFY(!blackBuffer->isReleased());
+    m_compositorInterface->flushBufferReleases();
+    QTRY_VERIFY(blackBuffer->isReleased());
+    QVERIFY(!redBuffer->isReleased());
+
+    // a buffer getting attached again before the flush is not released
+    blackBuffer->setReleased(false);
+    s->attachBuffer(blackBuffer.data());
+    s->damage(QRect(0, 0, 24, 24));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    s->attachBuffer(redBuffer.data());
+    s->damage(QRect(0, 0, 24, 24));
+    s->commit();
+    QVERIFY(damageSpy.wait());
+    QVERIFY(serverSurface->buffer()->isReferenced());
+    m_compositorInterface->flushBufferReleases();
+    serverSurface->frameRendered(2);
+    QVERIFY(frameRenderedSpy.wait());
+    QVERIFY(blackBuffer->isReleased());
+    QVERIFY(!redBuffer->isReleased());
+
+    // disabling the batching sends the queued releases
+    s->attachBuffer(blackBuffer.data());
+    s->damage(QRect(0, 0, 24, 24));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    m_compositorInterface->setBufferReleaseBatchingEnabled(false);
+    QTRY_VERIFY(redBuffer->isReleased());
+}
+
+void TestWaylandSurface::testEarlyShmBufferRelease()
+{
+    // this test verifies that shm buffers get released once their contents got uploaded
+    using namespace KWayland::Client;
+    using namespace KWayland::Server;
+    QSignalSpy serverSurfaceCreated(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(serverSurfaceCreated.isValid());
+    QScopedPointer<Surface> s(m_compositor->createSurface());
+    QVERIFY(serverSurfaceCreated.wait());
+    SurfaceInterface *serverSurface = serverSurfaceCreated.first().first().value<SurfaceInterface*>();
+    QVERIFY(serverSurface);
+    QSignalSpy damageSpy(serverSurface, &SurfaceInterface::damaged);
+    QVERIFY(damageSpy.isValid());
+    QSignalSpy frameRenderedSpy(s.data(), &Surface::frameRendered);
+    QVERIFY(frameRenderedSpy.isValid());
+
+    QImage black(24, 24, QImage::Format_RGB32);
+    black.fill(Qt::black);
+    QImage red(24, 24, QImage::Format_ARGB32_Premultiplied);
+    red.fill(QColor(255, 0, 0, 128));
+    QSharedPointer<Buffer> blackBuffer = m_shm->createBuffer(black).toStrongRef();
+    QVERIFY(blackBuffer);
+    QSharedPointer<Buffer> redBuffer = m_shm->createBuffer(red).toStrongRef();
+    QVERIFY(redBuffer);
+
+    s->attachBuffer(blackBuffer.data());
+    s->damage(QRect(0, 0, 24, 24));
+    s->commit();
+    QVERIFY(damageSpy.wait());
+    BufferInterface *serverBlack = serverSurface->buffer();
+    QVERIFY(serverBlack);
+
+    // without early release the upload doesn't change anything
+    QVERIFY(!m_compositorInterface->isEarlyShmBufferReleaseEnabled());
+    serverBlack->contentsUploaded();
+    serverSurface->frameRendered(1);
+    QVERIFY(frameRenderedSpy.wait());
+    QVERIFY(!blackBuffer->isReleased());
+
+    m_compositorInterface->setEarlyShmBufferReleaseEnabled(true);
+    QVERIFY(m_compositorInterface->isEarlyShmBufferReleaseEnabled());
+    serverBlack->contentsUploaded();
+    QTRY_VERIFY(blackBuffer->isReleased());
+    QVERIFY(serverBlack->isReferenced());
+    QCOMPARE(serverSurface->buffer(), serverBlack);
+
+    // replacing the buffer doesn't release it a second time
+    blackBuffer->setReleased(false);
+    s->attachBuffer(redBuffer.data());
+    s->damage(QRect(0, 0, 24, 24));
+    s->commit();
+    QVERIFY(damageSpy.wait());
+    QVERIFY(!serverBlack->isReferenced());
+    serverSurface->frameRendered(2);
+    QVERIFY(frameRenderedSpy.wait());
+    QVERIFY(!blackBuffer->isReleased());
+
+    // attaching the same buffer again marks it as used
+    serverSurface->buffer()->contentsUploaded();
+    QTRY_VERIFY(redBuffer->isReleased());
+    redBuffer->setReleased(false);
+    s->attachBuffer(redBuffer.data());
+    s->damage(QRect(0, 0, 24, 24));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    s->attachBuffer(blackBuffer.data());
+    s->damage(QRect(0, 0, 24, 24));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    QTRY_VERIFY(redBuffer->isReleased());
+}
+
+void TestWaylandSurface::testRefAfterEarlyShmBufferRelease()
+{
+    // this test verifies that a reference of the compositor doesn't undo an early release
+    using namespace KWayland::Client;
+    using namespace KWayland::Server;
+    m_compositorInterface->setEarlyShmBufferReleaseEnabled(true);
+    QSignalSpy serverSurfaceCreated(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(serverSurfaceCreated.isValid());
+    QScopedPointer<Surface> s(m_compositor->createSurface());
+    QVERIFY(serverSurfaceCreated.wait());
+    SurfaceInterface *serverSurface = serverSurfaceCreated.first().first().value<SurfaceInterface*>();
+    QVERIFY(serverSurface);
+    QSignalSpy damageSpy(serverSurface, &SurfaceInterface::damaged);
+    QVERIFY(damageSpy.isValid());
+    QSignalSpy frameRenderedSpy(s.data(), &Surface::frameRendered);
+    QVERIFY(frameRenderedSpy.isValid());
+
+    QImage black(24, 24, QImage::Format_RGB32);
+    black.fill(Qt::black);
+    QSharedPointer<Buffer> blackBuffer = m_shm->createBuffer(black).toStrongRef();
+    QVERIFY(blackBuffer);
+    QSharedPointer<Buffer> redBuffer = m_shm->createBuffer(black).toStrongRef();
+    QVERIFY(redBuffer);
+
+    s->attachBuffer(blackBuffer.data());
+    s->damage(QRect(0, 0, 24, 24));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    BufferInterface *serverBlack = serverSurface->buffer();
+    QVERIFY(serverBlack);
+    serverBlack->contentsUploaded();
+    QTRY_VERIFY(blackBuffer->isReleased());
+    blackBuffer->setReleased(false);
+
+    // e.g. a close animation keeps the buffer referenced after it got replaced
+    serverBlack->ref();
+    s->attachBuffer(redBuffer.data());
+    s->damage(QRect(0, 0, 24, 24));
+    s->commit();
+    QVERIFY(damageSpy.wait());
+    QVERIFY(serverBlack->isReferenced());
+    serverBlack->unref();
+    QVERIFY(!serverBlack->isReferenced());
+
+    // the client got the buffer back already, it must not be released a second time
+    serverSurface->frameRendered(1);
+    QVERIFY(frameRenderedSpy.wait());
+    QVERIFY(!blackBuffer->isReleased());
+
+    // while the client attaching it again makes it get released again
+    serverSurface->buffer()->contentsUploaded();
+    QTRY_VERIFY(redBuffer->isReleased());
+    redBuffer->setReleased(false);
+    serverSurface->buffer()->ref();
+    s->attachBuffer(redBuffer.data());
+    s->damage(QRect(0, 0, 24, 24));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    BufferInterface *serverRed = serverSurface->buffer();
+    s->attachBuffer(blackBuffer.data());
+    s->damage(QRect(0, 0, 24, 24));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    QVERIFY(serverRed->isReferenced());
+    QVERIFY(!redBuffer->isReleased());
+    serverRed->unref();
+    QTRY_VERIFY(redBuffer->isReleased());
+}
+
+void TestWaylandSurface::testDestroyCompositorInterface()
+{
+    // this test verifies that a surface outliving its CompositorInterface keeps working
+    using namespace KWayland::Client;
+    using namespace KWayland::Server;
+    m_compositorInterface->setBufferReleaseBatchingEnabled(true);
+    m_compositorInterface->setEarlyShmBufferReleaseEnabled(true);
+    QSignalSpy serverSurfaceCreated(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(serverSurfaceCreated.isValid());
+    QScopedPointer<Surface> s(m_compositor->createSurface());
+    QVERIFY(serverSurfaceCreated.wait());
+    SurfaceInterface *serverSurface = serverSurfaceCreated.first().first().value<SurfaceInterface*>();
+    QVERIFY(serverSurface);
+    QSignalSpy damageSpy(serverSurface, &SurfaceInterface::damaged);
+    QVERIFY(damageSpy.isValid());
+
+    QImage black(100, 100, QImage::Format_RGB32);
+    black.fill(Qt::black);
+    QSharedPointer<Buffer> blackBuffer = m_shm->createBuffer(black).toStrongRef();
+    QVERIFY(blackBuffer);
+    QSharedPointer<Buffer> redBuffer = m_shm->createBuffer(black).toStrongRef();
+    QVERIFY(redBuffer);
+    QSharedPointer<Buffer> blueBuffer = m_shm->createBuffer(black).toStrongRef();
+    QVERIFY(blueBuffer);
+
+    s->attachBuffer(blackBuffer.data());
+    s->damage(QRect(0, 0, 100, 100));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+
+    delete m_compositorInterface;
+    m_compositorInterface = nullptr;
+
+    // the damage falls back to the default policy, which uses the bounding box here
+    s->attachBuffer(redBuffer.data());
+    s->damage(QRect(0, 0, 50, 10));
+    s->damage(QRect(0, 10, 45, 10));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    QCOMPARE(serverSurface->damage(), QRegion(0, 0, 50, 20));
+    QCOMPARE(serverSurface->damageStatistics().boundingBoxCommits, 1ull);
+    // without the compositor the replaced buffer is released directly instead of being batched
+    QTRY_VERIFY(blackBuffer->isReleased());
+
+    // and early release is no longer possible
+    BufferInterface *serverRed = serverSurface->buffer();
+    QVERIFY(serverRed);
+    serverRed->contentsUploaded();
+    s->attachBuffer(blueBuffer.data());
+    s->damage(QRect(0, 0, 100, 100));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    QTRY_VERIFY(redBuffer->isReleased());
+    QVERIFY(!blueBuffer->isReleased());
+}
+
+void TestWaylandSurface::testCopyDamage()
+{
+    // this test verifies that only the damaged parts of a buffer can be copied
+    using namespace KWayland::Client;
+    using namespace KWayland::Server;
+    QSignalSpy serverSurfaceCreated(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(serverSurfaceCreated.isValid());
+    QScopedPointer<Surface> s(m_compositor->createSurface());
+    QVERIFY(serverSurfaceCreated.wait());
+    SurfaceInterface *serverSurface = serverSurfaceCreated.first().first().value<SurfaceInterface*>();
+    QVERIFY(serverSurface);
+    QSignalSpy damageSpy(serverSurface, &SurfaceInterface::damaged);
+    QVERIFY(damageSpy.isValid());
+
+    // no buffer, nothing to map
+    QVERIFY(serverSurface->mapToBuffer(QRegion(0, 0, 10, 10)).isEmpty());
+
+    QImage image(48, 32, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::red);
+    s->attachBuffer(m_shm->createBuffer(image));
+    s->setScale(2);
+    s->damage(QRect(2, 2, 4, 4));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    QCOMPARE(serverSurface->damage(), QRegion(2, 2, 4, 4));
+    const QRegion bufferDamage = serverSurface->mapToBuffer(serverSurface->damage());
+    QCOMPARE(bufferDamage, QRegion(4, 4, 8, 8));
+    // mapping gets clipped to the buffer
+    QCOMPARE(serverSurface->mapToBuffer(QRegion(20, 10, 100, 100)), QRegion(40, 20, 8, 12));
+
+    QImage staging(48, 32, QImage::Format_ARGB32_Premultiplied);
+    staging.fill(Qt::transparent);
+    QVERIFY(serverSurface->buffer()->copyTo(staging.bits(), staging.bytesPerLine(), bufferDamage));
+    for (int x = 0; x < staging.width(); ++x) {
+        for (int y = 0; y < staging.height(); ++y) {
+            if (bufferDamage.contains(QPoint(x, y))) {
+                QCOMPARE(staging.pixel(x, y), qRgba(255, 0, 0, 255));
+            } else {
+                QCOMPARE(staging.pixel(x, y), qRgba(0, 0, 0, 0));
+            }
+        }
+    }
+
+    // now with a buffer transform
+    wl_surface_set_buffer_transform(*s, WL_OUTPUT_TRANSFORM_90);
+    s->commit(Surface::CommitFlag::None);
+    QSignalSpy transformChangedSpy(serverSurface, &SurfaceInterface::transformChanged);
+    QVERIFY(transformChangedSpy.isValid());
+    QVERIFY(transformChangedSpy.wait());
+    QCOMPARE(serverSurface->mapToBuffer(QRegion(0, 0, 4, 2)), QRegion(44, 0, 4, 8));
+
+    // buffer damage is mapped back with the inverse transform, rounded outwards to whole surface pixels
+    QImage image2(48, 32, QImage::Format_ARGB32_Premultiplied);
+    image2.fill(Qt::blue);
+    s->attachBuffer(m_shm->createBuffer(image2));
+    s->damageBuffer(QRect(45, 3, 1, 1));
+    s->damageBuffer(QRect(0, 0, 3, 5));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    QCOMPARE(serverSurface->size(), QSize(16, 24));
+    QCOMPARE(serverSurface->damage(), QRegion(1, 1, 1, 1) + QRegion(0, 22, 3, 2));
+    const QRegion transformedDamage = serverSurface->mapToBuffer(serverSurface->damage());
+    QCOMPARE(transformedDamage, QRegion(44, 2, 2, 2) + QRegion(0, 0, 4, 6));
+    QVERIFY(transformedDamage.contains(QRect(45, 3, 1, 1)));
+    QVERIFY(transformedDamage.contains(QRect(0, 0, 3, 5)));
+
+    staging.fill(Qt::transparent);
+    QVERIFY(serverSurface->buffer()->copyTo(staging.bits(), staging.bytesPerLine(), transformedDamage));
+    for (int x = 0; x < staging.width(); ++x) {
+        for (int y = 0; y < staging.height(); ++y) {
+            if (transformedDamage.contains(QPoint(x, y))) {
+                QCOMPARE(staging.pixel(x, y), qRgba(0, 0, 255, 255));
+            } else {
+                QCOMPARE(staging.pixel(x, y), qRgba(0, 0, 0, 0));
+            }
+        }
+    }
+}
+
+void TestWaylandSurface::testUpdateBuffer()
+{
+    // this test verifies that updating a buffer only copies and damages the clipped region
+    using namespace KWayland::Client;
+    using namespace KWayland::Server;
+    QSignalSpy serverSurfaceCreated(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(serverSurfaceCreated.isValid());
+    QScopedPointer<Surface> s(m_compositor->createSurface());
+    QVERIFY(serverSurfaceCreated.wait());
+    SurfaceInterface *serverSurface = serverSurfaceCreated.first().first().value<SurfaceInterface*>();
+    QVERIFY(serverSurface);
+    QSignalSpy damageSpy(serverSurface, &SurfaceInterface::damaged);
+    QVERIFY(damageSpy.isValid());
+
+    QImage black(32, 24, QImage::Format_ARGB32_Premultiplied);
+    black.fill(Qt::black);
+    Buffer::Ptr buffer = m_shm->createBuffer(black);
+    s->attachBuffer(buffer);
+    s->damage(QRect(0, 0, 32, 24));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+
+    QVector<QRect> bufferDamage;
+    wl_protocol_logger *logger = wl_display_add_protocol_logger(*m_display, recordBufferDamage, &bufferDamage);
+    QVERIFY(logger);
+
+    // a larger non-premultiplied image, the second rect is partially outside of the buffer
+    QImage red(48, 48, QImage::Format_ARGB32);
+    red.fill(QColor(255, 0, 0, 128));
+    const QRegion clipped = QRegion(2, 2, 4, 4) + QRegion(20, 16, 12, 8);
+    s->updateBuffer(buffer, red, QRegion(2, 2, 4, 4) + QRegion(20, 16, 20, 20));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damageSpy.wait());
+    wl_protocol_logger_destroy(logger);
+
+    QRegion receivedDamage;
+    for (const QRect &rect : qAsConst(bufferDamage)) {
+        receivedDamage += rect;
+    }
+    QCOMPARE(receivedDamage, clipped);
+    QCOMPARE(serverSurface->damage(), clipped);
+
+    const QImage data = serverSurface->buffer()->data();
+    QCOMPARE(data.size(), QSize(32, 24));
+    for (int x = 0; x < data.width(); ++x) {
+        for (int y = 0; y < data.height(); ++y) {
+            if (clipped.contains(QPoint(x, y))) {
+                QCOMPARE(data.pixel(x, y), qPremultiply(red.pixel(x, y)));
+            } else {
+                QCOMPARE(data.pixel(x, y), qRgba(0, 0, 0, 255));
+            }
+        }
+    }
+}
+
 void TestWaylandSurface::testMultipleSurfaces()
 {
     using namespace KWayland::Client;
@@ -592,10 +1321,20 @@ void TestWaylandSurface::testMultipleSurfaces()
     QImage buffer2Data = buffer2->data();
     QCOMPARE(buffer2Data, red);
 
-    // while buffer2 is accessed we cannot access buffer1
+    // while buffer2 is accessed we cannot access buffer1 as it belongs to a different pool
     buffer1Data = buffer1->data();
     QVERIFY(buffer1Data.isNull());
 
+    // but a different thread can access it at the same time
+    bool accessedFromThread = false;
+    QScopedPointer<QThread> thread(QThread::create([buffer1, &black, &accessedFromThread] {
+        const QImage image = buffer1->data();
+        accessedFromThread = !image.isNull() && image == black;
+    }));
+    thread->start();
+    QVERIFY(thread->wait());
+    QVERIFY(accessedFromThread);
+
     // a deep copy can be kept around
     QImage deepCopy = buffer2Data.copy();
     QCOMPARE(deepCopy, red);
@@ -1212,5 +1951,83 @@ void TestWaylandSurface::testInhibit()
     QCOMPARE(inhibitsChangedSpy.count(), 4);
 }
 
+void TestWaylandSurface::testCommitAllocations()
+{
+#ifndef __GLIBC__
+    QSKIP("Counting the allocations requires glibc");
+#else
+    // commits which only change the buffer and the damage must not allocate on the server
+    using namespace KWayland::Client;
+    using namespace KWayland::Server;
+    QSignalSpy serverSurfaceCreated(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(serverSurfaceCreated.isValid());
+    QScopedPointer<Surface> s(m_compositor->createSurface());
+    QVERIFY(serverSurfaceCreated.wait());
+    SurfaceInterface *serverSurface = serverSurfaceCreated.first().first().value<KWayland::Server::SurfaceInterface*>();
+    QVERIFY(serverSurface);
+    int commits = 0;
+    connect(serverSurface, &SurfaceInterface::committed, this,
+        [&commits] {
+            s_countAllocations = false;
+            commits++;
+        }, Qt::DirectConnection
+    );
+    wl_protocol_logger *logger = wl_display_add_protocol_logger(*m_display, countCommitAllocations, serverSurface->resource());
+    QVERIFY(logger);
+
+    QImage img(QSize(100, 100), QImage::Format_ARGB32_Premultiplied);
+    img.fill(Qt::black);
+    auto buffer = m_shm->createBuffer(img);
+    for (int i = 0; i < 40; ++i) {
+        s_allocations = 0;
+        s->attachBuffer(buffer);
+        s->damage(QRect(i % 90, 0, 10, 10));
+        s->commit(Surface::CommitFlag::None);
+        m_connection->flush();
+        QTRY_COMPARE(commits, i + 1);
+        serverSurface->resetTrackedDamage();
+        // the first commits allocate the damage rectangles and fill the damage history
+        if (i >= 2 * 16) {
+            QCOMPARE(s_allocations, 0);
+        }
+    }
+    wl_protocol_logger_destroy(logger);
+    QVERIFY(!s_countAllocations);
+
+    // the damage is still available on request
+    QCOMPARE(serverSurface->damage(), QRegion(39, 0, 10, 10));
+    QCOMPARE(serverSurface->damageSince(serverSurface->commitSequence() - 2), QRegion(38, 0, 11, 10));
+#endif
+}
+
+void TestWaylandSurface::benchmarkCommit()
+{
+    // commits which only change the buffer and the damage, the common case for most clients
+    using namespace KWayland::Client;
+    using namespace KWayland::Server;
+    QSignalSpy serverSurfaceCreated(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(serverSurfaceCreated.isValid());
+    QScopedPointer<Surface> s(m_compositor->createSurface());
+    QVERIFY(serverSurfaceCreated.wait());
+    SurfaceInterface *serverSurface = serverSurfaceCreated.first().first().value<KWayland::Server::SurfaceInterface*>();
+    QVERIFY(serverSurface);
+    QSignalSpy committedSpy(serverSurface, &SurfaceInterface::committed);
+    QVERIFY(committedSpy.isValid());
+
+    QImage img(QSize(100, 100), QImage::Format_ARGB32_Premultiplied);
+    img.fill(Qt::black);
+    auto buffer = m_shm->createBuffer(img);
+    QBENCHMARK {
+        committedSpy.clear();
+        for (int i = 0; i < 100; ++i) {
+            s->attachBuffer(buffer);
+            s->damage(QRect(i % 90, 0, 10, 10));
+            s->commit(Surface::CommitFlag::None);
+        }
+        wl_display_flush(m_connection->display());
+        QTRY_COMPARE(committedSpy.count(), 100);
+    }
+}
+
 QTEST_GUILESS_MAIN(TestWaylandSurface)
 #include "test_wayland_surface.moc"
@@ -44,6 +44,7 @@ private Q_SLOTS:
     void testConnectNoSocket();
     void testOutputManagement();
     void testAutoSocketName();
+    void testScheduleFlush();
 };
 
 void TestWaylandServerDisplay::testSocketName()
@@ -239,6 +240,43 @@ void TestWaylandServerDisplay::testAutoSocketName()
     QCOMPARE(display1.socketName(), QStringLiteral("wayland-1"));
 }
 
+void TestWaylandServerDisplay::testScheduleFlush()
+{
+    // this test verifies that scheduled flushes are deferred to the event loop
+    Display display;
+    display.start(Display::StartMode::ConnectClientsOnly);
+    QVERIFY(display.isRunning());
+
+    int sv[2];
+    QVERIFY(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) >= 0);
+    auto client = display.createClient(sv[0]);
+    QVERIFY(client);
+
+    // a server created callback to have an event to send
+    wl_resource *callback = client->createResource(&wl_callback_interface, 1, 0);
+    QVERIFY(callback);
+    char buffer[64];
+    auto receive = [&sv, &buffer] {
+        return recv(sv[1], buffer, sizeof(buffer), MSG_DONTWAIT);
+    };
+
+    wl_callback_send_done(callback, 1);
+    client->scheduleFlush();
+    client->scheduleFlush();
+    QCOMPARE(receive(), ssize_t(-1));
+    // the event loop flushes the client
+    QTRY_VERIFY(receive() > 0);
+
+    // flush sends the events right away
+    wl_callback_send_done(callback, 2);
+    client->flush();
+    QVERIFY(receive() > 0);
+
+    wl_resource_destroy(callback);
+    wl_client_destroy(client->client());
+    close(sv[0]);
+    close(sv[1]);
+}
 
 QTEST_GUILESS_MAIN(TestWaylandServerDisplay)
 #include "test_display.moc"
@@ -0,0 +1,467 @@
+/********************************************************************
+Copyright 2020  agent <agent@local>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) version 3, or any
+later version accepted by the membership of KDE e.V. (or its
+successor approved by the membership of KDE e.V.), which shall
+act as a proxy defined in Section 6 of version 3 of the license.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+// Qt
+#include <QtTest>
+#include <QRandomGenerator>
+// KWayland
+#include "../../src/shared/pixelconverter_p.h"
+// Wayland
+#include <wayland-server-protocol.h>
+
+using namespace KWayland;
+
+Q_DECLARE_METATYPE(PixelConverter::Implementation)
+
+// not yet in all supported versions of wayland-server-protocol.h
+static const quint32 s_argb16161616f = 0x48345241;
+static const quint32 s_xrgb16161616f = 0x48345258;
+static const quint32 s_abgr16161616f = 0x48344241;
+static const quint32 s_xbgr16161616f = 0x48344258;
+
+class TestPixelConverter : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testUnsupportedFormat();
+    void testImplementations();
+    void testQImage_data();
+    void testQImage();
+    void testSimd_data();
+    void testSimd();
+    void testHalfFloat();
+    void testFromQImage_data();
+    void testFromQImage();
+    void testFromQImageSimd_data();
+    void testFromQImageSimd();
+    void benchmarkQImage_data();
+    void benchmarkQImage();
+    void benchmarkConverter_data();
+    void benchmarkConverter();
+    void benchmarkFromQImageBaseline();
+    void benchmarkFromQImage_data();
+    void benchmarkFromQImage();
+};
+
+static QImage createRandomImage(const QSize &size, QImage::Format format)
+{
+    // random premultiplied pixels, converted into the format of the wl_shm buffer
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            line[x] = qPremultiply(QRandomGenerator::global()->generate());
+        }
+    }
+    return image.convertToFormat(format);
+}
+
+static QImage createRandomStraightImage(const QSize &size, QImage::Format format)
+{
+    // random non-premultiplied pixels, including fully transparent and opaque ones
+    QImage image(size, QImage::Format_ARGB32);
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            line[x] = QRandomGenerator::global()->generate();
+            if (x % 5 == 0) {
+                line[x] &= 0x00ffffff;
+            } else if (x % 5 == 1) {
+                line[x] |= 0xff000000;
+            }
+        }
+    }
+    return image.convertToFormat(format);
+}
+
+static QByteArray createRandomBytes(int size)
+{
+    QByteArray bytes(size, Qt::Uninitialized);
+    for (int i = 0; i < size; ++i) {
+        bytes[i] = char(QRandomGenerator::global()->bounded(256));
+    }
+    return bytes;
+}
+
+static QByteArray createRandomHalfFloats(int count)
+{
+    // mostly in the range [0, 1], including negative values and values larger than 1
+    QByteArray bytes(count * 2, Qt::Uninitialized);
+    quint16 *data = reinterpret_cast<quint16*>(bytes.data());
+    for (int i = 0; i < count; ++i) {
+        data[i] = quint16(QRandomGenerator::global()->bounded(0x3e00));
+        if (i % 7 == 0) {
+            data[i] |= 0x8000;
+        }
+    }
+    return bytes;
+}
+
+void TestPixelConverter::testUnsupportedFormat()
+{
+    PixelConverter invalid;
+    QVERIFY(!invalid.isValid());
+    QCOMPARE(invalid.imageFormat(), QImage::Format_Invalid);
+
+    PixelConverter yuv(WL_SHM_FORMAT_NV12);
+    QVERIFY(!yuv.isValid());
+    QCOMPARE(yuv.bytesPerPixel(), 0);
+    QCOMPARE(yuv.imageFormat(), QImage::Format_Invalid);
+
+    PixelConverter argb(WL_SHM_FORMAT_ARGB8888);
+    QVERIFY(argb.isValid());
+    QCOMPARE(argb.bytesPerPixel(), 4);
+    QVERIFY(argb.hasAlphaChannel());
+    QCOMPARE(argb.imageFormat(), QImage::Format_ARGB32_Premultiplied);
+
+    PixelConverter rgb565(WL_SHM_FORMAT_RGB565);
+    QVERIFY(rgb565.isValid());
+    QCOMPARE(rgb565.bytesPerPixel(), 2);
+    QVERIFY(!rgb565.hasAlphaChannel());
+    QCOMPARE(rgb565.imageFormat(), QImage::Format_RGB32);
+
+    PixelConverter halfFloat(s_argb16161616f);
+    QVERIFY(halfFloat.isValid());
+    QCOMPARE(halfFloat.bytesPerPixel(), 8);
+    QVERIFY(halfFloat.hasAlphaChannel());
+
+    PixelConverter rgb16(QImage::Format_RGB16);
+    QVERIFY(!rgb16.isValid());
+    QCOMPARE(rgb16.imageFormat(), QImage::Format_Invalid);
+
+    PixelConverter fromArgb(QImage::Format_ARGB32);
+    QVERIFY(fromArgb.isValid());
+    QCOMPARE(fromArgb.imageFormat(), QImage::Format_ARGB32);
+    QCOMPARE(fromArgb.format(), quint32(WL_SHM_FORMAT_ARGB8888));
+    QCOMPARE(fromArgb.bytesPerPixel(), 4);
+}
+
+void TestPixelConverter::testImplementations()
+{
+    const auto implementations = PixelConverter::supportedImplementations();
+    QVERIFY(!implementations.isEmpty());
+    QCOMPARE(implementations.first(), PixelConverter::Implementation::Scalar);
+    QCOMPARE(implementations.last(), PixelConverter::bestImplementation());
+}
+
+void TestPixelConverter::testQImage_data()
+{
+    QTest::addColumn<quint32>("shmFormat");
+    QTest::addColumn<int>("imageFormat");
+
+    QTest::newRow("argb8888") << quint32(WL_SHM_FORMAT_ARGB8888) << int(QImage::Format_ARGB32_Premultiplied);
+    QTest::newRow("xrgb8888") << quint32(WL_SHM_FORMAT_XRGB8888) << int(QImage::Format_RGB32);
+    QTest::newRow("abgr8888") << quint32(WL_SHM_FORMAT_ABGR8888) << int(QImage::Format_RGBA8888_Premultiplied);
+    QTest::newRow("xbgr8888") << quint32(WL_SHM_FORMAT_XBGR8888) << int(QImage::Format_RGBX8888);
+    QTest::newRow("rgb565") << quint32(WL_SHM_FORMAT_RGB565) << int(QImage::Format_RGB16);
+    QTest::newRow("argb2101010") << quint32(WL_SHM_FORMAT_ARGB2101010) << int(QImage::Format_A2RGB30_Premultiplied);
+    QTest::newRow("xrgb2101010") << quint32(WL_SHM_FORMAT_XRGB2101010) << int(QImage::Format_RGB30);
+    QTest::newRow("abgr2101010") << quint32(WL_SHM_FORMAT_ABGR2101010) << int(QImage::Format_A2BGR30_Premultiplied);
+    QTest::newRow("xbgr2101010") << quint32(WL_SHM_FORMAT_XBGR2101010) << int(QImage::Format_BGR30);
+}
+
+void TestPixelConverter::testQImage()
+{
+    // all implementations need to produce the same result as QImage, within rounding differences
+    QFETCH(quint32, shmFormat);
+    QFETCH(int, imageFormat);
+    // odd width to cover the scalar tail of the vectorized implementations
+    const QImage source = createRandomImage(QSize(67, 5), QImage::Format(imageFormat));
+
+    const auto implementations = PixelConverter::supportedImplementations();
+    for (auto implementation : implementations) {
+        PixelConverter converter(shmFormat, implementation);
+        QVERIFY(converter.isValid());
+        const QImage expected = source.convertToFormat(converter.imageFormat());
+        QImage converted(source.size(), converter.imageFormat());
+        for (int y = 0; y < source.height(); ++y) {
+            converter.convertRow(converted.scanLine(y), source.constScanLine(y), source.width());
+        }
+        for (int y = 0; y < source.height(); ++y) {
+            for (int x = 0; x < source.width(); ++x) {
+                const QRgb e = expected.pixel(x, y);
+                const QRgb c = converted.pixel(x, y);
+                QVERIFY(qAbs(qRed(e) - qRed(c)) <= 1);
+                QVERIFY(qAbs(qGreen(e) - qGreen(c)) <= 1);
+                QVERIFY(qAbs(qBlue(e) - qBlue(c)) <= 1);
+                QVERIFY(qAbs(qAlpha(e) - qAlpha(c)) <= 1);
+            }
+        }
+    }
+}
+
+void TestPixelConverter::testSimd_data()
+{
+    QTest::addColumn<quint32>("shmFormat");
+    QTest::addColumn<PixelConverter::Implementation>("implementation");
+
+    const QVector<QPair<QByteArray, quint32>> formats{
+        {QByteArrayLiteral("xrgb8888"), WL_SHM_FORMAT_XRGB8888},
+        {QByteArrayLiteral("abgr8888"), WL_SHM_FORMAT_ABGR8888},
+        {QByteArrayLiteral("xbgr8888"), WL_SHM_FORMAT_XBGR8888},
+        {QByteArrayLiteral("rgb565"), WL_SHM_FORMAT_RGB565},
+        {QByteArrayLiteral("argb2101010"), WL_SHM_FORMAT_ARGB2101010},
+        {QByteArrayLiteral("xrgb2101010"), WL_SHM_FORMAT_XRGB2101010},
+        {QByteArrayLiteral("abgr2101010"), WL_SHM_FORMAT_ABGR2101010},
+        {QByteArrayLiteral("xbgr2101010"), WL_SHM_FORMAT_XBGR2101010},
+        {QByteArrayLiteral("argb16161616f"), s_argb16161616f},
+        {QByteArrayLiteral("xrgb16161616f"), s_xrgb16161616f},
+        {QByteArrayLiteral("abgr16161616f"), s_abgr16161616f},
+        {QByteArrayLiteral("xbgr16161616f"), s_xbgr16161616f}
+    };
+    const auto implementations = PixelConverter::supportedImplementations();
+    for (const auto &format : formats) {
+        for (auto implementation : implementations) {
+            if (implementation == PixelConverter::Implementation::Scalar) {
+                continue;
+            }
+            const QByteArray name = format.first + QByteArrayLiteral("/") + QByteArray::number(int(implementation));
+            QTest::newRow(name.constData()) << format.second << implementation;
+        }
+    }
+}
+
+void TestPixelConverter::testSimd()
+{
+    // the vectorized implementations need to be identical to the scalar one, float rounding aside
+    QFETCH(quint32, shmFormat);
+    QFETCH(PixelConverter::Implementation, implementation);
+    PixelConverter scalar(shmFormat, PixelConverter::Implementation::Scalar);
+    PixelConverter converter(shmFormat, implementation);
+    QVERIFY(scalar.isValid());
+    QVERIFY(converter.isValid());
+
+    const bool halfFloat = scalar.bytesPerPixel() == 8;
+    for (int width : {1, 3, 16, 33, 101}) {
+        const QByteArray source = halfFloat ? createRandomHalfFloats(width * 4) : createRandomBytes(width * scalar.bytesPerPixel());
+        QByteArray expected(width * 4, 0);
+        QByteArray converted(width * 4, 0);
+        scalar.convertRow(reinterpret_cast<uchar*>(expected.data()), reinterpret_cast<const uchar*>(source.constData()), width);
+        converter.convertRow(reinterpret_cast<uchar*>(converted.data()), reinterpret_cast<const uchar*>(source.constData()), width);
+        if (!halfFloat) {
+            QCOMPARE(converted, expected);
+            continue;
+        }
+        for (int i = 0; i < expected.size(); ++i) {
+            QVERIFY(qAbs(int(uchar(expected.at(i))) - int(uchar(converted.at(i)))) <= 1);
+        }
+    }
+}
+
+void TestPixelConverter::testHalfFloat()
+{
+    // blue 0.5, green 1.0, red 2.0, alpha NaN - followed by -1.0, 0.0, 0.25, 1.0
+    const quint16 source[] = {0x3800, 0x3c00, 0x4000, 0x7e00, 0xbc00, 0x0000, 0x3400, 0x3c00};
+    for (auto implementation : PixelConverter::supportedImplementations()) {
+        PixelConverter argb(s_argb16161616f, implementation);
+        QRgb converted[2];
+        argb.convertRow(reinterpret_cast<uchar*>(converted), reinterpret_cast<const uchar*>(source), 2);
+        QCOMPARE(converted[0], qRgba(255, 255, 128, 0));
+        QCOMPARE(converted[1], qRgba(64, 0, 0, 255));
+
+        PixelConverter xbgr(s_xbgr16161616f, implementation);
+        xbgr.convertRow(reinterpret_cast<uchar*>(converted), reinterpret_cast<const uchar*>(source), 2);
+        QCOMPARE(converted[0], qRgba(128, 255, 255, 255));
+        QCOMPARE(converted[1], qRgba(0, 0, 64, 255));
+    }
+}
+
+void TestPixelConverter::testFromQImage_data()
+{
+    QTest::addColumn<int>("imageFormat");
+
+    QTest::newRow("argb32") << int(QImage::Format_ARGB32);
+    QTest::newRow("argb32 premultiplied") << int(QImage::Format_ARGB32_Premultiplied);
+    QTest::newRow("rgb32") << int(QImage::Format_RGB32);
+    QTest::newRow("rgba8888") << int(QImage::Format_RGBA8888);
+    QTest::newRow("rgba8888 premultiplied") << int(QImage::Format_RGBA8888_Premultiplied);
+    QTest::newRow("rgbx8888") << int(QImage::Format_RGBX8888);
+}
+
+void TestPixelConverter::testFromQImage()
+{
+    // converting into WL_SHM_FORMAT_ARGB8888 needs to match QImage, within rounding differences
+    QFETCH(int, imageFormat);
+    const QImage source = createRandomStraightImage(QSize(67, 5), QImage::Format(imageFormat));
+    const QImage expected = source.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    const auto implementations = PixelConverter::supportedImplementations();
+    for (auto implementation : implementations) {
+        PixelConverter converter(source.format(), implementation);
+        QVERIFY(converter.isValid());
+        QImage converted(source.size(), QImage::Format_ARGB32_Premultiplied);
+        for (int y = 0; y < source.height(); ++y) {
+            converter.convertRow(converted.scanLine(y), source.constScanLine(y), source.width());
+        }
+        for (int y = 0; y < source.height(); ++y) {
+            for (int x = 0; x < source.width(); ++x) {
+                const QRgb e = expected.pixel(x, y);
+                const QRgb c = converted.pixel(x, y);
+                QVERIFY(qAbs(qRed(e) - qRed(c)) <= 1);
+                QVERIFY(qAbs(qGreen(e) - qGreen(c)) <= 1);
+                QVERIFY(qAbs(qBlue(e) - qBlue(c)) <= 1);
+                QCOMPARE(qAlpha(c), qAlpha(e));
+            }
+        }
+    }
+}
+
+void TestPixelConverter::testFromQImageSimd_data()
+{
+    QTest::addColumn<int>("imageFormat");
+    QTest::addColumn<PixelConverter::Implementation>("implementation");
+
+    const QVector<QPair<QByteArray, QImage::Format>> formats{
+        {QByteArrayLiteral("argb32"), QImage::Format_ARGB32},
+        {QByteArrayLiteral("rgba8888"), QImage::Format_RGBA8888},
+        {QByteArrayLiteral("rgba8888 premultiplied"), QImage::Format_RGBA8888_Premultiplied},
+        {QByteArrayLiteral("rgbx8888"), QImage::Format_RGBX8888}
+    };
+    const auto implementations = PixelConverter::supportedImplementations();
+    for (const auto &format : formats) {
+        for (auto implementation : implementations) {
+            if (implementation == PixelConverter::Implementation::Scalar) {
+                continue;
+            }
+            const QByteArray name = format.first + QByteArrayLiteral("/") + QByteArray::number(int(implementation));
+            QTest::newRow(name.constData()) << int(format.second) << implementation;
+        }
+    }
+}
+
+void TestPixelConverter::testFromQImageSimd()
+{
+    // the vectorized implementations need to be identical to the scalar one
+    QFETCH(int, imageFormat);
+    QFETCH(PixelConverter::Implementation, implementation);
+    PixelConverter scalar(QImage::Format(imageFormat), PixelConverter::Implementation::Scalar);
+    PixelConverter converter(QImage::Format(imageFormat), implementation);
+    QVERIFY(scalar.isValid());
+    QVERIFY(converter.isValid());
+
+    for (int width : {1, 3, 16, 33, 101}) {
+        const QByteArray source = createRandomBytes(width * 4);
+        QByteArray expected(width * 4, 0);
+        QByteArray converted(width * 4, 0);
+        scalar.convertRow(reinterpret_cast<uchar*>(expected.data()), reinterpret_cast<const uchar*>(source.constData()), width);
+        converter.convertRow(reinterpret_cast<uchar*>(converted.data()), reinterpret_cast<const uchar*>(source.constData()), width);
+        QCOMPARE(converted, expected);
+    }
+}
+
+void TestPixelConverter::benchmarkQImage_data()
+{
+    QTest::addColumn<int>("imageFormat");
+    QTest::addColumn<int>("targetFormat");
+
+    QTest::newRow("abgr8888") << int(QImage::Format_RGBA8888_Premultiplied) << int(QImage::Format_ARGB32_Premultiplied);
+    QTest::newRow("xbgr8888") << int(QImage::Format_RGBX8888) << int(QImage::Format_RGB32);
+    QTest::newRow("rgb565") << int(QImage::Format_RGB16) << int(QImage::Format_RGB32);
+    QTest::newRow("argb2101010") << int(QImage::Format_A2RGB30_Premultiplied) << int(QImage::Format_ARGB32_Premultiplied);
+    QTest::newRow("xrgb2101010") << int(QImage::Format_RGB30) << int(QImage::Format_RGB32);
+}
+
+void TestPixelConverter::benchmarkQImage()
+{
+    // baseline for benchmarkConverter
+    QFETCH(int, imageFormat);
+    QFETCH(int, targetFormat);
+    const QImage source = createRandomImage(QSize(1920, 1080), QImage::Format(imageFormat));
+    QBENCHMARK {
+        const QImage converted = source.convertToFormat(QImage::Format(targetFormat));
+        Q_UNUSED(converted)
+    }
+}
+
+void TestPixelConverter::benchmarkConverter_data()
+{
+    QTest::addColumn<quint32>("shmFormat");
+    QTest::addColumn<PixelConverter::Implementation>("implementation");
+
+    const QVector<QPair<QByteArray, quint32>> formats{
+        {QByteArrayLiteral("abgr8888"), WL_SHM_FORMAT_ABGR8888},
+        {QByteArrayLiteral("xbgr8888"), WL_SHM_FORMAT_XBGR8888},
+        {QByteArrayLiteral("rgb565"), WL_SHM_FORMAT_RGB565},
+        {QByteArrayLiteral("argb2101010"), WL_SHM_FORMAT_ARGB2101010},
+        {QByteArrayLiteral("xrgb2101010"), WL_SHM_FORMAT_XRGB2101010},
+        {QByteArrayLiteral("argb16161616f"), s_argb16161616f}
+    };
+    const auto implementations = PixelConverter::supportedImplementations();
+    for (const auto &format : formats) {
+        for (auto implementation : implementations) {
+            const QByteArray name = format.first + QByteArrayLiteral("/") + QByteArray::number(int(implementation));
+            QTest::newRow(name.constData()) << format.second << implementation;
+        }
+    }
+}
+
+void TestPixelConverter::benchmarkConverter()
+{
+    QFETCH(quint32, shmFormat);
+    QFETCH(PixelConverter::Implementation, implementation);
+    PixelConverter converter(shmFormat, implementation);
+    QVERIFY(converter.isValid());
+    const QSize size(1920, 1080);
+    const int stride = size.width() * converter.bytesPerPixel();
+    const QByteArray source = createRandomBytes(stride * size.height());
+    QImage converted(size, converter.imageFormat());
+    QBENCHMARK {
+        for (int y = 0; y < size.height(); ++y) {
+            converter.convertRow(converted.scanLine(y), reinterpret_cast<const uchar*>(source.constData()) + y * stride, size.width());
+        }
+    }
+}
+
+void TestPixelConverter::benchmarkFromQImageBaseline()
+{
+    // baseline for benchmarkFromQImage
+    const QImage source = createRandomStraightImage(QSize(1920, 1080), QImage::Format_ARGB32);
+    QBENCHMARK {
+        const QImage converted = source.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        Q_UNUSED(converted)
+    }
+}
+
+void TestPixelConverter::benchmarkFromQImage_data()
+{
+    QTest::addColumn<PixelConverter::Implementation>("implementation");
+
+    const auto implementations = PixelConverter::supportedImplementations();
+    for (auto implementation : implementations) {
+        const QByteArray name = QByteArrayLiteral("argb32/") + QByteArray::number(int(implementation));
+        QTest::newRow(name.constData()) << implementation;
+    }
+}
+
+void TestPixelConverter::benchmarkFromQImage()
+{
+    QFETCH(PixelConverter::Implementation, implementation);
+    const QImage source = createRandomStraightImage(QSize(1920, 1080), QImage::Format_ARGB32);
+    PixelConverter converter(source.format(), implementation);
+    QVERIFY(converter.isValid());
+    QImage converted(source.size(), QImage::Format_ARGB32_Premultiplied);
+    QBENCHMARK {
+        for (int y = 0; y < source.height(); ++y) {
+            converter.convertRow(converted.scanLine(y), source.constScanLine(y), source.width());
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(TestPixelConverter)
+#include "test_pixel_converter.moc"
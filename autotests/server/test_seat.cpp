@@ -20,12 +20,164 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 // Qt
 #include <QtTest>
 // WaylandServer
+#include "../../src/server/clientconnection.h"
+#include "../../src/server/compositor_interface.h"
 #include "../../src/server/display.h"
 #include "../../src/server/pointer_interface.h"
 #include "../../src/server/seat_interface.h"
+#include "../../src/server/surface_interface.h"
+// Wayland
+#include <wayland-client.h>
+// system
+#include <sys/socket.h>
+#include <sys/types.h>
 
 using namespace KWayland::Server;
 
+namespace
+{
+
+struct SeatClient
+{
+    ClientConnection *connection = nullptr;
+    int fd = -1;
+    wl_display *display = nullptr;
+    wl_registry *registry = nullptr;
+    wl_seat *seat = nullptr;
+    wl_pointer *pointer = nullptr;
+    wl_keyboard *keyboard = nullptr;
+    wl_compositor *compositor = nullptr;
+    wl_surface *surface = nullptr;
+    quint32 seatName = 0;
+    quint32 compositorName = 0;
+};
+
+void registryHandleGlobal(void *data, wl_registry *registry, uint32_t name, const char *interface, uint32_t version)
+{
+    Q_UNUSED(registry)
+    Q_UNUSED(version)
+    SeatClient *client = reinterpret_cast<SeatClient*>(data);
+    if (qstrcmp(interface, wl_seat_interface.name) == 0) {
+        client->seatName = name;
+    } else if (qstrcmp(interface, wl_compositor_interface.name) == 0) {
+        client->compositorName = name;
+    }
+}
+
+void registryHandleGlobalRemove(void *data, wl_registry *registry, uint32_t name)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(registry)
+    Q_UNUSED(name)
+}
+
+const wl_registry_listener s_registryListener = {
+    registryHandleGlobal,
+    registryHandleGlobalRemove
+};
+
+/**
+ * Connects raw wayland clients to the Display which all bind a pointer and a keyboard.
+ * The server is dispatched manually in the same thread.
+ **/
+class SeatClients
+{
+public:
+    explicit SeatClients(Display *display)
+        : m_display(display)
+    {
+    }
+    ~SeatClients() {
+        for (auto &client : clients) {
+            if (client.surface) {
+                wl_surface_destroy(client.surface);
+            }
+            if (client.compositor) {
+                wl_compositor_destroy(client.compositor);
+            }
+            if (client.keyboard) {
+                wl_keyboard_destroy(client.keyboard);
+            }
+            if (client.pointer) {
+                wl_pointer_destroy(client.pointer);
+            }
+            if (client.seat) {
+                wl_seat_destroy(client.seat);
+            }
+            if (client.registry) {
+                wl_registry_destroy(client.registry);
+            }
+            if (client.display) {
+                wl_display_disconnect(client.display);
+            }
+        }
+    }
+
+    bool connect(int count) {
+        clients.resize(count);
+        for (auto &client : clients) {
+            int sv[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0) {
+                return false;
+            }
+            client.connection = m_display->createClient(sv[0]);
+            client.fd = sv[1];
+            client.display = wl_display_connect_to_fd(client.fd);
+            if (!client.connection || !client.display) {
+                return false;
+            }
+            client.registry = wl_display_get_registry(client.display);
+            wl_registry_add_listener(client.registry, &s_registryListener, &client);
+            wl_display_flush(client.display);
+        }
+        dispatchServer();
+        for (auto &client : clients) {
+            if (wl_display_dispatch(client.display) < 0 || client.seatName == 0 || client.compositorName == 0) {
+                return false;
+            }
+            client.seat = reinterpret_cast<wl_seat*>(wl_registry_bind(client.registry, client.seatName, &wl_seat_interface, 1));
+            client.pointer = wl_seat_get_pointer(client.seat);
+            client.keyboard = wl_seat_get_keyboard(client.seat);
+            wl_display_flush(client.display);
+        }
+        dispatchServer();
+        return true;
+    }
+
+    SurfaceInterface *createSurface(SeatClient &client) {
+        client.compositor = reinterpret_cast<wl_compositor*>(wl_registry_bind(client.registry, client.compositorName, &wl_compositor_interface, 1));
+        client.surface = wl_compositor_create_surface(client.compositor);
+        wl_display_flush(client.display);
+        dispatchServer();
+        return SurfaceInterface::get(wl_proxy_get_id(reinterpret_cast<wl_proxy*>(client.surface)), client.connection);
+    }
+
+    void dispatchServer() {
+        // the event loop handles at most 32 sources per dispatch
+        for (int i = 0; i <= clients.count() / 32 + 1; ++i) {
+            m_display->dispatchEvents(0);
+        }
+        wl_display_flush_clients(*m_display);
+    }
+
+    /**
+     * Flushes the events to the clients and discards them, so the socket buffers never fill up.
+     **/
+    void drain(const SeatClient &client) {
+        wl_display_flush_clients(*m_display);
+        char buffer[4096];
+        while (recv(client.fd, buffer, sizeof(buffer), MSG_DONTWAIT) > 0) {
+        }
+    }
+
+    QVector<SeatClient> clients;
+
+private:
+    Display *m_display;
+};
+
+}
+
 
 class TestWaylandServerSeat : public QObject
 {
@@ -38,6 +190,10 @@ private Q_SLOTS:
     void testDestroyThroughTerminate();
     void testRepeatInfo();
     void testMultiple();
+    void testPressedKeys();
+    void benchmarkPointerMotion_data();
+    void benchmarkPointerMotion();
+    void benchmarkFocusChange();
 };
 
 static const QString s_socketName = QStringLiteral("kwin-wayland-server-seat-test-0");
@@ -230,5 +386,126 @@ void TestWaylandServerSeat::testMultiple()
     QCOMPARE(display.seats().count(), 0);
 }
 
+void TestWaylandServerSeat::testPressedKeys()
+{
+    Display display;
+    display.setSocketName(s_socketName);
+    display.start();
+    SeatInterface *seat = display.createSeat();
+    QVERIFY(seat->pressedKeys().isEmpty());
+
+    // keys are reported in the order they got pressed
+    seat->keyPressed(37);
+    seat->keyPressed(32);
+    seat->keyPressed(18);
+    QCOMPARE(seat->pressedKeys(), QVector<quint32>({37, 32, 18}));
+
+    // pressing a pressed key again does not change anything
+    seat->keyPressed(32);
+    QCOMPARE(seat->pressedKeys(), QVector<quint32>({37, 32, 18}));
+
+    seat->keyReleased(32);
+    QCOMPARE(seat->pressedKeys(), QVector<quint32>({37, 18}));
+    seat->keyReleased(32);
+    QCOMPARE(seat->pressedKeys(), QVector<quint32>({37, 18}));
+
+    // a copy of the pressed keys is not affected by later changes
+    const QVector<quint32> keys = seat->pressedKeys();
+    seat->keyPressed(32);
+    QCOMPARE(keys, QVector<quint32>({37, 18}));
+    QCOMPARE(seat->pressedKeys(), QVector<quint32>({37, 18, 32}));
+
+    // key codes outside of the evdev range are supported as well
+    seat->keyPressed(0x1000);
+    QCOMPARE(seat->pressedKeys(), QVector<quint32>({37, 18, 32, 0x1000}));
+    seat->keyReleased(0x1000);
+    seat->keyReleased(37);
+    seat->keyReleased(18);
+    seat->keyReleased(32);
+    QVERIFY(seat->pressedKeys().isEmpty());
+}
+
+void TestWaylandServerSeat::benchmarkPointerMotion_data()
+{
+    QTest::addColumn<int>("clients");
+
+    QTest::newRow("1") << 1;
+    QTest::newRow("10") << 10;
+    QTest::newRow("100") << 100;
+}
+
+void TestWaylandServerSeat::benchmarkPointerMotion()
+{
+    // every client binds a pointer, only the first one has pointer focus
+    // the cost of a motion event should not depend on the number of clients
+    QFETCH(int, clients);
+    Display display;
+    display.setSocketName(s_socketName);
+    display.start();
+    SeatInterface *seat = display.createSeat();
+    seat->setHasPointer(true);
+    seat->create();
+    CompositorInterface *compositor = display.createCompositor();
+    compositor->create();
+
+    SeatClients seatClients(&display);
+    QVERIFY(seatClients.connect(clients));
+    SeatClient &focused = seatClients.clients.first();
+    SurfaceInterface *surface = seatClients.createSurface(focused);
+    QVERIFY(surface);
+    seat->setFocusedPointerSurface(surface);
+    QVERIFY(seat->focusedPointer());
+    seatClients.drain(focused);
+
+    qreal x = 0;
+    QBENCHMARK {
+        for (int i = 0; i < 100; ++i) {
+            seat->setPointerPos(QPointF(x, 0));
+            x += 1;
+        }
+        seatClients.drain(focused);
+    }
+}
+
+void TestWaylandServerSeat::benchmarkFocusChange()
+{
+    // 200 clients bind a pointer and a keyboard, focus alternates between two of them
+    // the cost of a focus change should only depend on the devices of the involved clients
+    Display display;
+    display.setSocketName(s_socketName);
+    display.start();
+    SeatInterface *seat = display.createSeat();
+    seat->setHasPointer(true);
+    seat->setHasKeyboard(true);
+    seat->create();
+    CompositorInterface *compositor = display.createCompositor();
+    compositor->create();
+
+    SeatClients seatClients(&display);
+    QVERIFY(seatClients.connect(200));
+    SeatClient &first = seatClients.clients.first();
+    SeatClient &last = seatClients.clients.last();
+    SurfaceInterface *firstSurface = seatClients.createSurface(first);
+    QVERIFY(firstSurface);
+    SurfaceInterface *lastSurface = seatClients.createSurface(last);
+    QVERIFY(lastSurface);
+
+    seat->setFocusedKeyboardSurface(firstSurface);
+    QVERIFY(seat->focusedKeyboard());
+    seat->setFocusedPointerSurface(firstSurface);
+    QVERIFY(seat->focusedPointer());
+
+    QBENCHMARK {
+        for (int i = 0; i < 50; ++i) {
+            seat->setFocusedKeyboardSurface(lastSurface);
+            seat->setFocusedPointerSurface(lastSurface);
+            seat->setFocusedKeyboardSurface(firstSurface);
+            seat->setFocusedPointerSurface(firstSurface);
+        }
+        seatClients.drain(first);
+        seatClients.drain(last);
+    }
+}
+
 QTEST_GUILESS_MAIN(TestWaylandServerSeat)
 #include "test_seat.moc"
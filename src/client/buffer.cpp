@@ -20,6 +20,10 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include "buffer.h"
 #include "buffer_p.h"
 #include "shm_pool.h"
+#include "../shared/pixelconverter_p.h"
+// Qt
+#include <QImage>
+#include <QRegion>
 // system
 #include <string.h>
 // wayland
@@ -79,6 +83,30 @@ void Buffer::copy(const void *src)
     memcpy(address(), src, d->size.height()*d->stride);
 }
 
+void Buffer::copy(const QImage &image, const QRegion &region)
+{
+    const QRegion clipped = region.intersected(QRect(QPoint(0, 0), d->size).intersected(image.rect()));
+    if (clipped.isEmpty()) {
+        return;
+    }
+    uchar *destination = address();
+    const PixelConverter converter(image.format());
+    for (const QRect &rect : clipped) {
+        if (converter.isValid()) {
+            for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                converter.convertRow(destination + y * d->stride + rect.x() * 4,
+                                     image.constScanLine(y) + rect.x() * 4, rect.width());
+            }
+            continue;
+        }
+        // no row converter for this format, let QImage convert the rectangle
+        const QImage converted = image.copy(rect).convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        for (int y = 0; y < converted.height(); ++y) {
+            memcpy(destination + (rect.y() + y) * d->stride + rect.x() * 4, converted.constScanLine(y), rect.width() * 4);
+        }
+    }
+}
+
 uchar *Buffer::address()
 {
     return reinterpret_cast<uchar*>(d->shm->poolAddress()) + d->offset;
@@ -28,6 +28,9 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 
 struct wl_buffer;
 
+class QImage;
+class QRegion;
+
 namespace KWayland
 {
 namespace Client
@@ -58,6 +61,24 @@ public:
      * Copies the data from @p src into the Buffer.
      **/
     void copy(const void *src);
+    /**
+     * Copies the pixels of @p image inside @p region into the Buffer, the rest of the
+     * Buffer is left untouched. The @p region is clipped to the size of the Buffer and
+     * of the @p image.
+     *
+     * The pixels are converted into the premultiplied layout of the Buffer while copying,
+     * so @p image does not need to be in QImage::Format_ARGB32_Premultiplied. Converting
+     * QImage::Format_ARGB32 and the RGBA8888 formats only touches the rows inside
+     * @p region and is vectorized where the CPU supports it.
+     *
+     * Combined with Surface::damageBuffer this allows to only update the changed parts
+     * of a reused Buffer.
+     * @param image The source image, must be at least as large as the copied region
+     * @param region The area to copy, in buffer coordinates
+     * @see Surface::updateBuffer
+     * @since 5.67
+     **/
+    void copy(const QImage &image, const QRegion &region);
     /**
      * Sets the Buffer as @p released.
      * This is automatically invoked when the Wayland server sends the release event.
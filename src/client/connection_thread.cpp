@@ -28,9 +28,15 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include <QMutex>
 #include <QMutexLocker>
 #include <QSocketNotifier>
+#include <QThread>
 #include <qpa/qplatformnativeinterface.h>
 // Wayland
 #include <wayland-client-protocol.h>
+// system
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 
 namespace KWayland
 {
@@ -45,13 +51,27 @@ public:
     ~Private();
     void doInitConnection();
     void setupSocketNotifier();
+    void setupEventReader();
     void setupSocketFileWatcher();
+    /**
+     * Checks the display for an error after reading or dispatching failed.
+     * @returns @c true if the connection is on error and got closed
+     **/
+    bool handleDisplayError();
+    void dispatchDefaultQueue();
+    void eventReaderFailed();
+
+    class EventReader;
 
     wl_display *display = nullptr;
     int fd = -1;
     QString socketName;
     QDir runtimeDir;
     QScopedPointer<QSocketNotifier> socketNotifier;
+    QScopedPointer<EventReader> eventReader;
+    bool readerThreadEnabled = false;
+    // set by the reader thread when it scheduled dispatchDefaultQueue
+    QAtomicInt defaultQueueDispatchScheduled;
     QScopedPointer<QFileSystemWatcher> socketWatcher;
     bool serverDied = false;
     bool foreign = false;
@@ -66,6 +86,101 @@ private:
 QVector<ConnectionThread*> ConnectionThread::Private::connections = QVector<ConnectionThread*>{};
 QMutex ConnectionThread::Private::mutex{QMutex::Recursive};
 
+/**
+ * Reads the Wayland socket in a dedicated thread. It takes part in the read protocol
+ * through a private event queue which never gets any events, so that preparing the read
+ * does not depend on the default queue being dispatched by another thread.
+ **/
+class Q_DECL_HIDDEN ConnectionThread::Private::EventReader : public QThread
+{
+public:
+    EventReader(ConnectionThread::Private *d);
+    ~EventReader() override;
+
+    bool init();
+
+protected:
+    void run() override;
+
+private:
+    ConnectionThread::Private *d;
+    // written to wake up the poll on destruction
+    int m_wakeFds[2] = {-1, -1};
+};
+
+ConnectionThread::Private::EventReader::EventReader(ConnectionThread::Private *d)
+    : d(d)
+{
+    setObjectName(QStringLiteral("KWayland event reader"));
+}
+
+ConnectionThread::Private::EventReader::~EventReader()
+{
+    if (isRunning()) {
+        const char c = 0;
+        while (write(m_wakeFds[1], &c, 1) == -1 && errno == EINTR) {
+        }
+        wait();
+    }
+    for (int fd : m_wakeFds) {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+}
+
+bool ConnectionThread::Private::EventReader::init()
+{
+    return pipe2(m_wakeFds, O_CLOEXEC | O_NONBLOCK) == 0;
+}
+
+void ConnectionThread::Private::EventReader::run()
+{
+    wl_display *display = d->display;
+    // the queued calls may run after the EventReader got deleted, so they must only capture
+    // the Private, which lives as long as their context object
+    ConnectionThread::Private *p = d;
+    wl_event_queue *queue = wl_display_create_queue(display);
+    pollfd fds[2] = {
+        {wl_display_get_fd(display), POLLIN, 0},
+        {m_wakeFds[0], POLLIN, 0}
+    };
+    bool failed = false;
+    while (true) {
+        while (wl_display_prepare_read_queue(display, queue) != 0) {
+            wl_display_dispatch_queue_pending(display, queue);
+        }
+        // requests which do not fit into the socket are flushed by the owners of the queues
+        wl_display_flush(display);
+        fds[0].revents = 0;
+        fds[1].revents = 0;
+        if (poll(fds, 2, -1) == -1) {
+            wl_display_cancel_read(display);
+            if (errno == EINTR) {
+                continue;
+            }
+            failed = true;
+            break;
+        }
+        if (fds[1].revents != 0) {
+            wl_display_cancel_read(display);
+            break;
+        }
+        if (wl_display_read_events(display) == -1) {
+            failed = true;
+            break;
+        }
+        if (d->defaultQueueDispatchScheduled.testAndSetOrdered(0, 1)) {
+            QMetaObject::invokeMethod(p->q, [p] { p->dispatchDefaultQueue(); }, Qt::QueuedConnection);
+        }
+        emit d->q->eventsRead();
+    }
+    wl_event_queue_destroy(queue);
+    if (failed) {
+        QMetaObject::invokeMethod(p->q, [p] { p->eventReaderFailed(); }, Qt::QueuedConnection);
+    }
+}
+
 
 ConnectionThread::Private::Private(ConnectionThread *q)
     : socketName(QString::fromUtf8(qgetenv("WAYLAND_DISPLAY")))
@@ -87,6 +202,7 @@ ConnectionThread::Private::~Private()
         QMutexLocker lock(&mutex);
         connections.removeOne(q);
     }
+    eventReader.reset();
     if (display && !foreign) {
         wl_display_flush(display);
         wl_display_disconnect(display);
@@ -112,7 +228,11 @@ void ConnectionThread::Private::doInitConnection()
     }
 
     // setup socket notifier
-    setupSocketNotifier();
+    if (readerThreadEnabled) {
+        setupEventReader();
+    } else {
+        setupSocketNotifier();
+    }
     setupSocketFileWatcher();
     emit q->connected();
 }
@@ -126,22 +246,65 @@ void ConnectionThread::Private::setupSocketNotifier()
             if (!display) {
                 return;
             }
-            if (wl_display_dispatch(display) == -1) {
-                error = wl_display_get_error(display);
-                if (error != 0) {
-                    if (display) {
-                        free(display);
-                        display = nullptr;
-                    }
-                    emit q->errorOccurred();
-                    return;
-                }
+            if (wl_display_dispatch(display) == -1 && handleDisplayError()) {
+                return;
             }
             emit q->eventsRead();
         }
     );
 }
 
+void ConnectionThread::Private::setupEventReader()
+{
+    eventReader.reset(new EventReader(this));
+    if (!eventReader->init()) {
+        qCWarning(KWAYLAND_CLIENT) << "Failed to create the event reader thread, falling back to a socket notifier";
+        eventReader.reset();
+        setupSocketNotifier();
+        return;
+    }
+    defaultQueueDispatchScheduled.store(0);
+    eventReader->start();
+}
+
+bool ConnectionThread::Private::handleDisplayError()
+{
+    if (!display) {
+        return true;
+    }
+    error = wl_display_get_error(display);
+    if (error == 0) {
+        return false;
+    }
+    // the reader thread must not touch the display anymore
+    eventReader.reset();
+    free(display);
+    display = nullptr;
+    emit q->errorOccurred();
+    return true;
+}
+
+void ConnectionThread::Private::eventReaderFailed()
+{
+    if (handleDisplayError()) {
+        return;
+    }
+    qCWarning(KWAYLAND_CLIENT) << "Event reader thread failed, falling back to a socket notifier";
+    eventReader.reset();
+    setupSocketNotifier();
+}
+
+void ConnectionThread::Private::dispatchDefaultQueue()
+{
+    defaultQueueDispatchScheduled.store(0);
+    if (!display) {
+        return;
+    }
+    if (wl_display_dispatch_pending(display) == -1) {
+        handleDisplayError();
+    }
+}
+
 void ConnectionThread::Private::setupSocketFileWatcher()
 {
     if (!runtimeDir.exists() || fd != -1) {
@@ -156,6 +319,7 @@ void ConnectionThread::Private::setupSocketFileWatcher()
             }
             qCWarning(KWAYLAND_CLIENT) << "Connection to server went away";
             serverDied = true;
+            eventReader.reset();
             if (display) {
                 free(display);
                 display = nullptr;
@@ -208,6 +372,8 @@ ConnectionThread::ConnectionThread(wl_display *display, QObject *parent)
 ConnectionThread::~ConnectionThread()
 {
     disconnect(d->eventDispatcherConnection);
+    // stop emitting eventsRead before this object goes away
+    d->eventReader.reset();
 }
 
 ConnectionThread *ConnectionThread::fromApplication(QObject *parent)
@@ -253,6 +419,20 @@ void ConnectionThread::setSocketFd(int fd)
     d->fd = fd;
 }
 
+void ConnectionThread::setReaderThreadEnabled(bool enabled)
+{
+    if (d->display) {
+        // already initialized
+        return;
+    }
+    d->readerThreadEnabled = enabled;
+}
+
+bool ConnectionThread::isReaderThreadEnabled() const
+{
+    return d->readerThreadEnabled;
+}
+
 wl_display *ConnectionThread::display()
 {
     return d->display;
@@ -93,6 +93,11 @@ namespace Client
  * Furthermore this class flushes the Wayland connection whenever the QAbstractEventDispatcher
  * is about to block.
  *
+ * Alternatively the Wayland socket can be read by a dedicated reader thread, see
+ * @link ::setReaderThreadEnabled @endlink. The events for an EventQueue are then dispatched
+ * directly in the thread of the EventQueue without waiting for the thread of the
+ * ConnectionThread to read the socket first.
+ *
  * To disconnect the connection to the Wayland server one should delete the instance of this
  * class and quit the dedicated thread:
  *
@@ -175,6 +180,32 @@ public:
      **/
     void setSocketFd(int fd);
 
+    /**
+     * Sets whether the Wayland socket is read by a dedicated reader thread instead of a
+     * QSocketNotifier in the thread of this ConnectionThread.
+     * Only applies if called before calling initConnection.
+     *
+     * The reader thread reads the events into their queues using the thread safe
+     * wl_display_prepare_read and wl_display_read_events protocol and emits
+     * @link ::eventsRead @endlink from the reader thread. An EventQueue set up for this
+     * ConnectionThread thus gets woken up in its own thread right away. The events of the
+     * default queue are still dispatched in the thread of this ConnectionThread.
+     *
+     * Receivers of @link ::eventsRead @endlink must not use a Qt::DirectConnection in this
+     * mode. Blocking dispatch functions like wl_display_dispatch or wl_display_roundtrip
+     * keep working as they take part in the same read protocol.
+     *
+     * The default is @c false.
+     * @see isReaderThreadEnabled
+     * @since 5.67
+     **/
+    void setReaderThreadEnabled(bool enabled);
+    /**
+     * @see setReaderThreadEnabled
+     * @since 5.67
+     **/
+    bool isReaderThreadEnabled() const;
+
     /**
      * Trigger a blocking roundtrip to the Wayland server. Ensures that all events are processed
      * before returning to the event loop.
@@ -235,6 +266,8 @@ Q_SIGNALS:
     void failed();
     /**
      * Emitted whenever new events are ready to be read.
+     * If the reader thread is enabled the signal is emitted from the reader thread.
+     * @see setReaderThreadEnabled
      **/
     void eventsRead();
     /**
@@ -20,6 +20,9 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include "event_queue.h"
 #include "connection_thread.h"
 #include "wayland_pointer_p.h"
+// Qt
+#include <QElapsedTimer>
+#include <QPointer>
 
 #include <wayland-client.h>
 
@@ -33,8 +36,17 @@ class Q_DECL_HIDDEN EventQueue::Private
 public:
     Private(EventQueue *q);
 
+    void connectDispatch();
+
     wl_display *display = nullptr;
     WaylandPointer<wl_event_queue, wl_event_queue_destroy> queue;
+    QPointer<ConnectionThread> connection;
+    QMetaObject::Connection dispatchConnection;
+    bool directDispatch = false;
+
+    quint64 dispatchCount = 0;
+    quint64 dispatchedEventCount = 0;
+    qint64 dispatchTime = 0;
 
 private:
     EventQueue *q;
@@ -45,6 +57,17 @@ EventQueue::Private::Private(EventQueue *q)
 {
 }
 
+void EventQueue::Private::connectDispatch()
+{
+    QObject::disconnect(dispatchConnection);
+    if (connection.isNull()) {
+        return;
+    }
+    // an automatic connection calls dispatch directly if the events got read in the thread of this queue
+    dispatchConnection = QObject::connect(connection.data(), &ConnectionThread::eventsRead, q, &EventQueue::dispatch,
+                                          directDispatch ? Qt::AutoConnection : Qt::QueuedConnection);
+}
+
 EventQueue::EventQueue(QObject *parent)
     : QObject(parent)
     , d(new Private(this))
@@ -60,12 +83,16 @@ void EventQueue::release()
 {
     d->queue.release();
     d->display = nullptr;
+    d->connection.clear();
+    disconnect(d->dispatchConnection);
 }
 
 void EventQueue::destroy()
 {
     d->queue.destroy();
     d->display = nullptr;
+    d->connection.clear();
+    disconnect(d->dispatchConnection);
 }
 
 bool EventQueue::isValid()
@@ -85,7 +112,22 @@ void EventQueue::setup(wl_display *display)
 void EventQueue::setup(ConnectionThread *connection)
 {
     setup(connection->display());
-    connect(connection, &ConnectionThread::eventsRead, this, &EventQueue::dispatch, Qt::QueuedConnection);
+    d->connection = connection;
+    d->connectDispatch();
+}
+
+void EventQueue::setDirectDispatchEnabled(bool enabled)
+{
+    if (d->directDispatch == enabled) {
+        return;
+    }
+    d->directDispatch = enabled;
+    d->connectDispatch();
+}
+
+bool EventQueue::isDirectDispatchEnabled() const
+{
+    return d->directDispatch;
 }
 
 void EventQueue::dispatch()
@@ -93,8 +135,38 @@ void EventQueue::dispatch()
     if (!d->display || !d->queue) {
         return;
     }
-    wl_display_dispatch_queue_pending(d->display, d->queue);
-    wl_display_flush(d->display);
+    QElapsedTimer timer;
+    timer.start();
+    const int count = wl_display_dispatch_queue_pending(d->display, d->queue);
+    // without events no handler could have sent a request
+    if (count > 0) {
+        wl_display_flush(d->display);
+        d->dispatchedEventCount += count;
+    }
+    d->dispatchCount++;
+    d->dispatchTime += timer.nsecsElapsed();
+}
+
+quint64 EventQueue::dispatchCount() const
+{
+    return d->dispatchCount;
+}
+
+quint64 EventQueue::dispatchedEventCount() const
+{
+    return d->dispatchedEventCount;
+}
+
+std::chrono::nanoseconds EventQueue::dispatchTime() const
+{
+    return std::chrono::nanoseconds(d->dispatchTime);
+}
+
+void EventQueue::resetStatistics()
+{
+    d->dispatchCount = 0;
+    d->dispatchedEventCount = 0;
+    d->dispatchTime = 0;
 }
 
 void EventQueue::addProxy(wl_proxy *proxy)
@@ -24,6 +24,8 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <KWayland/Client/kwaylandclient_export.h>
 
+#include <chrono>
+
 struct wl_display;
 struct wl_proxy;
 struct wl_event_queue;
@@ -92,6 +94,55 @@ public:
      **/
     void setup(ConnectionThread *connection);
 
+    /**
+     * Sets whether the events get dispatched synchronously while the ConnectionThread
+     * emits eventsRead, if this EventQueue lives in the thread which read the events.
+     * Otherwise dispatching happens in a later iteration of the event loop of the thread
+     * of this EventQueue. An EventQueue living in another thread always gets dispatched
+     * through its event loop.
+     *
+     * This is meant for clients which are sensitive to input latency, e.g. games. Note
+     * that with direct dispatch the event handlers run while eventsRead is being emitted.
+     *
+     * Only applies to an EventQueue set up for a ConnectionThread. The default is @c false.
+     * @see isDirectDispatchEnabled
+     * @see setup(ConnectionThread*)
+     * @since 5.67
+     **/
+    void setDirectDispatchEnabled(bool enabled);
+    /**
+     * @see setDirectDispatchEnabled
+     * @since 5.67
+     **/
+    bool isDirectDispatchEnabled() const;
+
+    /**
+     * @returns how often dispatch got called since the EventQueue got created or the
+     * statistics got reset
+     * @see resetStatistics
+     * @since 5.67
+     **/
+    quint64 dispatchCount() const;
+    /**
+     * @returns the number of events dispatched since the EventQueue got created or the
+     * statistics got reset
+     * @see resetStatistics
+     * @since 5.67
+     **/
+    quint64 dispatchedEventCount() const;
+    /**
+     * @returns the time spent in dispatch, including the event handlers, since the
+     * EventQueue got created or the statistics got reset
+     * @see resetStatistics
+     * @since 5.67
+     **/
+    std::chrono::nanoseconds dispatchTime() const;
+    /**
+     * Resets dispatchCount, dispatchedEventCount and dispatchTime to @c 0.
+     * @since 5.67
+     **/
+    void resetStatistics();
+
     /**
      * @returns @c true if EventQueue is setup.
      **/
@@ -136,6 +187,7 @@ public:
 public Q_SLOTS:
     /**
      * Dispatches all pending events on the EventQueue.
+     * The Wayland connection gets flushed afterwards if any events got dispatched.
      **/
     void dispatch();
 
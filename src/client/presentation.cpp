@@ -0,0 +1,312 @@
+/********************************************************************
+Copyright 2020  agent <agent@local>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) version 3, or any
+later version accepted by the membership of KDE e.V. (or its
+successor approved by the membership of KDE e.V.), which shall
+act as a proxy defined in Section 6 of version 3 of the license.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#include "presentation.h"
+#include "event_queue.h"
+#include "output.h"
+#include "surface.h"
+#include "wayland_pointer_p.h"
+// Qt
+#include <QPointer>
+// Wayland
+#include <wayland-presentation-time-client-protocol.h>
+
+// the wp_presentation.feedback request hides the wp_presentation_feedback type,
+// it needs to be referred to as struct wp_presentation_feedback
+
+namespace KWayland
+{
+namespace Client
+{
+
+class Q_DECL_HIDDEN Presentation::Private
+{
+public:
+    Private(Presentation *q);
+
+    void setup(wp_presentation *arg);
+
+    WaylandPointer<wp_presentation, wp_presentation_destroy> presentation;
+    EventQueue *queue = nullptr;
+    clockid_t clockId = CLOCK_MONOTONIC;
+
+private:
+    static void clockIdCallback(void *data, wp_presentation *presentation, uint32_t clockId);
+    static const struct wp_presentation_listener s_listener;
+
+    Presentation *q;
+};
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+const struct wp_presentation_listener Presentation::Private::s_listener = {
+    clockIdCallback
+};
+#endif
+
+Presentation::Private::Private(Presentation *q)
+    : q(q)
+{
+}
+
+void Presentation::Private::clockIdCallback(void *data, wp_presentation *presentation, uint32_t clockId)
+{
+    auto p = reinterpret_cast<Presentation::Private*>(data);
+    Q_ASSERT(p->presentation == presentation);
+    p->clockId = clockid_t(clockId);
+    emit p->q->clockIdChanged();
+}
+
+void Presentation::Private::setup(wp_presentation *arg)
+{
+    Q_ASSERT(arg);
+    Q_ASSERT(!presentation);
+    presentation.setup(arg);
+    wp_presentation_add_listener(presentation, &s_listener, this);
+}
+
+Presentation::Presentation(QObject *parent)
+    : QObject(parent)
+    , d(new Private(this))
+{
+}
+
+Presentation::~Presentation()
+{
+    release();
+}
+
+void Presentation::setup(wp_presentation *presentation)
+{
+    d->setup(presentation);
+}
+
+void Presentation::release()
+{
+    d->presentation.release();
+}
+
+void Presentation::destroy()
+{
+    d->presentation.destroy();
+}
+
+Presentation::operator wp_presentation*() {
+    return d->presentation;
+}
+
+Presentation::operator wp_presentation*() const {
+    return d->presentation;
+}
+
+bool Presentation::isValid() const
+{
+    return d->presentation.isValid();
+}
+
+void Presentation::setEventQueue(EventQueue *queue)
+{
+    d->queue = queue;
+}
+
+EventQueue *Presentation::eventQueue()
+{
+    return d->queue;
+}
+
+clockid_t Presentation::clockId() const
+{
+    return d->clockId;
+}
+
+PresentationFeedback *Presentation::createFeedback(Surface *surface, QObject *parent)
+{
+    Q_ASSERT(isValid());
+    auto p = new PresentationFeedback(parent);
+    auto w = wp_presentation_feedback(d->presentation, *surface);
+    if (d->queue) {
+        d->queue->addProxy(w);
+    }
+    p->setup(w);
+    return p;
+}
+
+class Q_DECL_HIDDEN PresentationFeedback::Private
+{
+public:
+    Private(PresentationFeedback *q);
+
+    void setup(struct wp_presentation_feedback *arg);
+
+    WaylandPointer<struct wp_presentation_feedback, wp_presentation_feedback_destroy> feedback;
+    QVector<QPointer<Output>> syncOutputs;
+    std::chrono::nanoseconds timestamp = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds refresh = std::chrono::nanoseconds::zero();
+    quint64 sequence = 0;
+    Kinds kinds;
+    bool presented = false;
+    bool discarded = false;
+
+private:
+    static void syncOutputCallback(void *data, struct wp_presentation_feedback *feedback, wl_output *output);
+    static void presentedCallback(void *data, struct wp_presentation_feedback *feedback, uint32_t tvSecHi, uint32_t tvSecLo,
+                                  uint32_t tvNsec, uint32_t refresh, uint32_t seqHi, uint32_t seqLo, uint32_t flags);
+    static void discardedCallback(void *data, struct wp_presentation_feedback *feedback);
+    static const struct wp_presentation_feedback_listener s_listener;
+
+    PresentationFeedback *q;
+};
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+const struct wp_presentation_feedback_listener PresentationFeedback::Private::s_listener = {
+    syncOutputCallback,
+    presentedCallback,
+    discardedCallback
+};
+#endif
+
+PresentationFeedback::Private::Private(PresentationFeedback *q)
+    : q(q)
+{
+}
+
+void PresentationFeedback::Private::syncOutputCallback(void *data, struct wp_presentation_feedback *feedback, wl_output *output)
+{
+    auto p = reinterpret_cast<PresentationFeedback::Private*>(data);
+    Q_ASSERT(p->feedback == feedback);
+    if (Output *o = Output::get(output)) {
+        p->syncOutputs << QPointer<Output>(o);
+    }
+}
+
+void PresentationFeedback::Private::presentedCallback(void *data, struct wp_presentation_feedback *feedback, uint32_t tvSecHi, uint32_t tvSecLo,
+                                                      uint32_t tvNsec, uint32_t refresh, uint32_t seqHi, uint32_t seqLo, uint32_t flags)
+{
+    auto p = reinterpret_cast<PresentationFeedback::Private*>(data);
+    Q_ASSERT(p->feedback == feedback);
+    const quint64 seconds = (quint64(tvSecHi) << 32) | tvSecLo;
+    p->timestamp = std::chrono::seconds(seconds) + std::chrono::nanoseconds(tvNsec);
+    p->refresh = std::chrono::nanoseconds(refresh);
+    p->sequence = (quint64(seqHi) << 32) | seqLo;
+    p->kinds = Kinds(QFlag(flags));
+    p->presented = true;
+    // the server destroyed the wp_presentation_feedback after sending the event
+    p->feedback.release();
+    emit p->q->presented();
+}
+
+void PresentationFeedback::Private::discardedCallback(void *data, struct wp_presentation_feedback *feedback)
+{
+    auto p = reinterpret_cast<PresentationFeedback::Private*>(data);
+    Q_ASSERT(p->feedback == feedback);
+    p->discarded = true;
+    p->feedback.release();
+    emit p->q->discarded();
+}
+
+void PresentationFeedback::Private::setup(struct wp_presentation_feedback *arg)
+{
+    Q_ASSERT(arg);
+    Q_ASSERT(!feedback);
+    feedback.setup(arg);
+    wp_presentation_feedback_add_listener(feedback, &s_listener, this);
+}
+
+PresentationFeedback::PresentationFeedback(QObject *parent)
+    : QObject(parent)
+    , d(new Private(this))
+{
+}
+
+PresentationFeedback::~PresentationFeedback()
+{
+    release();
+}
+
+void PresentationFeedback::setup(struct wp_presentation_feedback *feedback)
+{
+    d->setup(feedback);
+}
+
+void PresentationFeedback::release()
+{
+    d->feedback.release();
+}
+
+void PresentationFeedback::destroy()
+{
+    d->feedback.destroy();
+}
+
+PresentationFeedback::operator struct wp_presentation_feedback*() {
+    return d->feedback;
+}
+
+PresentationFeedback::operator struct wp_presentation_feedback*() const {
+    return d->feedback;
+}
+
+bool PresentationFeedback::isValid() const
+{
+    return d->feedback.isValid();
+}
+
+bool PresentationFeedback::isPresented() const
+{
+    return d->presented;
+}
+
+bool PresentationFeedback::isDiscarded() const
+{
+    return d->discarded;
+}
+
+std::chrono::nanoseconds PresentationFeedback::timestamp() const
+{
+    return d->timestamp;
+}
+
+std::chrono::nanoseconds PresentationFeedback::refresh() const
+{
+    return d->refresh;
+}
+
+quint64 PresentationFeedback::sequence() const
+{
+    return d->sequence;
+}
+
+PresentationFeedback::Kinds PresentationFeedback::kinds() const
+{
+    return d->kinds;
+}
+
+QVector<Output*> PresentationFeedback::syncOutputs() const
+{
+    QVector<Output*> outputs;
+    outputs.reserve(d->syncOutputs.count());
+    for (const auto &output : d->syncOutputs) {
+        if (!output.isNull()) {
+            outputs << output.data();
+        }
+    }
+    return outputs;
+}
+
+}
+}
@@ -0,0 +1,295 @@
+/********************************************************************
+Copyright 2020  agent <agent@local>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) version 3, or any
+later version accepted by the membership of KDE e.V. (or its
+successor approved by the membership of KDE e.V.), which shall
+act as a proxy defined in Section 6 of version 3 of the license.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#ifndef KWAYLAND_CLIENT_PRESENTATION_H
+#define KWAYLAND_CLIENT_PRESENTATION_H
+
+#include <QObject>
+#include <QVector>
+
+#include <KWayland/Client/kwaylandclient_export.h>
+
+#include <chrono>
+#include <time.h>
+
+struct wp_presentation;
+struct wp_presentation_feedback;
+
+namespace KWayland
+{
+namespace Client
+{
+
+class EventQueue;
+class Output;
+class PresentationFeedback;
+class Surface;
+
+/**
+ * @short Wrapper for the wp_presentation interface.
+ *
+ * This class provides a convenient wrapper for the wp_presentation interface.
+ * It allows to request feedback about when the content of a Surface commit got
+ * presented, which can be used to pace rendering, e.g. for video playback.
+ *
+ * To use this class one needs to interact with the Registry. There are two
+ * possible ways to create the Presentation interface:
+ * @code
+ * Presentation *p = registry->createPresentation(name, version);
+ * @endcode
+ *
+ * This creates the Presentation and sets it up directly. As an alternative this
+ * can also be done in a more low level way:
+ * @code
+ * Presentation *p = new Presentation;
+ * p->setup(registry->bindPresentation(name, version));
+ * @endcode
+ *
+ * The Presentation can be used as a drop-in replacement for any wp_presentation
+ * pointer as it provides matching cast operators.
+ *
+ * @see Registry
+ * @see PresentationFeedback
+ * @since 5.67
+ **/
+class KWAYLANDCLIENT_EXPORT Presentation : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * Creates a new Presentation.
+     * Note: after constructing the Presentation it is not yet valid and one needs
+     * to call setup. In order to get a ready to use Presentation prefer using
+     * Registry::createPresentation.
+     **/
+    explicit Presentation(QObject *parent = nullptr);
+    virtual ~Presentation();
+
+    /**
+     * Setup this Presentation to manage the @p presentation.
+     * When using Registry::createPresentation there is no need to call this
+     * method.
+     **/
+    void setup(wp_presentation *presentation);
+    /**
+     * @returns @c true if managing a wp_presentation.
+     **/
+    bool isValid() const;
+    /**
+     * Releases the wp_presentation interface.
+     * After the interface has been released the Presentation instance is no
+     * longer valid and can be setup with another wp_presentation interface.
+     **/
+    void release();
+    /**
+     * Destroys the data held by this Presentation.
+     * This method is supposed to be used when the connection to the Wayland
+     * server goes away. If the connection is not valid anymore, it's not
+     * possible to call release anymore as that calls into the Wayland
+     * connection and the call would fail. This method cleans up the data, so
+     * that the instance can be deleted or set up to a new wp_presentation interface
+     * once there is a new connection available.
+     *
+     * It is suggested to connect this method to ConnectionThread::connectionDied:
+     * @code
+     * connect(connection, &ConnectionThread::connectionDied, presentation, &Presentation::destroy);
+     * @endcode
+     *
+     * @see release
+     **/
+    void destroy();
+
+    /**
+     * Sets the @p queue to use for creating objects with this Presentation.
+     **/
+    void setEventQueue(EventQueue *queue);
+    /**
+     * @returns The event queue to use for creating objects with this Presentation.
+     **/
+    EventQueue *eventQueue();
+
+    /**
+     * The clock the timestamps of the PresentationFeedbacks are based on, e.g.
+     * @c CLOCK_MONOTONIC. Use clock_gettime with this clock to compare the timestamps
+     * with the current time. Only valid after clockIdChanged got emitted.
+     * @see clockIdChanged
+     **/
+    clockid_t clockId() const;
+
+    /**
+     * Requests feedback about the presentation of the content submitted with the next
+     * commit of @p surface. The feedback has to be created before calling Surface::commit.
+     * @param surface The Surface to get the presentation feedback for
+     * @param parent The parent object for the PresentationFeedback
+     * @returns The created PresentationFeedback
+     **/
+    PresentationFeedback *createFeedback(Surface *surface, QObject *parent = nullptr);
+
+    operator wp_presentation*();
+    operator wp_presentation*() const;
+
+Q_SIGNALS:
+    /**
+     * Emitted when the server announced the clock used for the presentation timestamps.
+     * @see clockId
+     **/
+    void clockIdChanged();
+    /**
+     * The corresponding global for this interface on the Registry got removed.
+     *
+     * This signal gets only emitted if the Presentation got created by
+     * Registry::createPresentation
+     **/
+    void removed();
+
+private:
+    class Private;
+    QScopedPointer<Private> d;
+};
+
+/**
+ * @short Wrapper for the wp_presentation_feedback interface.
+ *
+ * The PresentationFeedback reports once whether the content of the commit it got
+ * created for has been presented or discarded. Afterwards the server destroys the
+ * wp_presentation_feedback and the PresentationFeedback is no longer valid, but it keeps
+ * the reported values.
+ *
+ * @see Presentation
+ * @since 5.67
+ **/
+class KWAYLANDCLIENT_EXPORT PresentationFeedback : public QObject
+{
+    Q_OBJECT
+public:
+    virtual ~PresentationFeedback();
+
+    /**
+     * Describes how the content got presented, maps to wp_presentation_feedback.kind.
+     **/
+    enum class Kind {
+        /**
+         * The presentation was synchronized to the vertical retrace of the output.
+         **/
+        Vsync = 0x1,
+        /**
+         * The timestamp is provided by the hardware instead of being sampled in software.
+         **/
+        HwClock = 0x2,
+        /**
+         * The hardware signalled the completion of the presentation.
+         **/
+        HwCompletion = 0x4,
+        /**
+         * The buffer got scanned out directly without being copied by the compositor.
+         **/
+        ZeroCopy = 0x8
+    };
+    Q_DECLARE_FLAGS(Kinds, Kind)
+
+    /**
+     * Setup this PresentationFeedback to manage the @p feedback.
+     * When using Presentation::createFeedback there is no need to call this
+     * method.
+     **/
+    void setup(wp_presentation_feedback *feedback);
+    /**
+     * @returns @c true if managing a wp_presentation_feedback, which is the case until
+     * it got presented or discarded.
+     **/
+    bool isValid() const;
+    /**
+     * Releases the wp_presentation_feedback interface.
+     * After the interface has been released the PresentationFeedback instance is no
+     * longer valid and can be setup with another wp_presentation_feedback interface.
+     **/
+    void release();
+    /**
+     * Destroys the data held by this PresentationFeedback.
+     * This method is supposed to be used when the connection to the Wayland
+     * server goes away. If the connection is not valid anymore, it's not
+     * possible to call release anymore as that calls into the Wayland
+     * connection and the call would fail. This method cleans up the data, so
+     * that the instance can be deleted or set up to a new wp_presentation_feedback
+     * interface once there is a new connection available.
+     *
+     * @see release
+     **/
+    void destroy();
+
+    /**
+     * @returns whether the content got presented.
+     * @see presented
+     **/
+    bool isPresented() const;
+    /**
+     * @returns whether the content got discarded without being presented.
+     * @see discarded
+     **/
+    bool isDiscarded() const;
+    /**
+     * The time the content turned into light, in the domain of Presentation::clockId.
+     **/
+    std::chrono::nanoseconds timestamp() const;
+    /**
+     * The duration until the next possible presentation on the output, or @c 0 if the
+     * compositor does not know it.
+     **/
+    std::chrono::nanoseconds refresh() const;
+    /**
+     * The vertical retrace counter of the output the content got presented on. Only
+     * meaningful if kinds contains Kind::Vsync.
+     **/
+    quint64 sequence() const;
+    /**
+     * @returns how the content got presented
+     **/
+    Kinds kinds() const;
+    /**
+     * The Outputs the content got presented on and whose timing the reported values refer to.
+     * Only wl_outputs managed by an Output are reported.
+     **/
+    QVector<Output*> syncOutputs() const;
+
+    operator wp_presentation_feedback*();
+    operator wp_presentation_feedback*() const;
+
+Q_SIGNALS:
+    /**
+     * Emitted when the content got presented, the reported values are available.
+     **/
+    void presented();
+    /**
+     * Emitted when the content got replaced or otherwise never got presented.
+     **/
+    void discarded();
+
+private:
+    friend class Presentation;
+    explicit PresentationFeedback(QObject *parent = nullptr);
+    class Private;
+    QScopedPointer<Private> d;
+};
+
+}
+}
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(KWayland::Client::PresentationFeedback::Kinds)
+
+#endif
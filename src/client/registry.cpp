@@ -59,6 +59,7 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include "server_decoration_palette.h"
 #include "xdgoutput.h"
 #include "xdgdecoration.h"
+#include "presentation.h"
 // Qt
 #include <QDebug>
 // wayland
@@ -93,6 +94,7 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include <wayland-xdg-output-unstable-v1-client-protocol.h>
 #include <wayland-xdg-decoration-unstable-v1-client-protocol.h>
 #include <wayland-keystate-client-protocol.h>
+#include <wayland-presentation-time-client-protocol.h>
 
 /*****
  * How to add another interface:
@@ -386,6 +388,13 @@ static const QMap<Registry::Interface, SuppertedInterfaceData> s_interfaces = {
         &org_kde_kwin_keystate_interface,
         &Registry::keystateAnnounced,
         &Registry::keystateRemoved
+    }},
+    {Registry::Interface::Presentation, {
+        1,
+        QByteArrayLiteral("wp_presentation"),
+        &wp_presentation_interface,
+        &Registry::presentationAnnounced,
+        &Registry::presentationRemoved
     }}
 };
 
@@ -703,6 +712,7 @@ BIND2(AppMenuManager, AppMenu, org_kde_kwin_appmenu_manager)
 BIND2(ServerSideDecorationPaletteManager, ServerSideDecorationPalette, org_kde_kwin_server_decoration_palette_manager)
 BIND(XdgOutputUnstableV1, zxdg_output_manager_v1)
 BIND(XdgDecorationUnstableV1, zxdg_decoration_manager_v1)
+BIND(Presentation, wp_presentation)
 
 #undef BIND
 #undef BIND2
@@ -757,6 +767,7 @@ CREATE2(ShmPool, Shm)
 CREATE(AppMenuManager)
 CREATE(Keystate)
 CREATE(ServerSideDecorationPaletteManager)
+CREATE(Presentation)
 
 #undef CREATE
 #undef CREATE2
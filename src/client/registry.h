@@ -66,6 +66,7 @@ struct zxdg_importer_v2;
 struct zwp_idle_inhibit_manager_v1;
 struct zxdg_output_manager_v1;
 struct zxdg_decoration_manager_v1;
+struct wp_presentation;
 
 namespace KWayland
 {
@@ -90,6 +91,7 @@ class Output;
 class PlasmaShell;
 class PlasmaVirtualDesktopManagement;
 class PlasmaWindowManagement;
+class Presentation;
 class PointerConstraints;
 class PointerGestures;
 class Seat;
@@ -188,6 +190,7 @@ public:
         XdgShellStable, ///refers to xdg_wm_base @since 5.48
         XdgDecorationUnstableV1, ///refers to zxdg_decoration_manager_v1, @since 5.54
         Keystate,///<refers to org_kwin_keystate, @since 5.57
+        Presentation, ///< refers to wp_presentation, @since 5.67
     };
     explicit Registry(QObject *parent = nullptr);
     virtual ~Registry();
@@ -679,6 +682,17 @@ public:
      **/
     zxdg_decoration_manager_v1 *bindXdgDecorationUnstableV1(uint32_t name, uint32_t version) const;
 
+    /**
+     * Binds the wp_presentation with @p name and @p version.
+     * If the @p name does not exist,
+     * @c null will be returned.
+     *
+     * Prefer using createPresentation instead.
+     * @see createPresentation
+     * @since 5.67
+     **/
+    wp_presentation *bindPresentation(uint32_t name, uint32_t version) const;
+
     ///@}
 
     /**
@@ -1251,6 +1265,23 @@ public:
      **/
     XdgDecorationManager *createXdgDecorationManager(quint32 name, quint32 version, QObject *parent = nullptr);
 
+    /**
+     * Creates a Presentation and sets it up to manage the interface identified by
+     * @p name and @p version.
+     *
+     * Note: in case @p name is invalid or isn't for the wp_presentation interface,
+     * the returned Presentation will not be valid. Therefore it's recommended to call
+     * isValid on the created instance.
+     *
+     * @param name The name of the wp_presentation interface to bind
+     * @param version The version or the wp_presentation interface to use
+     * @param parent The parent for Presentation
+     *
+     * @returns The created Presentation.
+     * @since 5.67
+     **/
+    Presentation *createPresentation(quint32 name, quint32 version, QObject *parent = nullptr);
+
     ///@}
 
 
@@ -1528,6 +1559,14 @@ Q_SIGNALS:
      **/
     void xdgDecorationAnnounced(quint32 name, quint32 version);
 
+    /**
+     * Emitted whenever a wp_presentation interface gets announced.
+     * @param name The name for the announced interface
+     * @param version The maximum supported version of the announced interface
+     * @since 5.67
+     **/
+    void presentationAnnounced(quint32 name, quint32 version);
+
     ///@}
 
     /**
@@ -1756,6 +1795,13 @@ Q_SIGNALS:
      **/
     void xdgDecorationRemoved(quint32 name);
 
+    /**
+     * Emitted whenever a wp_presentation gets removed.
+     * @param name The name of the removed interface
+     * @since 5.67
+     **/
+    void presentationRemoved(quint32 name);
+
     void keystateAnnounced(quint32 name, quint32 version);
     void keystateRemoved(quint32 name);
 
@@ -25,11 +25,21 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include "wayland_pointer_p.h"
 // Qt
 #include <QDebug>
+#include <QHash>
 #include <QImage>
+#include <QRegion>
 #include <QTemporaryFile>
+#include <QtAlgorithms>
 // system
+#include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
+// std
+#include <algorithm>
+#include <iterator>
+#include <limits>
 // wayland
 #include <wayland-client-protocol.h>
 
@@ -38,29 +48,297 @@ namespace KWayland
 namespace Client
 {
 
+namespace {
+
+/**
+ * Manages the space of the shared memory pool.
+ *
+ * The pool is split into chunks kept in address order. Free chunks are additionally kept in
+ * segregated free lists, one per power of two size class, with a bitmask of the non-empty
+ * classes. An allocation takes the first fitting chunk of its own size class or the first
+ * chunk of the next larger non-empty class, releasing a chunk merges it with its free
+ * neighbours. Both are constant time in the common case.
+ **/
+class ShmAllocator
+{
+public:
+    ShmAllocator() = default;
+    ShmAllocator(const ShmAllocator &) = delete;
+    ShmAllocator &operator=(const ShmAllocator &) = delete;
+    ~ShmAllocator() {
+        clear();
+    }
+
+    /**
+     * Resets the allocator to a single free chunk of @p size bytes.
+     **/
+    void reset(int32_t size);
+    void clear();
+    /**
+     * @returns the offset of a chunk of at least @p size bytes or @c -1 if there is none
+     **/
+    int32_t allocate(int32_t size);
+    /**
+     * Releases the chunk at @p offset returned by allocate.
+     **/
+    void release(int32_t offset);
+    /**
+     * Adds the space up to @p newSize at the end of the pool.
+     **/
+    void grow(int32_t newSize);
+    /**
+     * @returns the size of the free chunk at the end of the pool, which can be extended by grow
+     **/
+    int32_t freeTail() const {
+        return m_last && m_last->free ? m_last->size : 0;
+    }
+    /**
+     * Chunks are aligned to a cache line, which also keeps the buffers aligned for vectorized copies.
+     **/
+    static int32_t alignedSize(int32_t size) {
+        return (qMax(size, 1) + s_alignment - 1) & ~(s_alignment - 1);
+    }
+
+private:
+    struct Chunk {
+        int32_t offset;
+        int32_t size;
+        bool free;
+        // address order
+        Chunk *prev;
+        Chunk *next;
+        // free list of the size class
+        Chunk *prevFree;
+        Chunk *nextFree;
+    };
+    static int sizeClass(int32_t size) {
+        return 31 - qCountLeadingZeroBits(quint32(size));
+    }
+    void linkFree(Chunk *chunk);
+    void unlinkFree(Chunk *chunk);
+    int32_t take(Chunk *chunk, int32_t size);
+    void remove(Chunk *chunk);
+
+    static const int32_t s_alignment = 64;
+    Chunk *m_first = nullptr;
+    Chunk *m_last = nullptr;
+    Chunk *m_freeLists[32] = {};
+    quint32 m_freeClasses = 0;
+    int32_t m_size = 0;
+    QHash<int32_t, Chunk*> m_allocated;
+};
+
+void ShmAllocator::reset(int32_t size)
+{
+    clear();
+    grow(size);
+}
+
+void ShmAllocator::clear()
+{
+    while (m_first) {
+        Chunk *next = m_first->next;
+        delete m_first;
+        m_first = next;
+    }
+    m_last = nullptr;
+    std::fill(std::begin(m_freeLists), std::end(m_freeLists), nullptr);
+    m_freeClasses = 0;
+    m_size = 0;
+    m_allocated.clear();
+}
+
+void ShmAllocator::linkFree(Chunk *chunk)
+{
+    const int c = sizeClass(chunk->size);
+    chunk->free = true;
+    chunk->prevFree = nullptr;
+    chunk->nextFree = m_freeLists[c];
+    if (chunk->nextFree) {
+        chunk->nextFree->prevFree = chunk;
+    }
+    m_freeLists[c] = chunk;
+    m_freeClasses |= 1u << c;
+}
+
+void ShmAllocator::unlinkFree(Chunk *chunk)
+{
+    const int c = sizeClass(chunk->size);
+    if (chunk->prevFree) {
+        chunk->prevFree->nextFree = chunk->nextFree;
+    } else {
+        m_freeLists[c] = chunk->nextFree;
+        if (!m_freeLists[c]) {
+            m_freeClasses &= ~(1u << c);
+        }
+    }
+    if (chunk->nextFree) {
+        chunk->nextFree->prevFree = chunk->prevFree;
+    }
+    chunk->free = false;
+}
+
+void ShmAllocator::remove(Chunk *chunk)
+{
+    if (chunk->prev) {
+        chunk->prev->next = chunk->next;
+    } else {
+        m_first = chunk->next;
+    }
+    if (chunk->next) {
+        chunk->next->prev = chunk->prev;
+    } else {
+        m_last = chunk->prev;
+    }
+    delete chunk;
+}
+
+int32_t ShmAllocator::take(Chunk *chunk, int32_t size)
+{
+    unlinkFree(chunk);
+    if (chunk->size - size >= s_alignment) {
+        // split off the remainder
+        Chunk *rest = new Chunk{chunk->offset + size, chunk->size - size, true, chunk, chunk->next, nullptr, nullptr};
+        if (chunk->next) {
+            chunk->next->prev = rest;
+        } else {
+            m_last = rest;
+        }
+        chunk->next = rest;
+        chunk->size = size;
+        linkFree(rest);
+    }
+    m_allocated.insert(chunk->offset, chunk);
+    return chunk->offset;
+}
+
+int32_t ShmAllocator::allocate(int32_t size)
+{
+    size = alignedSize(size);
+    const int c = sizeClass(size);
+    // the chunks of the own size class might be too small
+    for (Chunk *chunk = m_freeLists[c]; chunk; chunk = chunk->nextFree) {
+        if (chunk->size >= size) {
+            return take(chunk, size);
+        }
+    }
+    // every chunk of a larger size class fits
+    const quint32 larger = m_freeClasses & ~((2u << c) - 1);
+    if (larger == 0) {
+        return -1;
+    }
+    return take(m_freeLists[qCountTrailingZeroBits(larger)], size);
+}
+
+void ShmAllocator::release(int32_t offset)
+{
+    Chunk *chunk = m_allocated.take(offset);
+    if (!chunk) {
+        return;
+    }
+    if (chunk->next && chunk->next->free) {
+        Chunk *next = chunk->next;
+        unlinkFree(next);
+        chunk->size += next->size;
+        remove(next);
+    }
+    if (chunk->prev && chunk->prev->free) {
+        Chunk *prev = chunk->prev;
+        unlinkFree(prev);
+        prev->size += chunk->size;
+        remove(chunk);
+        chunk = prev;
+    }
+    linkFree(chunk);
+}
+
+void ShmAllocator::grow(int32_t newSize)
+{
+    if (newSize <= m_size) {
+        return;
+    }
+    if (m_last && m_last->free) {
+        unlinkFree(m_last);
+        m_last->size += newSize - m_size;
+        linkFree(m_last);
+    } else {
+        Chunk *chunk = new Chunk{m_size, newSize - m_size, true, m_last, nullptr, nullptr, nullptr};
+        if (m_last) {
+            m_last->next = chunk;
+        } else {
+            m_first = chunk;
+        }
+        m_last = chunk;
+        linkFree(chunk);
+    }
+    m_size = newSize;
+}
+
+struct BufferKey {
+    QSize size;
+    int32_t stride;
+    Buffer::Format format;
+};
+
+inline bool operator==(const BufferKey &a, const BufferKey &b)
+{
+    return a.size == b.size && a.stride == b.stride && a.format == b.format;
+}
+
+inline uint qHash(const BufferKey &key, uint seed = 0)
+{
+    return qHash(quint64(key.size.width()) << 32 | quint32(key.size.height()), seed) ^ qHash(key.stride, seed) ^ uint(key.format);
+}
+
+}
+
 class Q_DECL_HIDDEN ShmPool::Private
 {
 public:
     Private(ShmPool *q);
     bool createPool();
     bool resizePool(int32_t newSize);
-    QList<QSharedPointer<Buffer>>::iterator getBuffer(const QSize &size, int32_t stride, Buffer::Format format);
+    /**
+     * Opens the file backing the pool, a sealed memfd if possible.
+     **/
+    int openPoolFile(bool hugetlb);
+    bool mapPool();
+    void closePool();
+    QSharedPointer<Buffer> getBuffer(const QSize &size, int32_t stride, Buffer::Format format);
+    /**
+     * Destroys the released and unused Buffers which did not get handed out for a while.
+     **/
+    void reclaimStaleBuffers();
     WaylandPointer<wl_shm, wl_shm_destroy> shm;
     WaylandPointer<wl_shm_pool, wl_shm_pool_destroy> pool;
     void *poolData = nullptr;
     int32_t size = 1024;
-    QScopedPointer<QTemporaryFile> tmpFile;
+    int fd = -1;
+    bool hugePages = false;
+    // the pool is backed by hugetlbfs, its size has to be a multiple of s_hugePageSize
+    bool hugetlb = false;
     bool valid = false;
-    int offset = 0;
-    QList<QSharedPointer<Buffer>> buffers;
+    ShmAllocator allocator;
+    struct Entry {
+        QSharedPointer<Buffer> buffer;
+        // value of acquireCounter when the buffer got handed out the last time
+        quint64 lastAcquired;
+    };
+    // all Buffers by size, stride and format, so that finding a reusable one does not scan all
+    QHash<BufferKey, QVector<Entry>> buffers;
+    quint64 acquireCounter = 0;
+    bool reclaimStale = false;
     EventQueue *queue = nullptr;
+
+    // a Buffer not handed out during that many requests is considered stale
+    static const quint64 s_staleAge = 16;
+    static const int32_t s_hugePageSize = 2 * 1024 * 1024;
 private:
     ShmPool *q;
 };
 
 ShmPool::Private::Private(ShmPool *q)
-    : tmpFile(new QTemporaryFile())
-    , q(q)
+    : q(q)
 {
 }
 
@@ -79,32 +357,26 @@ ShmPool::~ShmPool()
 void ShmPool::release()
 {
     d->buffers.clear();
-    if (d->poolData) {
-        munmap(d->poolData, d->size);
-        d->poolData = nullptr;
-    }
+    d->allocator.clear();
     d->pool.release();
     d->shm.release();
-    d->tmpFile->close();
+    d->closePool();
     d->valid = false;
-    d->offset = 0;
 }
 
 void ShmPool::destroy()
 {
-    for (auto b : d->buffers) {
-        b->d->destroy();
+    for (const auto &entries : qAsConst(d->buffers)) {
+        for (const auto &entry : entries) {
+            entry.buffer->d->destroy();
+        }
     }
     d->buffers.clear();
-    if (d->poolData) {
-        munmap(d->poolData, d->size);
-        d->poolData = nullptr;
-    }
+    d->allocator.clear();
     d->pool.destroy();
     d->shm.destroy();
-    d->tmpFile->close();
+    d->closePool();
     d->valid = false;
-    d->offset = 0;
 }
 
 void ShmPool::setup(wl_shm *shm)
@@ -125,43 +397,158 @@ EventQueue *ShmPool::eventQueue()
     return d->queue;
 }
 
-bool ShmPool::Private::createPool()
+namespace {
+static int memfdCreate(const char *name, unsigned int flags)
 {
-    if (!tmpFile->open()) {
+#ifdef SYS_memfd_create
+    return syscall(SYS_memfd_create, name, flags);
+#else
+    Q_UNUSED(name)
+    Q_UNUSED(flags)
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+// from linux/memfd.h, which might not be available
+static const unsigned int s_memfdCloexec = 0x0001U;
+static const unsigned int s_memfdAllowSealing = 0x0002U;
+static const unsigned int s_memfdHugetlb = 0x0004U;
+// MFD_HUGE_2MB, without a size the default huge page size of the system is used, which
+// might not match s_hugePageSize
+static const unsigned int s_memfdHuge2MB = 21U << 26;
+}
+
+int ShmPool::Private::openPoolFile(bool hugetlb)
+{
+    int fd = memfdCreate("kwayland-shm", s_memfdCloexec | s_memfdAllowSealing | (hugetlb ? s_memfdHugetlb | s_memfdHuge2MB : 0));
+    if (fd != -1) {
+#ifdef F_ADD_SEALS
+        // the pool only grows, the compositor can rely on the memory not going away
+        fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_SEAL);
+#endif
+        return fd;
+    }
+    if (hugetlb) {
+        return -1;
+    }
+    // no memfd support, fall back to an unlinked temporary file
+    QTemporaryFile tmpFile;
+    if (!tmpFile.open()) {
         qCDebug(KWAYLAND_CLIENT) << "Could not open temporary file for Shm pool";
-        return false;
+        return -1;
     }
-    if (unlink(tmpFile->fileName().toUtf8().constData()) != 0) {
+    if (unlink(tmpFile.fileName().toUtf8().constData()) != 0) {
         qCDebug(KWAYLAND_CLIENT) << "Unlinking temporary file for Shm pool from file system failed";
     }
-    if (ftruncate(tmpFile->handle(), size) < 0) {
-        qCDebug(KWAYLAND_CLIENT) << "Could not set size for Shm pool file";
+    return fcntl(tmpFile.handle(), F_DUPFD_CLOEXEC, 0);
+}
+
+bool ShmPool::Private::mapPool()
+{
+    poolData = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (poolData == MAP_FAILED) {
+        poolData = nullptr;
         return false;
     }
-    poolData = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, tmpFile->handle(), 0);
-    pool.setup(wl_shm_create_pool(shm, tmpFile->handle(), size));
+#ifdef MADV_HUGEPAGE
+    if (hugePages && !hugetlb) {
+        // transparent huge pages, depends on the shmem_enabled setting of the system
+        madvise(poolData, size, MADV_HUGEPAGE);
+    }
+#endif
+    return true;
+}
+
+void ShmPool::Private::closePool()
+{
+    if (poolData) {
+        munmap(poolData, size);
+        poolData = nullptr;
+    }
+    if (fd != -1) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+bool ShmPool::Private::createPool()
+{
+    hugetlb = false;
+    if (hugePages) {
+        const int32_t hugeSize = (size + s_hugePageSize - 1) & ~(s_hugePageSize - 1);
+        fd = openPoolFile(true);
+        if (fd != -1 && ftruncate(fd, hugeSize) == 0) {
+            hugetlb = true;
+            const int32_t oldSize = size;
+            size = hugeSize;
+            if (!mapPool()) {
+                // no huge pages reserved
+                size = oldSize;
+                hugetlb = false;
+            }
+        }
+        if (!hugetlb) {
+            qCDebug(KWAYLAND_CLIENT) << "Could not create Shm pool with huge pages, using transparent huge pages";
+            closePool();
+        }
+    }
+    if (!hugetlb) {
+        fd = openPoolFile(false);
+        if (fd == -1) {
+            qCDebug(KWAYLAND_CLIENT) << "Could not create file for Shm pool";
+            return false;
+        }
+        if (ftruncate(fd, size) < 0) {
+            qCDebug(KWAYLAND_CLIENT) << "Could not set size for Shm pool file";
+            return false;
+        }
+        if (!mapPool()) {
+            qCDebug(KWAYLAND_CLIENT) << "Mapping Shm pool failed";
+            return false;
+        }
+    }
+    pool.setup(wl_shm_create_pool(shm, fd, size));
 
-    if (!poolData || !pool) {
+    if (!pool) {
         qCDebug(KWAYLAND_CLIENT) << "Creating Shm pool failed";
         return false;
     }
+    allocator.reset(size);
     return true;
 }
 
 bool ShmPool::Private::resizePool(int32_t newSize)
 {
-    if (ftruncate(tmpFile->handle(), newSize) < 0) {
+    if (hugetlb) {
+        newSize = (newSize + s_hugePageSize - 1) & ~(s_hugePageSize - 1);
+    }
+    if (ftruncate(fd, newSize) < 0) {
         qCDebug(KWAYLAND_CLIENT) << "Could not set new size for Shm pool file";
         return false;
     }
+    void *newData = MAP_FAILED;
+#ifdef MREMAP_MAYMOVE
+    // keeps the pages, only the page tables are moved
+    newData = mremap(poolData, size, newSize, MREMAP_MAYMOVE);
+#endif
+    if (newData == MAP_FAILED) {
+        newData = mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (newData == MAP_FAILED) {
+            qCDebug(KWAYLAND_CLIENT) << "Resizing Shm pool failed";
+            return false;
+        }
+        munmap(poolData, size);
+    }
+    poolData = newData;
+#ifdef MADV_HUGEPAGE
+    if (hugePages && !hugetlb) {
+        madvise(poolData, newSize, MADV_HUGEPAGE);
+    }
+#endif
     wl_shm_pool_resize(pool, newSize);
-    munmap(poolData, size);
-    poolData = mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, tmpFile->handle(), 0);
     size = newSize;
-    if (!poolData) {
-        qCDebug(KWAYLAND_CLIENT) << "Resizing Shm pool failed";
-        return false;
-    }
+    allocator.grow(newSize);
     emit q->poolResized();
     return true;
 }
@@ -175,8 +562,12 @@ static Buffer::Format toBufferFormat(const QImage &image)
     case QImage::Format_RGB32:
         return Buffer::Format::RGB32;
     case QImage::Format_ARGB32:
-        qCWarning(KWAYLAND_CLIENT) << "Unsupported image format: " << image.format() << ". expect slow performance. Use QImage::Format_ARGB32_Premultiplied";
+    case QImage::Format_RGBA8888:
+    case QImage::Format_RGBA8888_Premultiplied:
+        // premultiplied and swizzled while copying
         return Buffer::Format::ARGB32;
+    case QImage::Format_RGBX8888:
+        return Buffer::Format::RGB32;
     default:
         qCWarning(KWAYLAND_CLIENT) << "Unsupported image format: " << image.format() << ". expect slow performance.";
         return Buffer::Format::ARGB32;
@@ -190,17 +581,14 @@ Buffer::Ptr ShmPool::createBuffer(const QImage& image)
         return QWeakPointer<Buffer>();
     }
     auto format = toBufferFormat(image);
-    auto it = d->getBuffer(image.size(), image.bytesPerLine(), format);
-    if (it == d->buffers.end()) {
+    // Buffer::copy converts 32 bit formats row by row, other depths need a 32 bit stride
+    const QImage source = image.depth() == 32 ? image : image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    auto buffer = d->getBuffer(source.size(), source.bytesPerLine(), format);
+    if (!buffer) {
         return QWeakPointer<Buffer>();
     }
-    if (format == Buffer::Format::ARGB32 && image.format() != QImage::Format_ARGB32_Premultiplied) {
-        auto imageCopy = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
-        (*it)->copy(imageCopy.bits());
-    } else {
-        (*it)->copy(image.bits());
-    }
-    return QWeakPointer<Buffer>(*it);
+    buffer->copy(source, QRegion(source.rect()));
+    return QWeakPointer<Buffer>(buffer);
 }
 
 Buffer::Ptr ShmPool::createBuffer(const QSize &size, int32_t stride, const void *src, Buffer::Format format)
@@ -208,12 +596,12 @@ Buffer::Ptr ShmPool::createBuffer(const QSize &size, int32_t stride, const void
     if (size.isEmpty() || !d->valid) {
         return QWeakPointer<Buffer>();
     }
-    auto it = d->getBuffer(size, stride, format);
-    if (it == d->buffers.end()) {
+    auto buffer = d->getBuffer(size, stride, format);
+    if (!buffer) {
         return QWeakPointer<Buffer>();
     }
-    (*it)->copy(src);
-    return QWeakPointer<Buffer>(*it);
+    buffer->copy(src);
+    return QWeakPointer<Buffer>(buffer);
 }
 
 namespace {
@@ -231,45 +619,99 @@ static wl_shm_format toWaylandFormat(Buffer::Format format)
 
 Buffer::Ptr ShmPool::getBuffer(const QSize &size, int32_t stride, Buffer::Format format)
 {
-    auto it = d->getBuffer(size, stride, format);
-    if (it == d->buffers.end()) {
-        return QWeakPointer<Buffer>();
-    }
-    return QWeakPointer<Buffer>(*it);
+    return QWeakPointer<Buffer>(d->getBuffer(size, stride, format));
 }
 
-QList<QSharedPointer<Buffer>>::iterator ShmPool::Private::getBuffer(const QSize &s, int32_t stride, Buffer::Format format)
+QSharedPointer<Buffer> ShmPool::Private::getBuffer(const QSize &s, int32_t stride, Buffer::Format format)
 {
-    for (auto it = buffers.begin(); it != buffers.end(); ++it) {
-        auto buffer = *it;
-        if (!buffer->isReleased() || buffer->isUsed()) {
+    acquireCounter++;
+    const BufferKey key{s, stride, format};
+    auto &entries = buffers[key];
+    for (auto &entry : entries) {
+        if (!entry.buffer->isReleased() || entry.buffer->isUsed()) {
             continue;
         }
-        if (buffer->size() != s || buffer->stride() != stride || buffer->format() != format) {
-            continue;
-        }
-        buffer->setReleased(false);
-        return it;
+        entry.buffer->setReleased(false);
+        entry.lastAcquired = acquireCounter;
+        return entry.buffer;
+    }
+    // we don't have a buffer which we could reuse - need to create a new one
+    if (reclaimStale) {
+        reclaimStaleBuffers();
     }
     const int32_t byteCount = s.height() * stride;
-    if (offset + byteCount > size) {
-        if (!resizePool(size + byteCount)) {
-            return buffers.end();
+    int32_t offset = allocator.allocate(byteCount);
+    if (offset == -1) {
+        // the free space at the end of the pool only needs to be extended, but the pool
+        // grows at least geometrically to keep the number of resizes low
+        const qint64 needed = qint64(size) + ShmAllocator::alignedSize(byteCount) - allocator.freeTail();
+        const qint64 newSize = qMin(qMax(needed, qint64(size) * 2), qint64(std::numeric_limits<int32_t>::max()));
+        if (needed > newSize || !resizePool(int32_t(newSize))) {
+            return QSharedPointer<Buffer>();
+        }
+        offset = allocator.allocate(byteCount);
+        if (offset == -1) {
+            return QSharedPointer<Buffer>();
         }
     }
-    // we don't have a buffer which we could reuse - need to create a new one
     wl_buffer *native = wl_shm_pool_create_buffer(pool, offset, s.width(), s.height(),
                                                   stride, toWaylandFormat(format));
     if (!native) {
-        return buffers.end();
+        allocator.release(offset);
+        return QSharedPointer<Buffer>();
     }
     if (queue) {
         queue->addProxy(native);
     }
-    Buffer *buffer = new Buffer(q, native, s, stride, offset, format);
-    offset += byteCount;
-    auto it = buffers.insert(buffers.end(), QSharedPointer<Buffer>(buffer));
-    return it;
+    QSharedPointer<Buffer> buffer(new Buffer(q, native, s, stride, offset, format));
+    // reclaiming might have invalidated the reference into the hash
+    buffers[key].append(Entry{buffer, acquireCounter});
+    return buffer;
+}
+
+void ShmPool::Private::reclaimStaleBuffers()
+{
+    for (auto it = buffers.begin(); it != buffers.end();) {
+        auto &entries = it.value();
+        for (int i = entries.count() - 1; i >= 0; --i) {
+            const Entry &entry = entries.at(i);
+            if (!entry.buffer->isReleased() || entry.buffer->isUsed() || acquireCounter - entry.lastAcquired < s_staleAge) {
+                continue;
+            }
+            allocator.release(int32_t(entry.buffer->d->offset));
+            entries.remove(i);
+        }
+        if (entries.isEmpty()) {
+            it = buffers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ShmPool::setReclaimStaleBuffersEnabled(bool enabled)
+{
+    d->reclaimStale = enabled;
+}
+
+bool ShmPool::isReclaimStaleBuffersEnabled() const
+{
+    return d->reclaimStale;
+}
+
+int32_t ShmPool::poolSize() const
+{
+    return d->size;
+}
+
+void ShmPool::setHugePagesEnabled(bool enabled)
+{
+    d->hugePages = enabled;
+}
+
+bool ShmPool::isHugePagesEnabled() const
+{
+    return d->hugePages;
 }
 
 bool ShmPool::isValid() const
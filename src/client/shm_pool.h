@@ -125,6 +125,15 @@ class EventQueue;
  * all existing Buffers are unmapped and any shared objects must be recreated. The ShmPool emits
  * the signal poolResized() after the pool got resized.
  *
+ * The pool is backed by a sealed memfd, if the system supports it. The pool only grows and
+ * at least doubles its size when growing. Large buffers, e.g. for fullscreen windows on
+ * high resolution outputs, can benefit from huge pages, see setHugePagesEnabled.
+ *
+ * The memory of the pool is managed by an allocator which reuses the space of destroyed
+ * Buffers. To keep the pool from growing when Buffers of changing sizes are requested, e.g.
+ * while a window gets resized interactively, the ShmPool can destroy Buffers which were not
+ * handed out for a while, see setReclaimStaleBuffersEnabled.
+ *
  * @see Buffer
  **/
 class KWAYLANDCLIENT_EXPORT ShmPool : public QObject
@@ -190,6 +199,10 @@ public:
      * The content of the @p image is <b>copied</b> into the buffer. The @p image and
      * returned Buffer do <b>not</b> share memory.
      *
+     * Images in QImage::Format_ARGB32 and the RGBA8888 formats get premultiplied while
+     * copying, images with a depth other than 32 bit are converted first and use the
+     * stride of the converted image.
+     *
      * @param image The image which should be copied into the Buffer
      * @return Buffer with copied content of @p image in success case, a @c null Buffer::Ptr otherwise
      * @see getBuffer
@@ -226,6 +239,52 @@ public:
      **/
     Buffer::Ptr getBuffer(const QSize &size, int32_t stride, Buffer::Format format = Buffer::Format::ARGB32);
     wl_shm *shm();
+
+    /**
+     * Sets whether Buffers which are released, not used and did not get handed out during
+     * the last 16 requests get destroyed once a new Buffer needs to be created. Their memory
+     * is then reused for the new Buffer instead of growing the pool.
+     *
+     * A destroyed Buffer invalidates all Buffer::Ptr referencing it.
+     *
+     * The default is @c false.
+     * @see isReclaimStaleBuffersEnabled
+     * @since 5.67
+     **/
+    void setReclaimStaleBuffersEnabled(bool enabled);
+    /**
+     * @see setReclaimStaleBuffersEnabled
+     * @since 5.67
+     **/
+    bool isReclaimStaleBuffersEnabled() const;
+    /**
+     * Sets whether the shared memory pool should use huge pages. The pool gets backed by
+     * hugetlbfs if huge pages are reserved on the system, otherwise transparent huge pages
+     * are requested for the pool. This reduces the TLB pressure for large Buffers. A pool
+     * backed by hugetlbfs is at least one huge page (2 MiB) large.
+     *
+     * Only applies if called before setup, thus the ShmPool needs to be created manually:
+     * @code
+     * ShmPool *s = new ShmPool;
+     * s->setHugePagesEnabled(true);
+     * s->setup(registry->bindShm(name, version));
+     * @endcode
+     *
+     * The default is @c false.
+     * @see isHugePagesEnabled
+     * @since 5.67
+     **/
+    void setHugePagesEnabled(bool enabled);
+    /**
+     * @see setHugePagesEnabled
+     * @since 5.67
+     **/
+    bool isHugePagesEnabled() const;
+    /**
+     * @returns the current size of the shared memory pool in bytes
+     * @since 5.67
+     **/
+    int32_t poolSize() const;
 Q_SIGNALS:
     /**
      * This signal is emitted whenever the shared memory pool gets resized.
@@ -24,6 +24,7 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include "wayland_pointer_p.h"
 
 #include <QGuiApplication>
+#include <QImage>
 #include <QRegion>
 #include <QVector>
 #include <QWindow>
@@ -268,6 +269,19 @@ void Surface::attachBuffer(Buffer::Ptr buffer, const QPoint &offset)
     attachBuffer(buffer.toStrongRef().data(), offset);
 }
 
+void Surface::updateBuffer(Buffer::Ptr buffer, const QImage &image, const QRegion &region)
+{
+    Q_ASSERT(isValid());
+    auto b = buffer.toStrongRef();
+    if (b.isNull()) {
+        return;
+    }
+    const QRegion damage = region.intersected(QRect(QPoint(0, 0), b->size()));
+    b->copy(image, damage);
+    attachBuffer(b.data());
+    damageBuffer(damage);
+}
+
 void Surface::setInputRegion(const Region *region)
 {
     Q_ASSERT(isValid());
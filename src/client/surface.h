@@ -183,6 +183,23 @@ public:
      * Overloaded method for convenience.
      **/
     void attachBuffer(Buffer::Ptr buffer, const QPoint &offset = QPoint());
+    /**
+     * Copies the pixels of @p image inside @p region into @p buffer, attaches the @p buffer
+     * and marks the same @p region as damaged with damageBuffer. The region is clipped to the
+     * size of the @p buffer.
+     *
+     * Only the damaged parts get copied, so the rest of the @p buffer must already hold the
+     * current content, e.g. because the same Buffer is reused for the next frame.
+     * The Surface still needs to be committed.
+     *
+     * @param buffer The buffer to update and attach to this Surface
+     * @param image The new content of the Surface, in buffer coordinates
+     * @param region The changed area of @p image
+     * @see Buffer::copy
+     * @see damageBuffer
+     * @since 5.67
+     **/
+    void updateBuffer(Buffer::Ptr buffer, const QImage &image, const QRegion &region);
     /**
      * Sets the input region to @p region.
      *
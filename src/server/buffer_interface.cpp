@@ -18,10 +18,15 @@ You should have received a copy of the GNU Lesser General Public
 License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 *********************************************************************/
 #include "buffer_interface.h"
+#include "compositor_interface.h"
 #include "display.h"
 #include "logging.h"
 #include "surface_interface.h"
+#include "surface_interface_p.h"
 #include "linuxdmabuf_v1_interface.h"
+#include "../shared/pixelconverter_p.h"
+// Qt
+#include <QPointer>
 // Wayland
 #include <wayland-server.h>
 // EGL
@@ -48,39 +53,55 @@ public:
     ~Private();
     QImage::Format format() const;
     QImage createImage();
+    bool copyTo(uchar *destination, int stride, const QRegion &region);
+    CompositorInterface *compositor() const;
+    void release();
     wl_resource *buffer;
     wl_shm_buffer *shmBuffer;
+    // only used as identity, the wl_shm_buffer keeps the pool alive
+    wl_shm_pool *shmPool = nullptr;
     LinuxDmabufBuffer *dmabufBuffer;
-    SurfaceInterface *surface;
+    QPointer<SurfaceInterface> surface;
+    // converts the shm format into the layout of format(), invalid for unsupported formats
+    PixelConverter converter;
     int refCount;
     QSize size;
     bool alpha;
+    // released through contentsUploaded while still being referenced
+    bool releasedEarly = false;
+    // waiting for CompositorInterface::flushBufferReleases
+    bool releaseQueued = false;
 
     static BufferInterface *get(wl_resource *r);
 
 private:
+    bool beginAccess();
+    void endAccess();
     static void destroyListenerCallback(wl_listener *listener, void *data);
     static Private *cast(wl_resource *r);
     static void imageBufferCleanupHandler(void *info);
-    static QList<Private*> s_buffers;
-    static Private *s_accessedBuffer;
-    static int s_accessCounter;
+    // libwayland's SIGBUS protection supports one accessed pool per thread
+    static thread_local wl_shm_pool *s_accessedPool;
+    static thread_local int s_accessCounter;
 
     BufferInterface *q;
-    wl_listener listener;
+    // destroy listener on the wl_buffer, also used to find the Private for a wl_resource
+    struct DestroyListener {
+        wl_listener listener;
+        Private *p;
+    } listener;
 };
 
-QList<BufferInterface::Private*> BufferInterface::Private::s_buffers;
-BufferInterface::Private *BufferInterface::Private::s_accessedBuffer = nullptr;
-int BufferInterface::Private::s_accessCounter = 0;
+thread_local wl_shm_pool *BufferInterface::Private::s_accessedPool = nullptr;
+thread_local int BufferInterface::Private::s_accessCounter = 0;
 
 BufferInterface::Private *BufferInterface::Private::cast(wl_resource *r)
 {
-    auto it = std::find_if(s_buffers.constBegin(), s_buffers.constEnd(), [r](Private *d) { return d->buffer == r; });
-    if (it == s_buffers.constEnd()) {
+    wl_listener *l = wl_resource_get_destroy_listener(r, destroyListenerCallback);
+    if (!l) {
         return nullptr;
     }
-    return *it;
+    return reinterpret_cast<DestroyListener*>(l)->p;
 }
 
 BufferInterface *BufferInterface::Private::get(wl_resource *r)
@@ -95,13 +116,29 @@ BufferInterface *BufferInterface::Private::get(wl_resource *r)
 void BufferInterface::Private::imageBufferCleanupHandler(void *info)
 {
     Private *p = reinterpret_cast<Private*>(info);
-    Q_ASSERT(p == s_accessedBuffer);
+    p->endAccess();
+}
+
+bool BufferInterface::Private::beginAccess()
+{
+    if (s_accessedPool != nullptr && s_accessedPool != shmPool) {
+        return false;
+    }
+    s_accessedPool = shmPool;
+    s_accessCounter++;
+    wl_shm_buffer_begin_access(shmBuffer);
+    return true;
+}
+
+void BufferInterface::Private::endAccess()
+{
+    Q_ASSERT(shmPool == s_accessedPool);
     Q_ASSERT(s_accessCounter > 0);
     s_accessCounter--;
     if (s_accessCounter == 0) {
-        s_accessedBuffer = nullptr;
+        s_accessedPool = nullptr;
     }
-    wl_shm_buffer_end_access(p->shmBuffer);
+    wl_shm_buffer_end_access(shmBuffer);
 }
 
 BufferInterface::Private::Private(BufferInterface *q, wl_resource *resource, SurfaceInterface *parent)
@@ -116,23 +153,17 @@ BufferInterface::Private::Private(BufferInterface *q, wl_resource *resource, Sur
     if (!shmBuffer && wl_resource_instance_of(resource, &wl_buffer_interface, LinuxDmabufUnstableV1Interface::bufferImplementation())) {
         dmabufBuffer = static_cast<LinuxDmabufBuffer *>(wl_resource_get_user_data(resource));
     }
-    s_buffers << this;
-    listener.notify = destroyListenerCallback;
-    listener.link.prev = nullptr;
-    listener.link.next = nullptr;
-    wl_resource_add_destroy_listener(resource, &listener);
+    listener.listener.notify = destroyListenerCallback;
+    listener.listener.link.prev = nullptr;
+    listener.listener.link.next = nullptr;
+    listener.p = this;
+    wl_resource_add_destroy_listener(resource, &listener.listener);
     if (shmBuffer) {
+        shmPool = wl_shm_buffer_ref_pool(shmBuffer);
+        wl_shm_pool_unref(shmPool);
         size = QSize(wl_shm_buffer_get_width(shmBuffer), wl_shm_buffer_get_height(shmBuffer));
-        // check alpha
-        switch (wl_shm_buffer_get_format(shmBuffer)) {
-        case WL_SHM_FORMAT_ARGB8888:
-            alpha = true;
-            break;
-        case WL_SHM_FORMAT_XRGB8888:
-        default:
-            alpha = false;
-            break;
-        }
+        converter = PixelConverter(wl_shm_buffer_get_format(shmBuffer));
+        alpha = converter.hasAlphaChannel();
     } else if (dmabufBuffer) {
         switch (dmabufBuffer->format()) {
         case DRM_FORMAT_ARGB4444:
@@ -205,8 +236,7 @@ BufferInterface::Private::Private(BufferInterface *q, wl_resource *resource, Sur
 
 BufferInterface::Private::~Private()
 {
-    wl_list_remove(&listener.link);
-    s_buffers.removeAll(this);
+    wl_list_remove(&listener.listener.link);
 }
 
 BufferInterface *BufferInterface::get(wl_resource *r)
@@ -222,6 +252,17 @@ BufferInterface *BufferInterface::get(wl_resource *r)
     return new BufferInterface(r, nullptr);
 }
 
+BufferInterface *BufferInterface::attach(wl_resource *r, SurfaceInterface *surface)
+{
+    BufferInterface *b = Private::get(r);
+    if (!b) {
+        return new BufferInterface(r, surface);
+    }
+    // reused for a further attach, the size and format got already probed on creation
+    b->d->surface = surface;
+    return b;
+}
+
 BufferInterface::BufferInterface(wl_resource *resource, SurfaceInterface *parent)
     : QObject()
     , d(new Private(this, resource, parent))
@@ -233,20 +274,63 @@ BufferInterface::~BufferInterface()
     if (d->refCount != 0) {
         qCWarning(KWAYLAND_SERVER) << "Buffer destroyed while still being referenced, ref count:" << d->refCount;
     }
+    if (d->buffer) {
+        // not destroyed through the wl_buffer, ensure users drop their pointers
+        emit aboutToBeDestroyed(this);
+    }
 }
 
 void BufferInterface::Private::destroyListenerCallback(wl_listener *listener, void *data)
 {
-    Q_UNUSED(listener);
-    auto b = cast(reinterpret_cast<wl_resource*>(data));
+    Q_UNUSED(data);
+    auto b = reinterpret_cast<DestroyListener*>(listener)->p;
     b->buffer = nullptr;
     emit b->q->aboutToBeDestroyed(b->q);
     delete b->q;
 }
 
+CompositorInterface *BufferInterface::Private::compositor() const
+{
+    if (!surface) {
+        return nullptr;
+    }
+    // null if the CompositorInterface got destroyed before the surface, the release is sent directly then
+    return surface->d_func()->compositor;
+}
+
+void BufferInterface::Private::release()
+{
+    if (!buffer) {
+        return;
+    }
+    if (CompositorInterface *c = compositor()) {
+        if (c->isBufferReleaseBatchingEnabled()) {
+            if (!releaseQueued) {
+                releaseQueued = true;
+                c->queueBufferRelease(q);
+            }
+            return;
+        }
+    }
+    wl_buffer_send_release(buffer);
+    if (surface) {
+        surface->client()->scheduleFlush();
+    } else {
+        wl_client_flush(wl_resource_get_client(buffer));
+    }
+}
+
 void BufferInterface::ref()
 {
     d->refCount++;
+    d->releaseQueued = false;
+}
+
+void BufferInterface::refAttached()
+{
+    ref();
+    // only the client can hand out the buffer again, not a further reference of the compositor
+    d->releasedEarly = false;
 }
 
 void BufferInterface::unref()
@@ -254,27 +338,47 @@ void BufferInterface::unref()
     Q_ASSERT(d->refCount > 0);
     d->refCount--;
     if (d->refCount == 0) {
-        if (d->buffer) {
-            wl_buffer_send_release(d->buffer);
-            wl_client_flush(wl_resource_get_client(d->buffer));
+        if (d->releasedEarly) {
+            // the client got the buffer back already
+            d->releasedEarly = false;
+        } else {
+            d->release();
         }
-        deleteLater();
     }
 }
 
+void BufferInterface::contentsUploaded()
+{
+    if (!d->shmBuffer || d->refCount == 0 || d->releasedEarly) {
+        return;
+    }
+    CompositorInterface *c = d->compositor();
+    if (!c || !c->isEarlyShmBufferReleaseEnabled()) {
+        return;
+    }
+    d->releasedEarly = true;
+    d->release();
+}
+
+bool BufferInterface::sendQueuedRelease()
+{
+    if (!d->releaseQueued) {
+        return false;
+    }
+    d->releaseQueued = false;
+    if (!d->buffer) {
+        return false;
+    }
+    wl_buffer_send_release(d->buffer);
+    return true;
+}
+
 QImage::Format BufferInterface::Private::format() const
 {
     if (!shmBuffer) {
         return QImage::Format_Invalid;
     }
-    switch (wl_shm_buffer_get_format(shmBuffer)) {
-    case WL_SHM_FORMAT_ARGB8888:
-        return QImage::Format_ARGB32_Premultiplied;
-    case WL_SHM_FORMAT_XRGB8888:
-        return QImage::Format_RGB32;
-    default:
-        return QImage::Format_Invalid;
-    }
+    return converter.imageFormat();
 }
 
 QImage BufferInterface::data()
@@ -287,16 +391,26 @@ QImage BufferInterface::Private::createImage()
     if (!shmBuffer) {
         return QImage();
     }
-    if (s_accessedBuffer != nullptr && s_accessedBuffer != this) {
-        return QImage();
-    }
     const QImage::Format imageFormat = format();
     if (imageFormat == QImage::Format_Invalid) {
         return QImage();
     }
-    s_accessedBuffer = this;
-    s_accessCounter++;
-    wl_shm_buffer_begin_access(shmBuffer);
+    switch (converter.format()) {
+    case WL_SHM_FORMAT_ARGB8888:
+    case WL_SHM_FORMAT_XRGB8888:
+        break;
+    default: {
+        // the memory layout differs from the QImage::Format, provide a converted copy
+        QImage image(size, imageFormat);
+        if (image.isNull() || !copyTo(image.bits(), image.bytesPerLine(), QRegion(QRect(QPoint(0, 0), size)))) {
+            return QImage();
+        }
+        return image;
+    }
+    }
+    if (!beginAccess()) {
+        return QImage();
+    }
     return std::move(QImage((const uchar*)wl_shm_buffer_get_data(shmBuffer),
                             size.width(),
                             size.height(),
@@ -305,6 +419,43 @@ QImage BufferInterface::Private::createImage()
                             &imageBufferCleanupHandler, this));
 }
 
+bool BufferInterface::copyTo(uchar *destination, int stride, const QRegion &region)
+{
+    return d->copyTo(destination, stride, region);
+}
+
+bool BufferInterface::Private::copyTo(uchar *destination, int stride, const QRegion &region)
+{
+    if (!shmBuffer || !destination) {
+        return false;
+    }
+    const QImage::Format imageFormat = format();
+    if (imageFormat == QImage::Format_Invalid) {
+        return false;
+    }
+    if (!beginAccess()) {
+        return false;
+    }
+    const int bytesPerPixel = converter.bytesPerPixel();
+    const int destinationBytesPerPixel = QImage::toPixelFormat(imageFormat).bitsPerPixel() / 8;
+    const int sourceStride = wl_shm_buffer_get_stride(shmBuffer);
+    const uchar *source = reinterpret_cast<const uchar*>(wl_shm_buffer_get_data(shmBuffer));
+    const QRect bounds(QPoint(0, 0), size);
+    for (const QRect &rect : region) {
+        const QRect r = rect.intersected(bounds);
+        if (r.isEmpty()) {
+            continue;
+        }
+        const int sourceOffset = r.x() * bytesPerPixel;
+        const int destinationOffset = r.x() * destinationBytesPerPixel;
+        for (int y = r.top(); y <= r.bottom(); ++y) {
+            converter.convertRow(destination + y * stride + destinationOffset, source + y * sourceStride + sourceOffset, r.width());
+        }
+    }
+    endAccess();
+    return true;
+}
+
 bool BufferInterface::isReferenced() const
 {
     return d->refCount > 0;
@@ -21,6 +21,7 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #define WAYLAND_SERVER_BUFFER_INTERFACE_H
 
 #include <QImage>
+#include <QRegion>
 #include <QObject>
 
 #include <KWayland/Server/kwaylandserver_export.h>
@@ -41,9 +42,12 @@ class LinuxDmabufBuffer;
  * This class encapsulates a rendering buffer which is normally attached to a SurfaceInterface.
  * A client should not render to a Wayland buffer as long as the buffer gets used by the server.
  * The server signals whether it's still used. This class provides a convenience access for this
- * functionality by performing reference counting and deleting the BufferInterface instance
+ * functionality by performing reference counting and releasing the buffer to the client
  * automatically once it is no longer accessed.
  *
+ * There is one BufferInterface for each wl_buffer. It stays valid until the client destroys the
+ * wl_buffer, thus attaching the same wl_buffer again reuses the existing BufferInterface.
+ *
  * The BufferInterface is referenced as long as it is attached to a SurfaceInterface. If one wants
  * to keep access to the BufferInterface for a longer time ensure to call ref on first usage and
  * unref again once access to it is no longer needed.
@@ -71,7 +75,8 @@ public:
      * Reference the BufferInterface.
      *
      * As long as the reference counting has not reached @c 0 the BufferInterface is valid
-     * and blocked for usage by the client.
+     * and blocked for usage by the client. A release which is still queued for the
+     * CompositorInterface gets cancelled.
      *
      * @see unref
      * @see isReferenced
@@ -81,13 +86,29 @@ public:
      * Unreference the BufferInterface.
      *
      * If the reference counting reached @c 0 the BufferInterface is released, so that the
-     * client can use it again. The instance of this BufferInterface will be automatically
-     * deleted.
+     * client can use it again. The instance of this BufferInterface stays valid until the
+     * client destroys the wl_buffer, which is announced through aboutToBeDestroyed.
      *
      * @see ref
      * @see isReferenced
+     * @see CompositorInterface::setBufferReleaseBatchingEnabled
      **/
     void unref();
+    /**
+     * Announces that the compositor does not need the contents of this BufferInterface
+     * anymore, e.g. because they got uploaded into a texture. If early release of shared
+     * memory buffers is enabled on the CompositorInterface, a shared memory buffer is
+     * released right away, although it stays referenced by its SurfaceInterface. The
+     * contents must not be accessed anymore after the release. For all other buffers
+     * this method does nothing.
+     *
+     * The client attaching the BufferInterface again makes it get released again once the
+     * reference count drops to @c 0. Further references taken by the compositor don't.
+     *
+     * @see CompositorInterface::setEarlyShmBufferReleaseEnabled
+     * @since 5.67
+     **/
+    void contentsUploaded();
     /**
      * @returns whether the BufferInterface is currently referenced
      *
@@ -97,7 +118,7 @@ public:
     bool isReferenced() const;
 
     /**
-     * @returns The SurfaceInterface this BufferInterface is attached to.
+     * @returns The SurfaceInterface this BufferInterface got attached to last.
      **/
     SurfaceInterface *surface() const;
     /**
@@ -121,10 +142,15 @@ public:
      * The QImage shares the memory with the buffer and this constraints how the returned
      * QImage can be used and when this method can be invoked.
      *
-     * It is not safe to have two shared memory QImages for different BufferInterfaces at
-     * the same time. This method ensures that this does not happen and returns a null
-     * QImage if a different BufferInterface's data is still mapped to a QImage. Please note
-     * that this also applies to all implicitly data shared copies.
+     * Shared memory QImages of multiple BufferInterfaces can exist at the same time as long
+     * as, per thread, all of them belong to the same client side shared memory pool. This is
+     * a restriction of the SIGBUS protection in libwayland. This method returns a null QImage
+     * if the current thread still has a QImage of a buffer from a different pool mapped. Please
+     * note that this also applies to all implicitly data shared copies.
+     *
+     * This method may be invoked from any thread, e.g. to upload the contents of multiple
+     * buffers in parallel. The returned QImage and all of its copies have to be destroyed
+     * on the thread which created it.
      *
      * In case it is needed to keep a copy, a deep copy has to be performed by using QImage::copy.
      *
@@ -132,9 +158,39 @@ public:
      * write to the returned QImage. The image is a read-only buffer. If there is need to modify
      * the image, perform a deep copy.
      *
+     * Only buffers in the formats @c WL_SHM_FORMAT_ARGB8888 and @c WL_SHM_FORMAT_XRGB8888
+     * share the memory. Buffers in the other supported formats (@c ABGR8888, @c XBGR8888,
+     * @c RGB565, the 2101010 and the 16161616F formats) get converted into a newly allocated
+     * QImage in QImage::Format_ARGB32_Premultiplied or QImage::Format_RGB32. For those
+     * prefer copyTo to only convert the damaged parts. For any other format a null QImage
+     * is returned.
+     *
      **/
     QImage data();
 
+    /**
+     * Copies the rectangles of @p region from the shared memory buffer into @p destination.
+     *
+     * The @p region is in buffer coordinates and gets clipped to the size of the buffer. The
+     * @p destination is expected to be laid out like the complete buffer in the format of
+     * the QImage returned by data, but with the given @p stride. Pixels in formats other than
+     * @c WL_SHM_FORMAT_ARGB8888 and @c WL_SHM_FORMAT_XRGB8888 get converted on the fly, using
+     * vectorized code paths if supported by the CPU. Only the pixels inside the
+     * @p region are written, which allows to upload just the damaged parts of a buffer into
+     * e.g. a staging buffer. Use SurfaceInterface::mapToBuffer to get the damage of a
+     * SurfaceInterface in buffer coordinates.
+     *
+     * The same restrictions regarding concurrent access as for data apply, the buffer is
+     * accessed only for the duration of this call.
+     *
+     * @returns @c false if this is not a shared memory buffer in a supported format or
+     * the buffer could not be accessed, @c true otherwise.
+     * @see data
+     * @see SurfaceInterface::mapToBuffer
+     * @since 5.67
+     **/
+    bool copyTo(uchar *destination, int stride, const QRegion &region);
+
     /**
      * Returns the size of this BufferInterface.
      * Note: only for shared memory buffers (shmBuffer) the size can be derived,
@@ -156,8 +212,8 @@ public:
 
     /**
      * Returns whether the format of the BufferInterface has an alpha channel.
-     * For shared memory buffers returns @c true for format @c WL_SHM_FORMAT_ARGB8888,
-     * for all other formats returns @c false.
+     * For shared memory buffers returns @c true for the supported formats with an alpha
+     * channel, e.g. @c WL_SHM_FORMAT_ARGB8888, for all other formats returns @c false.
      *
      * For EGL buffers returns @c true for format @c EGL_TEXTURE_RGBA, for all other formats
      * returns @c false.
@@ -180,7 +236,22 @@ Q_SIGNALS:
 
 private:
     friend class SurfaceInterface;
+    friend class CompositorInterface;
     explicit BufferInterface(wl_resource *resource, SurfaceInterface *parent);
+    /**
+     * @returns the BufferInterface for @p r, created for @p surface if it doesn't exist yet.
+     **/
+    static BufferInterface *attach(wl_resource *r, SurfaceInterface *surface);
+    /**
+     * References the BufferInterface for a commit applying it to a SurfaceInterface, after
+     * an early release it is in use again and gets released once it is unreferenced.
+     **/
+    void refAttached();
+    /**
+     * Sends the release queued through CompositorInterface::flushBufferReleases.
+     * @returns @c false if there is no release pending anymore
+     **/
+    bool sendQueuedRelease();
     class Private;
     QScopedPointer<Private> d;
 };
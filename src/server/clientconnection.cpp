@@ -106,6 +106,14 @@ void ClientConnection::flush()
     wl_client_flush(d->client);
 }
 
+void ClientConnection::scheduleFlush()
+{
+    if (!d->client) {
+        return;
+    }
+    d->display->d->scheduleFlush(this);
+}
+
 void ClientConnection::destroy()
 {
     if (!d->client) {
@@ -54,8 +54,22 @@ public:
 
     /**
      * Flushes the connection to this client. Ensures that all events are pushed to the client.
+     *
+     * This performs a syscall for each invocation. Unless the events are latency critical,
+     * e.g. input events, prefer scheduleFlush.
+     * @see scheduleFlush
      **/
     void flush();
+    /**
+     * Schedules a flush of the connection to this client. All scheduled flushes of a client
+     * are combined into one flush, performed before the event loop of the Display blocks
+     * or at the latest in the next event loop iteration.
+     *
+     * If the Display is not running the connection is flushed immediately.
+     * @see flush
+     * @since 5.67
+     **/
+    void scheduleFlush();
     /**
      * Creates a new wl_resource for the provided @p interface.
      *
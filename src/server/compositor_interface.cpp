@@ -18,9 +18,14 @@ You should have received a copy of the GNU Lesser General Public
 License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 *********************************************************************/
 #include "compositor_interface.h"
+#include "buffer_interface.h"
+#include "damageaccumulator_p.h"
 #include "display.h"
 #include "global_p.h"
 #include "surface_interface.h"
+// Qt
+#include <QPointer>
+#include <QVarLengthArray>
 // Wayland
 #include <wayland-server.h>
 
@@ -34,6 +39,13 @@ class CompositorInterface::Private : public Global::Private
 public:
     Private(CompositorInterface *q, Display *d);
 
+    int damageRectsThreshold = DamageAccumulator::s_defaultMaxRects;
+    qreal damageAreaOverhead = DamageAccumulator::s_defaultMaxAreaOverhead;
+    bool batchBufferReleases = false;
+    bool earlyShmBufferRelease = false;
+    // buffers with a pending release, sent in flushBufferReleases
+    QVector<QPointer<BufferInterface>> releaseQueue;
+
 private:
     void bind(wl_client *client, uint32_t version, uint32_t id) override;
     void createSurface(wl_client *client, wl_resource *resource, uint32_t id);
@@ -71,7 +83,96 @@ CompositorInterface::CompositorInterface(Display *display, QObject *parent)
 {
 }
 
-CompositorInterface::~CompositorInterface() = default;
+CompositorInterface::~CompositorInterface()
+{
+    flushBufferReleases();
+}
+
+CompositorInterface::Private *CompositorInterface::d_func() const
+{
+    return reinterpret_cast<Private*>(d.data());
+}
+
+void CompositorInterface::setDamageRectsThreshold(int count)
+{
+    Q_D();
+    d->damageRectsThreshold = count;
+}
+
+int CompositorInterface::damageRectsThreshold() const
+{
+    Q_D();
+    return d->damageRectsThreshold;
+}
+
+void CompositorInterface::setDamageAreaOverhead(qreal overhead)
+{
+    Q_D();
+    d->damageAreaOverhead = overhead;
+}
+
+qreal CompositorInterface::damageAreaOverhead() const
+{
+    Q_D();
+    return d->damageAreaOverhead;
+}
+
+void CompositorInterface::setBufferReleaseBatchingEnabled(bool enabled)
+{
+    Q_D();
+    d->batchBufferReleases = enabled;
+    if (!enabled) {
+        flushBufferReleases();
+    }
+}
+
+bool CompositorInterface::isBufferReleaseBatchingEnabled() const
+{
+    Q_D();
+    return d->batchBufferReleases;
+}
+
+void CompositorInterface::queueBufferRelease(BufferInterface *buffer)
+{
+    Q_D();
+    d->releaseQueue.append(buffer);
+}
+
+void CompositorInterface::flushBufferReleases()
+{
+    Q_D();
+    if (d->releaseQueue.isEmpty()) {
+        return;
+    }
+    QVector<QPointer<BufferInterface>> queue;
+    queue.swap(d->releaseQueue);
+    QVarLengthArray<wl_client*, 16> clients;
+    for (const auto &buffer : qAsConst(queue)) {
+        // skips buffers which got destroyed or referenced again in the meantime
+        if (!buffer || !buffer->sendQueuedRelease()) {
+            continue;
+        }
+        wl_client *client = wl_resource_get_client(buffer->resource());
+        if (!clients.contains(client)) {
+            clients.append(client);
+        }
+    }
+    for (wl_client *client : qAsConst(clients)) {
+        wl_client_flush(client);
+    }
+}
+
+void CompositorInterface::setEarlyShmBufferReleaseEnabled(bool enabled)
+{
+    Q_D();
+    d->earlyShmBufferRelease = enabled;
+}
+
+bool CompositorInterface::isEarlyShmBufferReleaseEnabled() const
+{
+    Q_D();
+    return d->earlyShmBufferRelease;
+}
 
 void CompositorInterface::Private::bind(wl_client *client, uint32_t version, uint32_t id)
 {
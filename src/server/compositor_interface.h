@@ -46,6 +46,91 @@ class KWAYLANDSERVER_EXPORT CompositorInterface : public Global
 public:
     virtual ~CompositorInterface();
 
+    /**
+     * The damage a client sends for a SurfaceInterface is collected as a list of rectangles
+     * and combined into the SurfaceInterface::damage on commit. If more than @p count
+     * rectangles got sent in one commit, the bounding box of all rectangles is used instead
+     * of the exact region. A negative @p count disables the check.
+     *
+     * The default is @c 64.
+     * @see damageRectsThreshold
+     * @see setDamageAreaOverhead
+     * @see SurfaceInterface::damageStatistics
+     * @since 5.67
+     **/
+    void setDamageRectsThreshold(int count);
+    /**
+     * @see setDamageRectsThreshold
+     * @since 5.67
+     **/
+    int damageRectsThreshold() const;
+
+    /**
+     * The bounding box of the damage rectangles sent in one commit is used if its area
+     * exceeds the summed area of the rectangles by at most the factor @p overhead, e.g.
+     * @c 0.25 for 25 percent. Using the bounding box is cheaper than computing the exact
+     * region, at the cost of repainting more than needed. A negative @p overhead disables
+     * the check.
+     *
+     * The default is @c 0.25.
+     * @see damageAreaOverhead
+     * @see setDamageRectsThreshold
+     * @since 5.67
+     **/
+    void setDamageAreaOverhead(qreal overhead);
+    /**
+     * @see setDamageAreaOverhead
+     * @since 5.67
+     **/
+    qreal damageAreaOverhead() const;
+
+    /**
+     * Enables batching of buffer releases. Instead of sending the release event as soon
+     * as a BufferInterface is no longer referenced, the release is queued until
+     * flushBufferReleases is called. This allows to send all releases of a frame with one
+     * flush per client. If batching gets disabled, all queued releases are sent.
+     *
+     * The default is @c false.
+     * @see isBufferReleaseBatchingEnabled
+     * @see flushBufferReleases
+     * @since 5.67
+     **/
+    void setBufferReleaseBatchingEnabled(bool enabled);
+    /**
+     * @see setBufferReleaseBatchingEnabled
+     * @since 5.67
+     **/
+    bool isBufferReleaseBatchingEnabled() const;
+    /**
+     * Sends the release events for all BufferInterfaces queued since the last call and
+     * flushes each affected client once. A compositor batching the releases should call
+     * this at the end of each frame, e.g. after SurfaceInterface::frameRendered.
+     *
+     * Buffers which got referenced again or destroyed in the meantime are skipped.
+     * @see setBufferReleaseBatchingEnabled
+     * @since 5.67
+     **/
+    void flushBufferReleases();
+
+    /**
+     * Enables the early release of shared memory buffers. If enabled a shared memory
+     * BufferInterface is released as soon as the compositor announced through
+     * BufferInterface::contentsUploaded that it does not need the contents anymore,
+     * instead of when the next buffer gets attached. This allows clients to reuse their
+     * buffers earlier and to get along with less of them.
+     *
+     * The default is @c false.
+     * @see isEarlyShmBufferReleaseEnabled
+     * @see BufferInterface::contentsUploaded
+     * @since 5.67
+     **/
+    void setEarlyShmBufferReleaseEnabled(bool enabled);
+    /**
+     * @see setEarlyShmBufferReleaseEnabled
+     * @since 5.67
+     **/
+    bool isEarlyShmBufferReleaseEnabled() const;
+
 Q_SIGNALS:
     /**
      * Emitted whenever this CompositorInterface created a SurfaceInterface.
@@ -59,7 +144,10 @@ Q_SIGNALS:
 private:
     explicit CompositorInterface(Display *display, QObject *parent = nullptr);
     friend class Display;
+    friend class BufferInterface;
+    void queueBufferRelease(BufferInterface *buffer);
     class Private;
+    Private *d_func() const;
 };
 
 }
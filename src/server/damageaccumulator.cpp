@@ -0,0 +1,106 @@
+/********************************************************************
+Copyright 2020  agent <agent@local>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) version 3, or any
+later version accepted by the membership of KDE e.V. (or its
+successor approved by the membership of KDE e.V.), which shall
+act as a proxy defined in Section 6 of version 3 of the license.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#include "damageaccumulator_p.h"
+
+namespace KWayland
+{
+namespace Server
+{
+
+bool DamageAccumulator::useBoundingBox(int maxRects, qreal maxAreaOverhead, QRect *bounds) const
+{
+    qint64 area = 0;
+    for (const QRect &rect : m_rects) {
+        *bounds |= rect;
+        area += qint64(rect.width()) * rect.height();
+    }
+    const qint64 boundsArea = qint64(bounds->width()) * bounds->height();
+    // overlapping rectangles are counted multiple times, thus this underestimates the overhead
+    return (maxRects >= 0 && m_rects.count() > maxRects) ||
+            (maxAreaOverhead >= 0 && boundsArea <= area * (1.0 + maxAreaOverhead));
+}
+
+bool DamageAccumulator::simplify(int maxRects, qreal maxAreaOverhead)
+{
+    if (m_rects.count() < 2) {
+        return false;
+    }
+    QRect bounds;
+    if (!useBoundingBox(maxRects, maxAreaOverhead, &bounds)) {
+        return false;
+    }
+    // resizing down keeps the capacity
+    m_rects.resize(1);
+    m_rects[0] = bounds;
+    return true;
+}
+
+void DamageAccumulator::intersect(const QRect &rect)
+{
+    int kept = 0;
+    for (int i = 0; i < m_rects.count(); ++i) {
+        const QRect clipped = m_rects.at(i) & rect;
+        if (!clipped.isEmpty()) {
+            m_rects[kept++] = clipped;
+        }
+    }
+    m_rects.resize(kept);
+}
+
+QRegion DamageAccumulator::toRegion(int maxRects, qreal maxAreaOverhead, bool *boundingBox) const
+{
+    if (boundingBox) {
+        *boundingBox = false;
+    }
+    if (m_rects.isEmpty()) {
+        return QRegion();
+    }
+    if (m_rects.count() == 1) {
+        return QRegion(m_rects.first());
+    }
+    QRect bounds;
+    if (useBoundingBox(maxRects, maxAreaOverhead, &bounds)) {
+        if (boundingBox) {
+            *boundingBox = true;
+        }
+        return QRegion(bounds);
+    }
+    // unite pairwise, this keeps the regions on both sides of QRegion::united small
+    // instead of uniting each rectangle with the steadily growing result
+    QVector<QRegion> regions;
+    regions.reserve(m_rects.count());
+    for (const QRect &rect : m_rects) {
+        regions.append(QRegion(rect));
+    }
+    while (regions.count() > 1) {
+        int merged = 0;
+        for (int i = 0; i + 1 < regions.count(); i += 2) {
+            regions[merged++] = regions.at(i).united(regions.at(i + 1));
+        }
+        if (regions.count() % 2) {
+            regions[merged++] = regions.last();
+        }
+        regions.resize(merged);
+    }
+    return regions.first();
+}
+
+}
+}
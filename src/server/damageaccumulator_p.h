@@ -0,0 +1,121 @@
+/********************************************************************
+Copyright 2020  agent <agent@local>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) version 3, or any
+later version accepted by the membership of KDE e.V. (or its
+successor approved by the membership of KDE e.V.), which shall
+act as a proxy defined in Section 6 of version 3 of the license.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#ifndef WAYLAND_SERVER_DAMAGEACCUMULATOR_P_H
+#define WAYLAND_SERVER_DAMAGEACCUMULATOR_P_H
+
+#include <QRect>
+#include <QRegion>
+#include <QVector>
+
+namespace KWayland
+{
+namespace Server
+{
+
+/**
+ * @brief Collects damage rectangles and combines them into a QRegion once.
+ *
+ * Uniting a QRegion with every single damage request gets expensive for clients sending
+ * hundreds of rectangles per commit. The DamageAccumulator only stores the rectangles and
+ * combines them when the damage is needed, either into their bounding box or into the
+ * exact QRegion.
+ *
+ * @internal
+ **/
+class DamageAccumulator
+{
+public:
+    /**
+     * The defaults of CompositorInterface::damageRectsThreshold and
+     * CompositorInterface::damageAreaOverhead.
+     **/
+    static const int s_defaultMaxRects = 64;
+    static constexpr qreal s_defaultMaxAreaOverhead = 0.25;
+
+    void add(const QRect &rect) {
+        if (!rect.isEmpty()) {
+            m_rects.append(rect);
+        }
+    }
+    void clear() {
+        m_rects.clear();
+    }
+    bool isEmpty() const {
+        return m_rects.isEmpty();
+    }
+    int count() const {
+        return m_rects.count();
+    }
+    const QVector<QRect> &rects() const {
+        return m_rects;
+    }
+    /**
+     * Adds the rectangles of @p other translated by @p offset.
+     **/
+    void add(const DamageAccumulator &other, const QPoint &offset = QPoint()) {
+        for (const QRect &rect : other.m_rects) {
+            m_rects.append(rect.translated(offset));
+        }
+    }
+    void add(const QRegion &region) {
+        for (const QRect &rect : region) {
+            m_rects.append(rect);
+        }
+    }
+
+    /**
+     * Replaces the added rectangles by their bounding box if toRegion would use it, otherwise
+     * the rectangles are kept. Unlike toRegion this does not allocate.
+     *
+     * @returns whether the bounding box got used
+     * @see toRegion
+     **/
+    bool simplify(int maxRects, qreal maxAreaOverhead);
+    /**
+     * Clips the added rectangles to @p rect, rectangles outside of it get removed.
+     **/
+    void intersect(const QRect &rect);
+
+    /**
+     * Combines all added rectangles into a QRegion.
+     *
+     * The bounding box of the rectangles is used if more than @p maxRects rectangles got added
+     * or if the area of the bounding box exceeds the summed area of the rectangles by at most
+     * the factor @p maxAreaOverhead, e.g. @c 0.25 for 25 percent. A negative @p maxRects
+     * or @p maxAreaOverhead disables the respective check. @p boundingBox is set to whether
+     * the bounding box got used.
+     **/
+    QRegion toRegion(int maxRects, qreal maxAreaOverhead, bool *boundingBox = nullptr) const;
+    /**
+     * Combines all added rectangles into the exact QRegion.
+     **/
+    QRegion toRegion() const {
+        return toRegion(-1, -1);
+    }
+
+private:
+    bool useBoundingBox(int maxRects, qreal maxAreaOverhead, QRect *bounds) const;
+    QVector<QRect> m_rects;
+};
+
+}
+}
+
+#endif
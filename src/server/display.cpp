@@ -58,10 +58,12 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include "eglstream_controller_interface.h"
 #include "keystate_interface.h"
 #include "linuxdmabuf_v1_interface.h"
+#include "presentation_interface.h"
 
 #include <QCoreApplication>
 #include <QDebug>
 #include <QAbstractEventDispatcher>
+#include <QSet>
 #include <QSocketNotifier>
 #include <QThread>
 
@@ -80,6 +82,8 @@ public:
     Private(Display *q);
     void flush();
     void dispatch();
+    void scheduleFlush(ClientConnection *client);
+    void flushScheduledClients();
     void setRunning(bool running);
     void installSocketNotifier();
 
@@ -92,6 +96,8 @@ public:
     QList<OutputDeviceInterface*> outputdevices;
     QVector<SeatInterface*> seats;
     QVector<ClientConnection*> clients;
+    // clients with events waiting to be flushed in this event loop iteration
+    QSet<ClientConnection*> scheduledFlushes;
     EGLDisplay eglDisplay = EGL_NO_DISPLAY;
 
 private:
@@ -139,6 +145,30 @@ void Display::Private::flush()
         return;
     }
     wl_display_flush_clients(display);
+    scheduledFlushes.clear();
+}
+
+void Display::Private::scheduleFlush(ClientConnection *client)
+{
+    if (!running) {
+        // no event loop which could flush later on
+        client->flush();
+        return;
+    }
+    if (scheduledFlushes.isEmpty()) {
+        // aboutToBlock is not emitted while there are events to process, so don't rely on it
+        QMetaObject::invokeMethod(q, [this] { flushScheduledClients(); }, Qt::QueuedConnection);
+    }
+    scheduledFlushes.insert(client);
+}
+
+void Display::Private::flushScheduledClients()
+{
+    QSet<ClientConnection*> clients;
+    clients.swap(scheduledFlushes);
+    for (ClientConnection *client : qAsConst(clients)) {
+        client->flush();
+    }
 }
 
 void Display::Private::dispatch()
@@ -530,6 +560,13 @@ EglStreamControllerInterface *Display::createEglStreamControllerInterface(QObjec
     return e;
 }
 
+PresentationInterface *Display::createPresentation(QObject *parent)
+{
+    auto p = new PresentationInterface(this, parent);
+    connect(this, &Display::aboutToTerminate, p, [p] { delete p; });
+    return p;
+}
+
 KeyStateInterface *Display::createKeyStateInterface(QObject *parent)
 {
     auto d = new KeyStateInterface(this, parent);
@@ -615,6 +652,7 @@ ClientConnection *Display::getConnection(wl_client *client)
             Q_ASSERT(index != -1);
             d->clients.remove(index);
             Q_ASSERT(d->clients.indexOf(c) == -1);
+            d->scheduledFlushes.remove(c);
             emit clientDisconnected(c);
         }
     );
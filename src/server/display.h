@@ -93,6 +93,7 @@ class XdgDecorationManagerInterface;
 class EglStreamControllerInterface;
 class KeyStateInterface;
 class LinuxDmabufUnstableV1Interface;
+class PresentationInterface;
 
 /**
  * @brief Class holding the Wayland server display loop.
@@ -324,6 +325,14 @@ public:
      */
     EglStreamControllerInterface *createEglStreamControllerInterface(QObject *parent = nullptr);
 
+    /**
+     * Creates the PresentationInterface
+     *
+     * @return the created presentation-time global
+     * @since 5.67
+     */
+    PresentationInterface *createPresentation(QObject *parent = nullptr);
+
     /**
      * Gets the ClientConnection for the given @p client.
      * If there is no ClientConnection yet for the given @p client, it will be created.
@@ -359,6 +368,7 @@ Q_SIGNALS:
     void clientDisconnected(KWayland::Server::ClientConnection*);
 
 private:
+    friend class ClientConnection;
     class Private;
     QScopedPointer<Private> d;
 };
@@ -58,15 +58,13 @@ void KeyboardInterface::Private::sendLeave(SurfaceInterface *surface, quint32 se
 
 void KeyboardInterface::Private::sendEnter(SurfaceInterface *surface, quint32 serial)
 {
+    // the pressed keys are shared with the seat, the wl_array only references them
+    const QVector<quint32> states = seat->pressedKeys();
     wl_array keys;
-    wl_array_init(&keys);
-    const auto states = seat->pressedKeys();
-    for (auto it = states.constBegin(); it != states.constEnd(); ++it) {
-        uint32_t *k = reinterpret_cast<uint32_t*>(wl_array_add(&keys, sizeof(uint32_t)));
-        *k = *it;
-    }
+    keys.size = states.count() * sizeof(quint32);
+    keys.alloc = 0;
+    keys.data = const_cast<quint32*>(states.constData());
     wl_keyboard_send_enter(resource, serial, surface->resource(), &keys);
-    wl_array_release(&keys);
 
     sendModifiers();
 }
@@ -134,7 +132,7 @@ void KeyboardInterface::setFocusedSurface(SurfaceInterface *surface, quint32 ser
     d->focusedChildSurface = QPointer<SurfaceInterface>(surface);
 
     d->sendEnter(d->focusedSurface, serial);
-    d->client->flush();
+    d->client->scheduleFlush();
 }
 
 void KeyboardInterface::keyPressed(quint32 key, quint32 serial)
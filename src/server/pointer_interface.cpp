@@ -132,6 +132,46 @@ void PointerInterface::Private::sendEnter(SurfaceInterface *surface, const QPoin
                           wl_fixed_from_double(adjustedPos.x()), wl_fixed_from_double(adjustedPos.y()));
 }
 
+void PointerInterface::Private::updatePosition(bool sendFrameEvent)
+{
+    if (!focusedSurface || !resource) {
+        return;
+    }
+    if (seat->isDragPointer()) {
+        const auto *originSurface = seat->dragSource()->origin();
+        const bool proxyRemoteFocused = originSurface->dataProxy() && originSurface == focusedSurface;
+        if (!proxyRemoteFocused) {
+            // handled by DataDevice
+            return;
+        }
+    }
+    if (!focusedSurface->lockedPointer().isNull() && focusedSurface->lockedPointer()->isLocked()) {
+        return;
+    }
+    const QPointF pos = seat->focusedPointerSurfaceTransformation().map(seat->pointerPos());
+    auto targetSurface = focusedSurface->inputSurfaceAt(pos);
+    if (!targetSurface) {
+        targetSurface = focusedSurface;
+    }
+    if (targetSurface != focusedChildSurface.data()) {
+        const quint32 serial = seat->display()->nextSerial();
+        sendLeave(focusedChildSurface.data(), serial);
+        focusedChildSurface = QPointer<SurfaceInterface>(targetSurface);
+        sendEnter(targetSurface, pos, serial);
+        if (sendFrameEvent) {
+            sendFrame();
+            client->scheduleFlush();
+        }
+    } else {
+        const QPointF adjustedPos = pos - surfacePosition(focusedChildSurface);
+        wl_pointer_send_motion(resource, seat->timestamp(),
+                               wl_fixed_from_double(adjustedPos.x()), wl_fixed_from_double(adjustedPos.y()));
+        if (sendFrameEvent) {
+            sendFrame();
+        }
+    }
+}
+
 void PointerInterface::Private::startSwipeGesture(quint32 serial, quint32 fingerCount)
 {
     if (swipeGestures.isEmpty()) {
@@ -230,42 +270,6 @@ const struct wl_pointer_interface PointerInterface::Private::s_interface = {
 PointerInterface::PointerInterface(SeatInterface *parent, wl_resource *parentResource)
     : Resource(new Private(parent, parentResource, this))
 {
-    // TODO: handle touch
-    connect(parent, &SeatInterface::pointerPosChanged, this, [this] {
-        Q_D();
-        if (!d->focusedSurface || !d->resource) {
-            return;
-        }
-        if (d->seat->isDragPointer()) {
-            const auto *originSurface = d->seat->dragSource()->origin();
-            const bool proxyRemoteFocused = originSurface->dataProxy() && originSurface == d->focusedSurface;
-            if (!proxyRemoteFocused) {
-                // handled by DataDevice
-                return;
-            }
-        }
-        if (!d->focusedSurface->lockedPointer().isNull() && d->focusedSurface->lockedPointer()->isLocked()) {
-            return;
-        }
-        const QPointF pos = d->seat->focusedPointerSurfaceTransformation().map(d->seat->pointerPos());
-        auto targetSurface = d->focusedSurface->inputSurfaceAt(pos);
-        if (!targetSurface) {
-            targetSurface = d->focusedSurface;
-        }
-        if (targetSurface != d->focusedChildSurface.data()) {
-            const quint32 serial = d->seat->display()->nextSerial();
-            d->sendLeave(d->focusedChildSurface.data(), serial);
-            d->focusedChildSurface = QPointer<SurfaceInterface>(targetSurface);
-            d->sendEnter(targetSurface, pos, serial);
-            d->sendFrame();
-            d->client->flush();
-        } else {
-            const QPointF adjustedPos = pos - surfacePosition(d->focusedChildSurface);
-            wl_pointer_send_motion(d->resource, d->seat->timestamp(),
-                                   wl_fixed_from_double(adjustedPos.x()), wl_fixed_from_double(adjustedPos.y()));
-            d->sendFrame();
-        }
-    });
 }
 
 PointerInterface::~PointerInterface() = default;
@@ -297,7 +301,7 @@ void PointerInterface::setFocusedSurface(SurfaceInterface *surface, quint32 seri
         d->focusedChildSurface = QPointer<SurfaceInterface>(d->focusedSurface);
     }
     d->sendEnter(d->focusedChildSurface.data(), pos, serial);
-    d->client->flush();
+    d->client->scheduleFlush();
 }
 
 void PointerInterface::buttonPressed(quint32 button, quint32 serial)
@@ -322,15 +326,13 @@ void PointerInterface::buttonReleased(quint32 button, quint32 serial)
     d->sendFrame();
 }
 
-void PointerInterface::axis(Qt::Orientation orientation, qreal delta, qint32 discreteDelta, PointerAxisSource source)
+void PointerInterface::Private::sendAxis(Qt::Orientation orientation, qreal delta, qint32 discreteDelta, PointerAxisSource source)
 {
-    Q_D();
-    Q_ASSERT(d->focusedSurface);
-    if (!d->resource) {
+    if (!resource) {
         return;
     }
 
-    const quint32 version = wl_resource_get_version(d->resource);
+    const quint32 version = wl_resource_get_version(resource);
 
     const auto wlOrientation = (orientation == Qt::Vertical)
         ? WL_POINTER_AXIS_VERTICAL_SCROLL
@@ -355,18 +357,27 @@ void PointerInterface::axis(Qt::Orientation orientation, qreal delta, qint32 dis
             Q_UNREACHABLE();
             break;
         }
-        wl_pointer_send_axis_source(d->resource, wlSource);
+        wl_pointer_send_axis_source(resource, wlSource);
     }
 
     if (delta != 0.0) {
         if (discreteDelta && version >= WL_POINTER_AXIS_DISCRETE_SINCE_VERSION) {
-            wl_pointer_send_axis_discrete(d->resource, wlOrientation, discreteDelta);
+            wl_pointer_send_axis_discrete(resource, wlOrientation, discreteDelta);
         }
-        wl_pointer_send_axis(d->resource, d->seat->timestamp(), wlOrientation, wl_fixed_from_double(delta));
+        wl_pointer_send_axis(resource, seat->timestamp(), wlOrientation, wl_fixed_from_double(delta));
     } else if (version >= WL_POINTER_AXIS_STOP_SINCE_VERSION) {
-        wl_pointer_send_axis_stop(d->resource, d->seat->timestamp(), wlOrientation);
+        wl_pointer_send_axis_stop(resource, seat->timestamp(), wlOrientation);
     }
+}
 
+void PointerInterface::axis(Qt::Orientation orientation, qreal delta, qint32 discreteDelta, PointerAxisSource source)
+{
+    Q_D();
+    Q_ASSERT(d->focusedSurface);
+    if (!d->resource) {
+        return;
+    }
+    d->sendAxis(orientation, delta, discreteDelta, source);
     d->sendFrame();
 }
 
@@ -397,16 +408,23 @@ Cursor *PointerInterface::cursor() const
     return d->cursor;
 }
 
-void PointerInterface::relativeMotion(const QSizeF &delta, const QSizeF &deltaNonAccelerated, quint64 microseconds)
+bool PointerInterface::Private::sendRelativeMotion(const QSizeF &delta, const QSizeF &deltaNonAccelerated, quint64 microseconds)
 {
-    Q_D();
-    if (d->relativePointers.isEmpty()) {
-        return;
+    if (relativePointers.isEmpty()) {
+        return false;
     }
-    for (auto it = d->relativePointers.constBegin(), end = d->relativePointers.constEnd(); it != end; it++) {
+    for (auto it = relativePointers.constBegin(), end = relativePointers.constEnd(); it != end; it++) {
         (*it)->relativeMotion(delta, deltaNonAccelerated, microseconds);
     }
-    d->sendFrame();
+    return true;
+}
+
+void PointerInterface::relativeMotion(const QSizeF &delta, const QSizeF &deltaNonAccelerated, quint64 microseconds)
+{
+    Q_D();
+    if (d->sendRelativeMotion(delta, deltaNonAccelerated, microseconds)) {
+        d->sendFrame();
+    }
 }
 
 PointerInterface::Private *PointerInterface::d_func() const
@@ -50,6 +50,21 @@ public:
     void sendLeave(SurfaceInterface *surface, quint32 serial);
     void sendEnter(SurfaceInterface *surface, const QPointF &parentSurfacePosition, quint32 serial);
     void sendFrame();
+    /**
+     * Sends the current pointer position of the seat to the focused surface,
+     * invoked by the SeatInterface for the focused pointers only.
+     * Without @p sendFrameEvent the caller has to send the frame event.
+     **/
+    void updatePosition(bool sendFrameEvent = true);
+    /**
+     * Sends the axis events without a frame event.
+     **/
+    void sendAxis(Qt::Orientation orientation, qreal delta, qint32 discreteDelta, PointerAxisSource source);
+    /**
+     * Sends the relative motion to all relative pointers without a frame event.
+     * @returns whether there was a relative pointer to send the motion to
+     **/
+    bool sendRelativeMotion(const QSizeF &delta, const QSizeF &deltaNonAccelerated, quint64 microseconds);
 
     void registerRelativePointer(RelativePointerInterface *relativePointer);
     void registerSwipeGesture(PointerSwipeGestureInterface *gesture);
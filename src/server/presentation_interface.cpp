@@ -0,0 +1,119 @@
+/********************************************************************
+Copyright 2020  agent <agent@local>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) version 3, or any
+later version accepted by the membership of KDE e.V. (or its
+successor approved by the membership of KDE e.V.), which shall
+act as a proxy defined in Section 6 of version 3 of the license.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#include "presentation_interface.h"
+#include "display.h"
+#include "global_p.h"
+#include "surface_interface.h"
+#include "surface_interface_p.h"
+// Wayland
+#include <wayland-server.h>
+#include <wayland-presentation-time-server-protocol.h>
+
+namespace KWayland
+{
+namespace Server
+{
+
+class PresentationInterface::Private : public Global::Private
+{
+public:
+    Private(Display *d);
+
+    clockid_t clockId = CLOCK_MONOTONIC;
+
+private:
+    void bind(wl_client *client, uint32_t version, uint32_t id) override;
+
+    static void destroyCallback(wl_client *client, wl_resource *resource);
+    static void feedbackCallback(wl_client *client, wl_resource *resource, wl_resource *surface, uint32_t callback);
+
+    static const struct wp_presentation_interface s_interface;
+    static const quint32 s_version;
+};
+
+const quint32 PresentationInterface::Private::s_version = 1;
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+const struct wp_presentation_interface PresentationInterface::Private::s_interface = {
+    destroyCallback,
+    feedbackCallback
+};
+#endif
+
+PresentationInterface::Private::Private(Display *d)
+    : Global::Private(d, &wp_presentation_interface, s_version)
+{
+}
+
+void PresentationInterface::Private::bind(wl_client *client, uint32_t version, uint32_t id)
+{
+    auto c = display->getConnection(client);
+    wl_resource *resource = c->createResource(&wp_presentation_interface, qMin(version, s_version), id);
+    if (!resource) {
+        wl_client_post_no_memory(client);
+        return;
+    }
+    wl_resource_set_implementation(resource, &s_interface, this, nullptr);
+    wp_presentation_send_clock_id(resource, clockId);
+}
+
+void PresentationInterface::Private::destroyCallback(wl_client *client, wl_resource *resource)
+{
+    Q_UNUSED(client)
+    wl_resource_destroy(resource);
+}
+
+void PresentationInterface::Private::feedbackCallback(wl_client *client, wl_resource *resource, wl_resource *surface, uint32_t callback)
+{
+    Q_UNUSED(client)
+    Q_UNUSED(resource)
+    SurfaceInterface *s = SurfaceInterface::get(surface);
+    if (!s) {
+        return;
+    }
+    s->d_func()->addPresentationFeedback(callback);
+}
+
+PresentationInterface::PresentationInterface(Display *display, QObject *parent)
+    : Global(new Private(display), parent)
+{
+}
+
+PresentationInterface::~PresentationInterface() = default;
+
+PresentationInterface::Private *PresentationInterface::d_func() const
+{
+    return reinterpret_cast<Private*>(d.data());
+}
+
+void PresentationInterface::setClockId(clockid_t clockId)
+{
+    Q_D();
+    d->clockId = clockId;
+}
+
+clockid_t PresentationInterface::clockId() const
+{
+    Q_D();
+    return d->clockId;
+}
+
+}
+}
@@ -0,0 +1,108 @@
+/********************************************************************
+Copyright 2020  agent <agent@local>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) version 3, or any
+later version accepted by the membership of KDE e.V. (or its
+successor approved by the membership of KDE e.V.), which shall
+act as a proxy defined in Section 6 of version 3 of the license.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#ifndef WAYLAND_SERVER_PRESENTATION_INTERFACE_H
+#define WAYLAND_SERVER_PRESENTATION_INTERFACE_H
+
+#include "global.h"
+
+#include <QObject>
+
+#include <KWayland/Server/kwaylandserver_export.h>
+
+#include <time.h>
+
+namespace KWayland
+{
+namespace Server
+{
+
+class Display;
+
+/**
+ * @brief Represents the Global for the wp_presentation interface.
+ *
+ * The presentation-time protocol allows clients to request feedback about when the
+ * content of a commit got shown on an output. A client asks for the feedback per commit
+ * of a SurfaceInterface. The compositor reports the presentation through
+ * SurfaceInterface::presented or tells that the content never got shown through
+ * SurfaceInterface::presentationDiscarded. The feedback of a commit which gets replaced
+ * by a later commit before being presented is discarded automatically.
+ *
+ * All timestamps passed to SurfaceInterface::presented have to be in the domain of
+ * the clock announced through clockId.
+ *
+ * @see SurfaceInterface::presented
+ * @since 5.67
+ **/
+class KWAYLANDSERVER_EXPORT PresentationInterface : public Global
+{
+    Q_OBJECT
+public:
+    virtual ~PresentationInterface();
+
+    /**
+     * Describes how the content got presented, maps to wp_presentation_feedback.kind.
+     **/
+    enum class Kind {
+        /**
+         * The presentation was synchronized to the vertical retrace of the output.
+         **/
+        Vsync = 0x1,
+        /**
+         * The timestamp is provided by the hardware instead of being sampled in software.
+         **/
+        HwClock = 0x2,
+        /**
+         * The hardware signalled the completion of the presentation.
+         **/
+        HwCompletion = 0x4,
+        /**
+         * The buffer got scanned out directly without being copied by the compositor.
+         **/
+        ZeroCopy = 0x8
+    };
+    Q_DECLARE_FLAGS(Kinds, Kind)
+
+    /**
+     * Sets the clock the presentation timestamps are based on. The clock is announced to
+     * a client when it binds the global, so it has to be set before clients bind.
+     *
+     * The default is @c CLOCK_MONOTONIC.
+     * @see clockId
+     **/
+    void setClockId(clockid_t clockId);
+    /**
+     * @see setClockId
+     **/
+    clockid_t clockId() const;
+
+private:
+    explicit PresentationInterface(Display *display, QObject *parent = nullptr);
+    friend class Display;
+    class Private;
+    Private *d_func() const;
+};
+
+}
+}
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(KWayland::Server::PresentationInterface::Kinds)
+
+#endif
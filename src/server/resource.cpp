@@ -28,8 +28,6 @@ namespace KWayland
 namespace Server
 {
 
-QList<Resource::Private*> Resource::Private::s_allResources;
-
 Resource::Private::Private(Resource *q, Global *g, wl_resource *parentResource, const wl_interface *interface, const void *implementation)
     : parentResource(parentResource)
     , global(g)
@@ -37,12 +35,14 @@ Resource::Private::Private(Resource *q, Global *g, wl_resource *parentResource,
     , m_interface(interface)
     , m_interfaceImplementation(implementation)
 {
-    s_allResources << this;
+    m_destroyListener.listener.notify = destroyListenerCallback;
+    m_destroyListener.listener.link.prev = nullptr;
+    m_destroyListener.listener.link.next = nullptr;
+    m_destroyListener.p = this;
 }
 
 Resource::Private::~Private()
 {
-    s_allResources.removeAll(this);
     if (resource) {
         wl_resource_destroy(resource);
     }
@@ -58,6 +58,43 @@ void Resource::Private::create(ClientConnection *c, quint32 version, quint32 id)
         return;
     }
     wl_resource_set_implementation(resource, m_interfaceImplementation, this, unbind);
+    wl_resource_add_destroy_listener(resource, &m_destroyListener.listener);
+}
+
+Resource::Private *Resource::Private::fromResource(wl_resource *native)
+{
+    if (!native) {
+        return nullptr;
+    }
+    wl_listener *listener = wl_resource_get_destroy_listener(native, destroyListenerCallback);
+    if (!listener) {
+        return nullptr;
+    }
+    return reinterpret_cast<DestroyListener*>(listener)->p;
+}
+
+Resource::Private *Resource::Private::fromResource(quint32 id, const ClientConnection *c)
+{
+    if (!c) {
+        return nullptr;
+    }
+    wl_client *native = *c;
+    if (!native) {
+        return nullptr;
+    }
+    Private *p = fromResource(wl_client_get_object(native, id));
+    if (!p || p->client != c) {
+        return nullptr;
+    }
+    return p;
+}
+
+void Resource::Private::destroyListenerCallback(wl_listener *listener, void *data)
+{
+    Q_UNUSED(data)
+    // the listener only tags the resource, just make sure it's unlinked
+    wl_list_remove(&listener->link);
+    wl_list_init(&listener->link);
 }
 
 void Resource::Private::unbind(wl_resource *r)
@@ -21,6 +21,7 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #define WAYLAND_SERVER_RESOURCE_P_H
 
 #include "resource.h"
+// Wayland
 #include <wayland-server.h>
 #include <type_traits>
 
@@ -44,32 +45,22 @@ public:
     static ResourceDerived *get(wl_resource *native) {
         static_assert(std::is_base_of<Resource, ResourceDerived>::value,
                       "ResourceDerived must be derived from Resource");
-        if (!native) {
+        Private *p = fromResource(native);
+        if (!p) {
             return nullptr;
         }
-        auto it = std::find_if(s_allResources.constBegin(), s_allResources.constEnd(),
-            [native](Private *p) {
-                return p->resource == native;
-            }
-        );
-        if (it == s_allResources.constEnd()) {
-            return nullptr;
-        }
-        return reinterpret_cast<ResourceDerived*>((*it)->q);
+        // rejects resources of a different interface
+        return qobject_cast<ResourceDerived*>(p->q);
     }
     template <typename ResourceDerived>
     static ResourceDerived *get(quint32 id, const ClientConnection *c) {
         static_assert(std::is_base_of<Resource, ResourceDerived>::value,
                       "ResourceDerived must be derived from Resource");
-        auto it = std::find_if(s_allResources.constBegin(), s_allResources.constEnd(),
-            [id, c](Private *p) {
-                return c == p->client && p->resource && wl_resource_get_id(p->resource) == id;
-            }
-        );
-        if (it == s_allResources.constEnd()) {
+        Private *p = fromResource(id, c);
+        if (!p) {
             return nullptr;
         }
-        return reinterpret_cast<ResourceDerived*>((*it)->q);
+        return qobject_cast<ResourceDerived*>(p->q);
     }
 
 protected:
@@ -85,9 +76,25 @@ protected:
     static void resourceDestroyedCallback(wl_client *client, wl_resource *resource);
 
     Resource *q;
-    static QList<Private*> s_allResources;
 
 private:
+    /**
+     * Resolves the Private for a wl_resource created through create in constant time.
+     * Resources not created by a Resource::Private are rejected.
+     **/
+    static Private *fromResource(wl_resource *native);
+    /**
+     * Resolves the Private for the object @p id of client @p c through the
+     * client's object map, thus only depending on that client's objects.
+     **/
+    static Private *fromResource(quint32 id, const ClientConnection *c);
+    static void destroyListenerCallback(wl_listener *listener, void *data);
+
+    // registered on the destroy signal of resource, used as a tag to find this Private
+    struct DestroyListener {
+        wl_listener listener;
+        Private *p;
+    } m_destroyListener;
     const wl_interface *const m_interface;
     const void *const m_interfaceImplementation;
 };
@@ -19,6 +19,7 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 *********************************************************************/
 #include "seat_interface.h"
 #include "seat_interface_p.h"
+#include "clientconnection.h"
 #include "display.h"
 #include "datadevice_interface.h"
 #include "datasource_interface.h"
@@ -28,6 +29,8 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include "pointer_interface_p.h"
 #include "surface_interface.h"
 #include "textinput_interface_p.h"
+// Qt
+#include <QTimer>
 // Wayland
 #ifndef WL_SEAT_NAME_SINCE_VERSION
 #define WL_SEAT_NAME_SINCE_VERSION 2
@@ -38,6 +41,7 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include <linux/input.h>
 #endif
 
+#include <algorithm>
 #include <functional>
 
 namespace KWayland
@@ -143,15 +147,25 @@ void SeatInterface::Private::updatePointerButtonState(quint32 button, Pointer::S
 
 bool SeatInterface::Private::updateKey(quint32 key, Keyboard::State state)
 {
-    auto it = keys.states.find(key);
-    if (it == keys.states.end()) {
-        keys.states.insert(key, state);
-        return true;
+    const bool isPressed = state == Keyboard::State::Pressed;
+    if (key < Keyboard::s_keyCount) {
+        if (keys.knownBits.test(key) && keys.pressedBits.test(key) == isPressed) {
+            return false;
+        }
+        keys.knownBits.set(key);
+        keys.pressedBits.set(key, isPressed);
+    } else {
+        auto it = keys.overflowStates.find(key);
+        if (it != keys.overflowStates.end() && it.value() == state) {
+            return false;
+        }
+        keys.overflowStates.insert(key, state);
     }
-    if (it.value() == state) {
-        return false;
+    if (isPressed) {
+        keys.pressed.append(key);
+    } else {
+        keys.pressed.removeOne(key);
     }
-    it.value() = state;
     return true;
 }
 
@@ -183,90 +197,109 @@ SeatInterface::Private *SeatInterface::Private::cast(wl_resource *r)
     return r ? reinterpret_cast<SeatInterface::Private*>(wl_resource_get_user_data(r)) : nullptr;
 }
 
-namespace {
 template <typename T>
-static
-T *interfaceForSurface(SurfaceInterface *surface, const QVector<T*> &interfaces)
+void SeatInterface::Private::addClientDevice(ClientConnection *client, QVector<T*> ClientDevices::*devices, T *device)
+{
+    (clientDevices[client].*devices) << device;
+}
+
+template <typename T>
+void SeatInterface::Private::removeClientDevice(ClientConnection *client, QVector<T*> ClientDevices::*devices, T *device)
+{
+    auto it = clientDevices.find(client);
+    if (it == clientDevices.end()) {
+        return;
+    }
+    (it.value().*devices).removeOne(device);
+    if (it.value().isEmpty()) {
+        clientDevices.erase(it);
+    }
+}
+
+template <typename T>
+T *SeatInterface::Private::interfaceForSurface(SurfaceInterface *surface, QVector<T*> ClientDevices::*devices) const
 {
     if (!surface) {
         return nullptr;
     }
-
-    for (auto it = interfaces.constBegin(); it != interfaces.constEnd(); ++it) {
-        if ((*it)->client() == surface->client()) {
-            return (*it);
-        }
+    auto it = clientDevices.constFind(surface->client());
+    if (it == clientDevices.constEnd() || (it.value().*devices).isEmpty()) {
+        return nullptr;
     }
-    return nullptr;
+    return (it.value().*devices).first();
 }
 
 template <typename T>
-static
-QVector<T *> interfacesForSurface(SurfaceInterface *surface, const QVector<T*> &interfaces)
+QVector<T*> SeatInterface::Private::interfacesForSurface(SurfaceInterface *surface, QVector<T*> ClientDevices::*devices) const
 {
-    QVector<T *> ret;
     if (!surface) {
-        return ret;
+        return QVector<T*>();
     }
-
+    auto clientIt = clientDevices.constFind(surface->client());
+    if (clientIt == clientDevices.constEnd()) {
+        return QVector<T*>();
+    }
+    const QVector<T*> &interfaces = clientIt.value().*devices;
+    // usually all interfaces still have their resource, so the list can be shared
+    if (std::all_of(interfaces.constBegin(), interfaces.constEnd(), [] (T *t) { return t->resource(); })) {
+        return interfaces;
+    }
+    QVector<T*> ret;
     for (auto it = interfaces.constBegin(); it != interfaces.constEnd(); ++it) {
-        if ((*it)->client() == surface->client() && (*it)->resource()) {
+        if ((*it)->resource()) {
             ret << *it;
         }
     }
     return ret;
 }
 
+namespace {
 template <typename T>
 static
-bool forEachInterface(SurfaceInterface *surface, const QVector<T*> &interfaces, std::function<void (T*)> method)
+bool forEachInterface(const QVector<T*> &interfaces, std::function<void (T*)> method)
 {
-    if (!surface) {
-        return false;
-    }
-    bool calledAtLeastOne = false;
     for (auto it = interfaces.constBegin(); it != interfaces.constEnd(); ++it) {
-        if ((*it)->client() == surface->client() && (*it)->resource()) {
-            method(*it);
-            calledAtLeastOne = true;
-        }
+        method(*it);
     }
-    return calledAtLeastOne;
+    return !interfaces.isEmpty();
 }
 
 }
 
 QVector<PointerInterface *> SeatInterface::Private::pointersForSurface(SurfaceInterface *surface) const
 {
-    return interfacesForSurface(surface, pointers);
+    return interfacesForSurface(surface, &ClientDevices::pointers);
 }
 
 QVector<KeyboardInterface *> SeatInterface::Private::keyboardsForSurface(SurfaceInterface *surface) const
 {
-    return interfacesForSurface(surface, keyboards);
+    return interfacesForSurface(surface, &ClientDevices::keyboards);
 }
 
 QVector<TouchInterface *> SeatInterface::Private::touchsForSurface(SurfaceInterface *surface) const
 {
-    return interfacesForSurface(surface, touchs);
+    return interfacesForSurface(surface, &ClientDevices::touchs);
 }
 
 DataDeviceInterface *SeatInterface::Private::dataDeviceForSurface(SurfaceInterface *surface) const
 {
-    return interfaceForSurface(surface, dataDevices);
+    return interfaceForSurface(surface, &ClientDevices::dataDevices);
 }
 
 TextInputInterface *SeatInterface::Private::textInputForSurface(SurfaceInterface *surface) const
 {
-    return interfaceForSurface(surface, textInputs);
+    return interfaceForSurface(surface, &ClientDevices::textInputs);
 }
 
 void SeatInterface::Private::registerDataDevice(DataDeviceInterface *dataDevice)
 {
     Q_ASSERT(dataDevice->seat() == q);
     dataDevices << dataDevice;
-    auto dataDeviceCleanup = [this, dataDevice] {
+    ClientConnection *client = dataDevice->client();
+    addClientDevice(client, &ClientDevices::dataDevices, dataDevice);
+    auto dataDeviceCleanup = [this, dataDevice, client] {
         dataDevices.removeOne(dataDevice);
+        removeClientDevice(client, &ClientDevices::dataDevices, dataDevice);
         if (keys.focus.selection == dataDevice) {
             keys.focus.selection = nullptr;
         }
@@ -297,11 +330,11 @@ void SeatInterface::Private::registerDataDevice(DataDeviceInterface *dataDevice)
             auto *dragSurface = dataDevice->origin();
             if (q->hasImplicitPointerGrab(dragSerial)) {
                 drag.mode = Drag::Mode::Pointer;
-                drag.sourcePointer = interfaceForSurface(dragSurface, pointers);
+                drag.sourcePointer = interfaceForSurface(dragSurface, &ClientDevices::pointers);
                 drag.transformation = globalPointer.focus.transformation;
             } else if (q->hasImplicitTouchGrab(dragSerial)) {
                 drag.mode = Drag::Mode::Touch;
-                drag.sourceTouch = interfaceForSurface(dragSurface, touchs);
+                drag.sourceTouch = interfaceForSurface(dragSurface, &ClientDevices::touchs);
                 // TODO: touch transformation
             } else {
                 // no implicit grab, abort drag
@@ -317,7 +350,7 @@ void SeatInterface::Private::registerDataDevice(DataDeviceInterface *dataDevice)
                 drag.transformation = globalPointer.focus.transformation;
             }
             drag.source = dataDevice;
-            drag.sourcePointer = interfaceForSurface(originSurface, pointers);
+            drag.sourcePointer = interfaceForSurface(originSurface, &ClientDevices::pointers);
             drag.destroyConnection = QObject::connect(dataDevice, &QObject::destroyed, q,
                 [this] {
                     endDrag(display->nextSerial());
@@ -362,6 +395,8 @@ void SeatInterface::Private::registerTextInput(TextInputInterface *ti)
         return;
     }
     textInputs << ti;
+    ClientConnection *client = ti->client();
+    addClientDevice(client, &ClientDevices::textInputs, ti);
     if (textInput.focus.surface && textInput.focus.surface->client() == ti->client()) {
         // this is a text input for the currently focused text input surface
         if (!textInput.focus.textInput) {
@@ -371,8 +406,9 @@ void SeatInterface::Private::registerTextInput(TextInputInterface *ti)
         }
     }
     QObject::connect(ti, &QObject::destroyed, q,
-        [this, ti] {
+        [this, ti, client] {
             textInputs.removeAt(textInputs.indexOf(ti));
+            removeClientDevice(client, &ClientDevices::textInputs, ti);
             if (textInput.focus.textInput == ti) {
                 textInput.focus.textInput = nullptr;
                 emit q->focusedTextInputChanged();
@@ -495,6 +531,7 @@ void SeatInterface::Private::getPointer(wl_client *client, wl_resource *resource
         return;
     }
     pointers << pointer;
+    addClientDevice(clientConnection, &ClientDevices::pointers, pointer);
     if (globalPointer.focus.surface && globalPointer.focus.surface->client() == clientConnection) {
         // this is a pointer for the currently focused pointer surface
         globalPointer.focus.pointers << pointer;
@@ -506,8 +543,9 @@ void SeatInterface::Private::getPointer(wl_client *client, wl_resource *resource
         }
     }
     QObject::connect(pointer, &QObject::destroyed, q,
-        [pointer,this] {
+        [pointer, clientConnection, this] {
             pointers.removeAt(pointers.indexOf(pointer));
+            removeClientDevice(clientConnection, &ClientDevices::pointers, pointer);
             if (globalPointer.focus.pointers.removeOne(pointer)) {
                 if (globalPointer.focus.pointers.isEmpty()) {
                     emit q->focusedPointerChanged(nullptr);
@@ -539,14 +577,16 @@ void SeatInterface::Private::getKeyboard(wl_client *client, wl_resource *resourc
         keyboard->setKeymap(keys.keymap.fd, keys.keymap.size);
     }
     keyboards << keyboard;
+    addClientDevice(clientConnection, &ClientDevices::keyboards, keyboard);
     if (keys.focus.surface && keys.focus.surface->client() == clientConnection) {
         // this is a keyboard for the currently focused keyboard surface
         keys.focus.keyboards << keyboard;
         keyboard->setFocusedSurface(keys.focus.surface, keys.focus.serial);
     }
     QObject::connect(keyboard, &QObject::destroyed, q,
-        [keyboard,this] {
+        [keyboard, clientConnection, this] {
             keyboards.removeAt(keyboards.indexOf(keyboard));
+            removeClientDevice(clientConnection, &ClientDevices::keyboards, keyboard);
             keys.focus.keyboards.removeOne(keyboard);
         }
     );
@@ -570,6 +610,7 @@ void SeatInterface::Private::getTouch(wl_client *client, wl_resource *resource,
         return;
     }
     touchs << touch;
+    addClientDevice(clientConnection, &ClientDevices::touchs, touch);
     if (globalTouch.focus.surface && globalTouch.focus.surface->client() == clientConnection) {
         // this is a touch for the currently focused touch surface
         globalTouch.focus.touchs << touch;
@@ -578,8 +619,9 @@ void SeatInterface::Private::getTouch(wl_client *client, wl_resource *resource,
         }
     }
     QObject::connect(touch, &QObject::destroyed, q,
-        [touch,this] {
+        [touch, clientConnection, this] {
             touchs.removeAt(touchs.indexOf(touch));
+            removeClientDevice(clientConnection, &ClientDevices::touchs, touch);
             globalTouch.focus.touchs.removeOne(touch);
         }
     );
@@ -633,6 +675,20 @@ void SeatInterface::setPointerPos(const QPointF &pos)
         return;
     }
     d->globalPointer.pos = pos;
+    if (d->pointerCoalescing.enabled) {
+        if (d->globalPointer.focus.surface) {
+            // the pending motion event sends the latest position
+            if (d->pointerCoalescing.motion) {
+                d->pointerCoalescing.coalescedEvents++;
+            }
+            d->pointerCoalescing.motion = true;
+            d->schedulePointerFlush();
+        }
+    } else if (d->globalPointer.focus.surface) {
+        for (auto it = d->globalPointer.focus.pointers.constBegin(), end = d->globalPointer.focus.pointers.constEnd(); it != end; ++it) {
+            (*it)->d_func()->updatePosition();
+        }
+    }
     emit pointerPosChanged(pos);
 }
 
@@ -717,6 +773,8 @@ void SeatInterface::setFocusedPointerSurface(SurfaceInterface *surface, const QM
         // ignore
         return;
     }
+    // the pending events belong to the previously focused surface
+    flushPointerEvents();
     const quint32 serial = d->display->nextSerial();
     QSet<PointerInterface *> framePointers;
     for (auto it = d->globalPointer.focus.pointers.constBegin(), end = d->globalPointer.focus.pointers.constEnd(); it != end; ++it) {
@@ -853,6 +911,27 @@ void SeatInterface::pointerAxisV5(Qt::Orientation orientation, qreal delta, qint
         // ignore
         return;
     }
+    if (d->pointerCoalescing.enabled && d->globalPointer.focus.surface) {
+        auto &coalescing = d->pointerCoalescing;
+        auto &axis = coalescing.axes[Private::PointerCoalescing::axisIndex(orientation)];
+        const auto &otherAxis = coalescing.axes[Private::PointerCoalescing::axisIndex(orientation == Qt::Vertical ? Qt::Horizontal : Qt::Vertical)];
+        // a frame can only have one axis source and the axis stop has to follow the axis events
+        if ((axis.pending && axis.source != source) || (otherAxis.pending && otherAxis.source != source)) {
+            flushPointerEvents();
+        }
+        if (delta != 0.0) {
+            if (axis.pending) {
+                coalescing.coalescedEvents++;
+            }
+            axis.pending = true;
+            axis.delta += delta;
+            axis.discreteDelta += discreteDelta;
+            axis.source = source;
+            d->schedulePointerFlush();
+            return;
+        }
+        flushPointerEvents();
+    }
     if (d->globalPointer.focus.surface) {
         for (auto it = d->globalPointer.focus.pointers.constBegin(), end = d->globalPointer.focus.pointers.constEnd(); it != end; ++it) {
             (*it)->axis(orientation, delta, discreteDelta, source);
@@ -867,6 +946,7 @@ void SeatInterface::pointerAxis(Qt::Orientation orientation, quint32 delta)
         // ignore
         return;
     }
+    flushPointerEvents();
     if (d->globalPointer.focus.surface) {
         for (auto it = d->globalPointer.focus.pointers.constBegin(), end = d->globalPointer.focus.pointers.constEnd(); it != end; ++it) {
             (*it)->axis(orientation, delta);
@@ -886,6 +966,8 @@ void SeatInterface::pointerButtonPressed(Qt::MouseButton button)
 void SeatInterface::pointerButtonPressed(quint32 button)
 {
     Q_D();
+    // pending events have happened before the button event
+    flushPointerEvents();
     const quint32 serial = d->display->nextSerial();
     d->updatePointerButtonSerial(button, serial);
     d->updatePointerButtonState(button, Private::Pointer::State::Pressed);
@@ -921,6 +1003,8 @@ void SeatInterface::pointerButtonReleased(Qt::MouseButton button)
 void SeatInterface::pointerButtonReleased(quint32 button)
 {
     Q_D();
+    // pending events have happened before the button event
+    flushPointerEvents();
     const quint32 serial = d->display->nextSerial();
     const quint32 currentButtonSerial = pointerButtonSerial(button);
     d->updatePointerButtonSerial(button, serial);
@@ -958,6 +1042,24 @@ quint32 SeatInterface::pointerButtonSerial(quint32 button) const
 void SeatInterface::relativePointerMotion(const QSizeF &delta, const QSizeF &deltaNonAccelerated, quint64 microseconds)
 {
     Q_D();
+    if (d->pointerCoalescing.enabled) {
+        auto &coalescing = d->pointerCoalescing;
+        if (!d->globalPointer.focus.surface) {
+            return;
+        }
+        if (coalescing.relativeMotion) {
+            coalescing.coalescedEvents++;
+            coalescing.relativeDelta += delta;
+            coalescing.relativeDeltaNonAccelerated += deltaNonAccelerated;
+        } else {
+            coalescing.relativeMotion = true;
+            coalescing.relativeDelta = delta;
+            coalescing.relativeDeltaNonAccelerated = deltaNonAccelerated;
+        }
+        coalescing.relativeMicroseconds = microseconds;
+        d->schedulePointerFlush();
+        return;
+    }
     if (d->globalPointer.focus.surface) {
         for (auto it = d->globalPointer.focus.pointers.constBegin(), end = d->globalPointer.focus.pointers.constEnd(); it != end; ++it) {
             (*it)->relativeMotion(delta, deltaNonAccelerated, microseconds);
@@ -965,6 +1067,106 @@ void SeatInterface::relativePointerMotion(const QSizeF &delta, const QSizeF &del
     }
 }
 
+void SeatInterface::Private::schedulePointerFlush()
+{
+    if (pointerCoalescing.interval <= 0 || pointerCoalescing.timer->isActive()) {
+        return;
+    }
+    pointerCoalescing.timer->start(pointerCoalescing.interval);
+}
+
+void SeatInterface::setPointerCoalescingEnabled(bool enabled)
+{
+    Q_D();
+    if (d->pointerCoalescing.enabled == enabled) {
+        return;
+    }
+    if (!enabled) {
+        flushPointerEvents();
+    }
+    d->pointerCoalescing.enabled = enabled;
+}
+
+bool SeatInterface::isPointerCoalescingEnabled() const
+{
+    Q_D();
+    return d->pointerCoalescing.enabled;
+}
+
+void SeatInterface::setPointerCoalescingInterval(int interval)
+{
+    Q_D();
+    auto &coalescing = d->pointerCoalescing;
+    coalescing.interval = qMax(0, interval);
+    if (coalescing.interval > 0 && !coalescing.timer) {
+        coalescing.timer = new QTimer(this);
+        coalescing.timer->setSingleShot(true);
+        connect(coalescing.timer, &QTimer::timeout, this, &SeatInterface::flushPointerEvents);
+    }
+    if (coalescing.timer && coalescing.timer->isActive()) {
+        coalescing.timer->stop();
+        if (coalescing.interval > 0) {
+            coalescing.timer->start(coalescing.interval);
+        }
+    }
+}
+
+int SeatInterface::pointerCoalescingInterval() const
+{
+    Q_D();
+    return d->pointerCoalescing.interval;
+}
+
+void SeatInterface::flushPointerEvents()
+{
+    Q_D();
+    auto &coalescing = d->pointerCoalescing;
+    if (coalescing.timer) {
+        coalescing.timer->stop();
+    }
+    if (!coalescing.isPending()) {
+        return;
+    }
+    const bool motion = coalescing.motion;
+    const bool relativeMotion = coalescing.relativeMotion;
+    const Private::PointerCoalescing::Axis horizontal = coalescing.axes[Private::PointerCoalescing::axisIndex(Qt::Horizontal)];
+    const Private::PointerCoalescing::Axis vertical = coalescing.axes[Private::PointerCoalescing::axisIndex(Qt::Vertical)];
+    coalescing.motion = false;
+    coalescing.relativeMotion = false;
+    coalescing.axes[0] = Private::PointerCoalescing::Axis();
+    coalescing.axes[1] = Private::PointerCoalescing::Axis();
+    if (!d->globalPointer.focus.surface) {
+        return;
+    }
+    for (auto it = d->globalPointer.focus.pointers.constBegin(), end = d->globalPointer.focus.pointers.constEnd(); it != end; ++it) {
+        auto pointer = (*it)->d_func();
+        if (motion) {
+            pointer->updatePosition(false);
+        }
+        if (relativeMotion) {
+            pointer->sendRelativeMotion(coalescing.relativeDelta, coalescing.relativeDeltaNonAccelerated, coalescing.relativeMicroseconds);
+        }
+        // both axes have the same source, only announce it once
+        PointerAxisSource source = PointerAxisSource::Unknown;
+        if (horizontal.pending) {
+            pointer->sendAxis(Qt::Horizontal, horizontal.delta, horizontal.discreteDelta, horizontal.source);
+            source = horizontal.source;
+        }
+        if (vertical.pending) {
+            pointer->sendAxis(Qt::Vertical, vertical.delta, vertical.discreteDelta,
+                              source == vertical.source ? PointerAxisSource::Unknown : vertical.source);
+        }
+        pointer->sendFrame();
+        pointer->client->scheduleFlush();
+    }
+}
+
+quint64 SeatInterface::coalescedPointerEvents() const
+{
+    Q_D();
+    return d->pointerCoalescing.coalescedEvents;
+}
+
 void SeatInterface::startPointerSwipeGesture(quint32 fingerCount)
 {
     Q_D();
@@ -976,7 +1178,7 @@ void SeatInterface::startPointerSwipeGesture(quint32 fingerCount)
         return;
     }
     const quint32 serial = d->display->nextSerial();
-    forEachInterface<PointerInterface>(d->globalPointer.gestureSurface.data(), d->pointers,
+    forEachInterface<PointerInterface>(d->pointersForSurface(d->globalPointer.gestureSurface.data()),
         [serial, fingerCount] (PointerInterface *p) {
             p->d_func()->startSwipeGesture(serial, fingerCount);
         }
@@ -989,7 +1191,7 @@ void SeatInterface::updatePointerSwipeGesture(const QSizeF &delta)
     if (d->globalPointer.gestureSurface.isNull()) {
         return;
     }
-    forEachInterface<PointerInterface>(d->globalPointer.gestureSurface.data(), d->pointers,
+    forEachInterface<PointerInterface>(d->pointersForSurface(d->globalPointer.gestureSurface.data()),
         [delta] (PointerInterface *p) {
             p->d_func()->updateSwipeGesture(delta);
         }
@@ -1003,7 +1205,7 @@ void SeatInterface::endPointerSwipeGesture()
         return;
     }
     const quint32 serial = d->display->nextSerial();
-    forEachInterface<PointerInterface>(d->globalPointer.gestureSurface.data(), d->pointers,
+    forEachInterface<PointerInterface>(d->pointersForSurface(d->globalPointer.gestureSurface.data()),
         [serial] (PointerInterface *p) {
             p->d_func()->endSwipeGesture(serial);
         }
@@ -1018,7 +1220,7 @@ void SeatInterface::cancelPointerSwipeGesture()
         return;
     }
     const quint32 serial = d->display->nextSerial();
-    forEachInterface<PointerInterface>(d->globalPointer.gestureSurface.data(), d->pointers,
+    forEachInterface<PointerInterface>(d->pointersForSurface(d->globalPointer.gestureSurface.data()),
         [serial] (PointerInterface *p) {
             p->d_func()->cancelSwipeGesture(serial);
         }
@@ -1037,7 +1239,7 @@ void SeatInterface::startPointerPinchGesture(quint32 fingerCount)
         return;
     }
     const quint32 serial = d->display->nextSerial();
-    forEachInterface<PointerInterface>(d->globalPointer.gestureSurface.data(), d->pointers,
+    forEachInterface<PointerInterface>(d->pointersForSurface(d->globalPointer.gestureSurface.data()),
         [serial, fingerCount] (PointerInterface *p) {
             p->d_func()->startPinchGesture(serial, fingerCount);
         }
@@ -1050,7 +1252,7 @@ void SeatInterface::updatePointerPinchGesture(const QSizeF &delta, qreal scale,
     if (d->globalPointer.gestureSurface.isNull()) {
         return;
     }
-    forEachInterface<PointerInterface>(d->globalPointer.gestureSurface.data(), d->pointers,
+    forEachInterface<PointerInterface>(d->pointersForSurface(d->globalPointer.gestureSurface.data()),
         [delta, scale, rotation] (PointerInterface *p) {
             p->d_func()->updatePinchGesture(delta, scale, rotation);
         }
@@ -1064,7 +1266,7 @@ void SeatInterface::endPointerPinchGesture()
         return;
     }
     const quint32 serial = d->display->nextSerial();
-    forEachInterface<PointerInterface>(d->globalPointer.gestureSurface.data(), d->pointers,
+    forEachInterface<PointerInterface>(d->pointersForSurface(d->globalPointer.gestureSurface.data()),
         [serial] (PointerInterface *p) {
             p->d_func()->endPinchGesture(serial);
         }
@@ -1079,7 +1281,7 @@ void SeatInterface::cancelPointerPinchGesture()
         return;
     }
     const quint32 serial = d->display->nextSerial();
-    forEachInterface<PointerInterface>(d->globalPointer.gestureSurface.data(), d->pointers,
+    forEachInterface<PointerInterface>(d->pointersForSurface(d->globalPointer.gestureSurface.data()),
         [serial] (PointerInterface *p) {
             p->d_func()->cancelPinchGesture(serial);
         }
@@ -1270,13 +1472,7 @@ quint32 SeatInterface::lastModifiersSerial() const
 QVector< quint32 > SeatInterface::pressedKeys() const
 {
     Q_D();
-    QVector<quint32> keys;
-    for (auto it = d->keys.states.constBegin(); it != d->keys.states.constEnd(); ++it) {
-        if (it.value() == Private::Keyboard::State::Pressed) {
-            keys << it.key();
-        }
-    }
-    return keys;
+    return d->keys.pressed;
 }
 
 KeyboardInterface *SeatInterface::focusedKeyboard() const
@@ -1389,7 +1585,7 @@ qint32 SeatInterface::touchDown(const QPointF &globalPosition)
     if (id == 0 && d->globalTouch.focus.touchs.isEmpty()) {
         // If the client did not bind the touch interface fall back
         // to at least emulating touch through pointer events.
-        forEachInterface<PointerInterface>(focusedTouchSurface(), d->pointers,
+        forEachInterface<PointerInterface>(d->pointersForSurface(focusedTouchSurface()),
             [this, pos, serial] (PointerInterface *p) {
                 wl_pointer_send_enter(p->resource(), serial,
                                 focusedTouchSurface()->resource(),
@@ -1423,7 +1619,7 @@ void SeatInterface::touchMove(qint32 id, const QPointF &globalPosition)
 
     if (id == 0 && d->globalTouch.focus.touchs.isEmpty()) {
         // Client did not bind touch, fall back to emulating with pointer events.
-        forEachInterface<PointerInterface>(focusedTouchSurface(), d->pointers,
+        forEachInterface<PointerInterface>(d->pointersForSurface(focusedTouchSurface()),
             [this, pos] (PointerInterface *p) {
                 wl_pointer_send_motion(p->resource(), timestamp(),
                                        wl_fixed_from_double(pos.x()), wl_fixed_from_double(pos.y()));
@@ -1451,7 +1647,7 @@ void SeatInterface::touchUp(qint32 id)
     if (id == 0 && d->globalTouch.focus.touchs.isEmpty()) {
         // Client did not bind touch, fall back to emulating with pointer events.
         const quint32 serial = display()->nextSerial();
-        forEachInterface<PointerInterface>(focusedTouchSurface(), d->pointers,
+        forEachInterface<PointerInterface>(d->pointersForSurface(focusedTouchSurface()),
             [this, serial] (PointerInterface *p) {
                 wl_pointer_send_button(p->resource(), serial, timestamp(), BTN_LEFT, WL_POINTER_BUTTON_STATE_RELEASED);
             }
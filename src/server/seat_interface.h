@@ -446,6 +446,61 @@ public:
      **/
     void relativePointerMotion(const QSizeF &delta, const QSizeF &deltaNonAccelerated, quint64 microseconds);
 
+    /**
+     * Enables coalescing of the pointer events for the focused pointer surface.
+     *
+     * While enabled setPointerPos, pointerAxisV5 and relativePointerMotion do not send
+     * the events to the client right away. Motion events are merged into the latest
+     * pointer position, axis and relative motion deltas are summed up. The accumulated
+     * events are sent in one wl_pointer.frame group by flushPointerEvents. This reduces
+     * the traffic to clients for high rate input devices.
+     *
+     * Button events, axis stop events and changes of the focused pointer surface flush
+     * the pending events first, so the order of the events is kept.
+     *
+     * Disabling the coalescing flushes the pending events. Default is disabled.
+     *
+     * @see setPointerCoalescingInterval
+     * @see flushPointerEvents
+     * @see coalescedPointerEvents
+     * @since 5.67
+     **/
+    void setPointerCoalescingEnabled(bool enabled);
+    /**
+     * @returns whether pointer events get coalesced
+     * @see setPointerCoalescingEnabled
+     * @since 5.67
+     **/
+    bool isPointerCoalescingEnabled() const;
+    /**
+     * Sets the @p interval in msec after which coalesced pointer events get flushed.
+     *
+     * With an interval of @c 0 the events are only flushed by flushPointerEvents, which
+     * the compositor should call when it starts a new frame. Default is @c 0.
+     *
+     * @see setPointerCoalescingEnabled
+     * @since 5.67
+     **/
+    void setPointerCoalescingInterval(int interval);
+    /**
+     * @returns the interval in msec after which coalesced pointer events get flushed
+     * @since 5.67
+     **/
+    int pointerCoalescingInterval() const;
+    /**
+     * Sends the pointer events accumulated in coalescing mode to the focused pointer surface.
+     *
+     * @see setPointerCoalescingEnabled
+     * @since 5.67
+     **/
+    void flushPointerEvents();
+    /**
+     * @returns the number of pointer events which got merged into another event in coalescing mode
+     * @see setPointerCoalescingEnabled
+     * @since 5.67
+     **/
+    quint64 coalescedPointerEvents() const;
+
     /**
      * Starts a multi-finger swipe gesture for the currently focused pointer surface.
      *
@@ -585,6 +640,9 @@ public:
     int keymapFileDescriptor() const;
     quint32 keymapSize() const;
     bool isKeymapXkbCompatible() const;
+    /**
+     * @returns the currently pressed keys in the order they got pressed
+     **/
     QVector<quint32> pressedKeys() const;
     /**
      * @returns The key repeat in character per second
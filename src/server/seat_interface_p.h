@@ -29,12 +29,17 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include <QVector>
 // Wayland
 #include <wayland-server.h>
+// std
+#include <bitset>
+
+class QTimer;
 
 namespace KWayland
 {
 namespace Server
 {
 
+class ClientConnection;
 class DataDeviceInterface;
 class TextInputInterface;
 
@@ -68,6 +73,28 @@ public:
     QVector<TextInputInterface*> textInputs;
     DataDeviceInterface *currentSelection = nullptr;
 
+    // the devices bound by one client, used to find the devices of a surface without going through all devices
+    struct ClientDevices {
+        QVector<PointerInterface*> pointers;
+        QVector<KeyboardInterface*> keyboards;
+        QVector<TouchInterface*> touchs;
+        QVector<DataDeviceInterface*> dataDevices;
+        QVector<TextInputInterface*> textInputs;
+
+        bool isEmpty() const {
+            return pointers.isEmpty() && keyboards.isEmpty() && touchs.isEmpty() && dataDevices.isEmpty() && textInputs.isEmpty();
+        }
+    };
+    QHash<ClientConnection*, ClientDevices> clientDevices;
+    template <typename T>
+    void addClientDevice(ClientConnection *client, QVector<T*> ClientDevices::*devices, T *device);
+    template <typename T>
+    void removeClientDevice(ClientConnection *client, QVector<T*> ClientDevices::*devices, T *device);
+    template <typename T>
+    T *interfaceForSurface(SurfaceInterface *surface, QVector<T*> ClientDevices::*devices) const;
+    template <typename T>
+    QVector<T*> interfacesForSurface(SurfaceInterface *surface, QVector<T*> ClientDevices::*devices) const;
+
     // Pointer related members
     struct Pointer {
         enum class State {
@@ -92,13 +119,53 @@ public:
     void updatePointerButtonSerial(quint32 button, quint32 serial);
     void updatePointerButtonState(quint32 button, Pointer::State state);
 
+    // pointer events waiting to be sent in coalescing mode
+    struct PointerCoalescing {
+        bool enabled = false;
+        int interval = 0;
+        QTimer *timer = nullptr;
+        bool motion = false;
+        struct Axis {
+            bool pending = false;
+            qreal delta = 0.0;
+            qint32 discreteDelta = 0;
+            PointerAxisSource source = PointerAxisSource::Unknown;
+        };
+        // indexed by axisIndex
+        Axis axes[2];
+        bool relativeMotion = false;
+        QSizeF relativeDelta;
+        QSizeF relativeDeltaNonAccelerated;
+        quint64 relativeMicroseconds = 0;
+        quint64 coalescedEvents = 0;
+
+        bool isPending() const {
+            return motion || relativeMotion || axes[0].pending || axes[1].pending;
+        }
+        static int axisIndex(Qt::Orientation orientation) {
+            return orientation == Qt::Horizontal ? 0 : 1;
+        }
+    };
+    PointerCoalescing pointerCoalescing;
+    void schedulePointerFlush();
+
     // Keyboard related members
     struct Keyboard {
         enum class State {
             Released,
             Pressed
         };
-        QHash<quint32, State> states;
+        Keyboard() {
+            pressed.reserve(16);
+        }
+        // evdev key codes are below KEY_CNT, larger key codes are tracked in overflowStates
+        static const quint32 s_keyCount = 0x300;
+        std::bitset<s_keyCount> pressedBits;
+        // whether the key has been pressed or released before
+        std::bitset<s_keyCount> knownBits;
+        QHash<quint32, State> overflowStates;
+        // the pressed keys in the order they got pressed, shared with pressedKeys()
+        QVector<quint32> pressed;
         struct Keymap {
             int fd = -1;
             quint32 size = 0;
@@ -165,16 +165,10 @@ void SubSurfaceInterface::Private::create(ClientConnection *client, quint32 vers
     // copy current state to subSurfacePending state
     // it's the reference for all new pending state which needs to be committed
     surface->d_func()->subSurfacePending = surface->d_func()->current;
-    surface->d_func()->subSurfacePending.blurIsSet = false;
-    surface->d_func()->subSurfacePending.bufferIsSet = false;
-    surface->d_func()->subSurfacePending.childrenChanged = false;
-    surface->d_func()->subSurfacePending.contrastIsSet = false;
-    surface->d_func()->subSurfacePending.callbacks.clear();
-    surface->d_func()->subSurfacePending.inputIsSet = false;
+    surface->d_func()->subSurfacePending.changes = 0;
+    // the frame callbacks are not copied, the presentation feedback stays with the current state
+    surface->d_func()->subSurfacePending.presentationFeedbacks.clear();
     surface->d_func()->subSurfacePending.inputIsInfinite = true;
-    surface->d_func()->subSurfacePending.opaqueIsSet = false;
-    surface->d_func()->subSurfacePending.shadowIsSet = false;
-    surface->d_func()->subSurfacePending.slideIsSet = false;
     parent->d_func()->addChild(QPointer<SubSurfaceInterface>(q));
 
     QObject::connect(surface.data(), &QObject::destroyed, q,
@@ -194,8 +188,10 @@ void SubSurfaceInterface::Private::commit()
 {
     if (scheduledPosChange) {
         scheduledPosChange = false;
+        const QPoint oldPos = pos;
         pos = scheduledPos;
         scheduledPos = QPoint();
+        addPositionDamage(oldPos);
         Q_Q(SubSurfaceInterface);
         emit q->positionChanged(pos);
     }
@@ -204,6 +200,20 @@ void SubSurfaceInterface::Private::commit()
     }
 }
 
+void SubSurfaceInterface::Private::addPositionDamage(const QPoint &oldPos)
+{
+    if (oldPos == pos || !parent) {
+        return;
+    }
+    parent->d_func()->invalidateInputShapes();
+    if (!surface || !surface->isMapped()) {
+        return;
+    }
+    // the old and the new geometry need to be repainted
+    const QRect rect = surface->d_func()->boundingRect();
+    parent->d_func()->addDamageHistory(QRegion(rect.translated(oldPos)).united(rect.translated(pos)));
+}
+
 void SubSurfaceInterface::Private::setPositionCallback(wl_client *client, wl_resource *resource, int32_t x, int32_t y)
 {
     Q_UNUSED(client)
@@ -217,7 +227,9 @@ void SubSurfaceInterface::Private::setPosition(const QPoint &p)
     if (!q->isSynchronized()) {
         // workaround for https://bugreports.qt.io/browse/QTBUG-52118
         // apply directly as Qt doesn't commit the parent surface
+        const QPoint oldPos = pos;
         pos = p;
+        addPositionDamage(oldPos);
         emit q->positionChanged(pos);
         return;
     }
@@ -24,6 +24,7 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include "resource_p.h"
 // Qt
 #include <QPoint>
+#include <QRect>
 // Wayland
 #include <wayland-server.h>
 
@@ -48,6 +49,9 @@ public:
     Mode mode = Mode::Synchronized;
     QPointer<SurfaceInterface> surface;
     QPointer<SurfaceInterface> parent;
+    // the area covered by the surface and its sub-surfaces relative to pos, kept up to date by
+    // the surface's damage history, so that it is still known once the surface got destroyed
+    QRect boundingRect;
 
 private:
     SubSurfaceInterface *q_func() {
@@ -55,6 +59,7 @@ private:
     }
     void setMode(Mode mode);
     void setPosition(const QPoint &pos);
+    void addPositionDamage(const QPoint &oldPos);
     void placeAbove(SurfaceInterface *sibling);
     void placeBelow(SurfaceInterface *sibling);
 
@@ -30,8 +30,11 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include "surfacerole_p.h"
 // Qt
 #include <QListIterator>
+#include <QMetaMethod>
+#include <QTimer>
 // Wayland
 #include <wayland-server.h>
+#include <wayland-presentation-time-server-protocol.h>
 // std
 #include <algorithm>
 
@@ -40,8 +43,98 @@ namespace KWayland
 namespace Server
 {
 
+namespace
+{
+typedef OutputInterface::Transform Transform;
+
+bool isTransposed(Transform transform)
+{
+    return transform == Transform::Rotated90 || transform == Transform::Rotated270 ||
+           transform == Transform::Flipped90 || transform == Transform::Flipped270;
+}
+
+// the size of the surface a buffer of bufferSize results in
+QSize surfaceSizeForBuffer(const QSize &bufferSize, qint32 scale, Transform transform)
+{
+    QSize size = bufferSize / scale;
+    if (isTransposed(transform)) {
+        size.transpose();
+    }
+    return size;
+}
+
+// maps point from surface-local coordinates of a surface with the given size into the
+// buffer coordinates before the buffer scale is applied
+QPoint surfaceToBuffer(Transform transform, const QSize &size, const QPoint &point)
+{
+    const int x = point.x();
+    const int y = point.y();
+    const int w = size.width();
+    const int h = size.height();
+    switch (transform) {
+    case Transform::Rotated90:
+        return QPoint(h - y, x);
+    case Transform::Rotated180:
+        return QPoint(w - x, h - y);
+    case Transform::Rotated270:
+        return QPoint(y, w - x);
+    case Transform::Flipped:
+        return QPoint(w - x, y);
+    case Transform::Flipped90:
+        return QPoint(h - y, w - x);
+    case Transform::Flipped180:
+        return QPoint(x, h - y);
+    case Transform::Flipped270:
+        return QPoint(y, x);
+    case Transform::Normal:
+    default:
+        return point;
+    }
+}
+
+// the exact inverse of surfaceToBuffer
+QPoint bufferToSurface(Transform transform, const QSize &size, const QPoint &point)
+{
+    const int x = point.x();
+    const int y = point.y();
+    const int w = size.width();
+    const int h = size.height();
+    switch (transform) {
+    case Transform::Rotated90:
+        return QPoint(y, h - x);
+    case Transform::Rotated180:
+        return QPoint(w - x, h - y);
+    case Transform::Rotated270:
+        return QPoint(w - y, x);
+    case Transform::Flipped:
+        return QPoint(w - x, y);
+    case Transform::Flipped90:
+        return QPoint(w - y, h - x);
+    case Transform::Flipped180:
+        return QPoint(x, h - y);
+    case Transform::Flipped270:
+        return QPoint(y, x);
+    case Transform::Normal:
+    default:
+        return point;
+    }
+}
+
+int divideFloor(int value, int divisor)
+{
+    return value / divisor - (value % divisor < 0 ? 1 : 0);
+}
+
+int divideCeil(int value, int divisor)
+{
+    return value / divisor + (value % divisor > 0 ? 1 : 0);
+}
+
+}
+
 SurfaceInterface::Private::Private(SurfaceInterface *q, CompositorInterface *c, wl_resource *parentResource)
     : Resource::Private(q, c, parentResource, &wl_surface_interface, &s_interface)
+    , compositor(c)
 {
 }
 
@@ -56,6 +149,7 @@ void SurfaceInterface::Private::addChild(QPointer< SubSurfaceInterface > child)
     pending.children.append(child);
     subSurfacePending.children.append(child);
     current.children.append(child);
+    invalidateInputShapes();
     Q_Q(SurfaceInterface);
     emit q->subSurfaceTreeChanged();
     QObject::connect(child.data(), &SubSurfaceInterface::positionChanged, q, &SurfaceInterface::subSurfaceTreeChanged);
@@ -70,9 +164,15 @@ void SurfaceInterface::Private::removeChild(QPointer< SubSurfaceInterface > chil
     pending.children.removeAll(child);
     subSurfacePending.children.removeAll(child);
     current.children.removeAll(child);
+    invalidateInputShapes();
     Q_Q(SurfaceInterface);
     emit q->subSurfaceTreeChanged();
     QObject::disconnect(child.data(), &SubSurfaceInterface::positionChanged, q, &SurfaceInterface::subSurfaceTreeChanged);
+    // the surface is already gone if the sub-surface got removed because of its destruction
+    QRect &childRect = child->d_func()->boundingRect;
+    addDamageHistory(childRect.translated(child->position()));
+    // removeChild gets called again once the inert wl_subsurface is destroyed
+    childRect = QRect();
     if (!child->surface().isNull()) {
         QObject::disconnect(child->surface().data(), &SurfaceInterface::damaged, q, &SurfaceInterface::subSurfaceTreeChanged);
         QObject::disconnect(child->surface().data(), &SurfaceInterface::unmapped, q, &SurfaceInterface::subSurfaceTreeChanged);
@@ -95,7 +195,7 @@ bool SurfaceInterface::Private::raiseChild(QPointer<SubSurfaceInterface> subsurf
         // it's to the parent, so needs to become last item
         pending.children.append(*it);
         pending.children.erase(it);
-        pending.childrenChanged = true;
+        pending.changes |= State::ChildrenChange;
         return true;
     }
     if (!sibling->subSurface()) {
@@ -112,7 +212,7 @@ bool SurfaceInterface::Private::raiseChild(QPointer<SubSurfaceInterface> subsurf
     // find the iterator again
     siblingIt = std::find(pending.children.begin(), pending.children.end(), sibling->subSurface());
     pending.children.insert(++siblingIt, value);
-    pending.childrenChanged = true;
+    pending.changes |= State::ChildrenChange;
     return true;
 }
 
@@ -132,7 +232,7 @@ bool SurfaceInterface::Private::lowerChild(QPointer<SubSurfaceInterface> subsurf
         auto value = *it;
         pending.children.erase(it);
         pending.children.prepend(value);
-        pending.childrenChanged = true;
+        pending.changes |= State::ChildrenChange;
         return true;
     }
     if (!sibling->subSurface()) {
@@ -149,32 +249,32 @@ bool SurfaceInterface::Private::lowerChild(QPointer<SubSurfaceInterface> subsurf
     // find the iterator again
     siblingIt = std::find(pending.children.begin(), pending.children.end(), sibling->subSurface());
     pending.children.insert(siblingIt, value);
-    pending.childrenChanged = true;
+    pending.changes |= State::ChildrenChange;
     return true;
 }
 
 void SurfaceInterface::Private::setShadow(const QPointer<ShadowInterface> &shadow)
 {
     pending.shadow = shadow;
-    pending.shadowIsSet = true;
+    pending.changes |= State::ShadowChange;
 }
 
 void SurfaceInterface::Private::setBlur(const QPointer<BlurInterface> &blur)
 {
     pending.blur = blur;
-    pending.blurIsSet = true;
+    pending.changes |= State::BlurChange;
 }
 
 void SurfaceInterface::Private::setSlide(const QPointer<SlideInterface> &slide)
 {
     pending.slide = slide;
-    pending.slideIsSet = true;
+    pending.changes |= State::SlideChange;
 }
 
 void SurfaceInterface::Private::setContrast(const QPointer<ContrastInterface> &contrast)
 {
     pending.contrast = contrast;
-    pending.contrastIsSet = true;
+    pending.changes |= State::ContrastChange;
 }
 
 void SurfaceInterface::Private::installPointerConstraint(LockedPointerInterface *lock)
@@ -283,6 +383,13 @@ const struct wl_surface_interface SurfaceInterface::Private::s_interface = {
 SurfaceInterface::SurfaceInterface(CompositorInterface *parent, wl_resource *parentResource)
     : Resource(new Private(this, parent, parentResource))
 {
+    // also covers buffers changing their size without being attached again
+    connect(this, &SurfaceInterface::sizeChanged, this,
+        [this] {
+            Q_D();
+            d->invalidateInputShapes();
+        }
+    );
 }
 
 SurfaceInterface::~SurfaceInterface() = default;
@@ -290,40 +397,251 @@ SurfaceInterface::~SurfaceInterface() = default;
 void SurfaceInterface::frameRendered(quint32 msec)
 {
     Q_D();
-    // notify all callbacks
-    const bool needsFlush = !d->current.callbacks.isEmpty();
-    while (!d->current.callbacks.isEmpty()) {
-        wl_resource *r = d->current.callbacks.takeFirst();
+    if (!d->current.callbacks.isEmpty()) {
+        d->frameCallbacksDue = true;
+        d->throttleFrameCallbacks(msec);
+    }
+    for (auto it = d->current.children.constBegin(); it != d->current.children.constEnd(); ++it) {
+        const auto &subSurface = *it;
+        if (subSurface.isNull() || subSurface->d_func()->surface.isNull()) {
+            continue;
+        }
+        subSurface->d_func()->surface->frameRendered(msec);
+    }
+}
+
+const SurfaceInterface::Private *SurfaceInterface::Private::frameThrottlingSource() const
+{
+    if (subSurface.isNull()) {
+        return this;
+    }
+    const auto parent = subSurface->parentSurface();
+    if (parent.isNull()) {
+        return this;
+    }
+    const Private *parentSource = parent->d_func()->frameThrottlingSource();
+    return parentSource->frameThrottling > frameThrottling ? parentSource : this;
+}
+
+void SurfaceInterface::Private::throttleFrameCallbacks(quint32 msec)
+{
+    if (!frameCallbacksDue) {
+        return;
+    }
+    if (current.callbacks.isEmpty()) {
+        // all callbacks got destroyed by the client meanwhile
+        frameCallbacksDue = false;
+        if (frameThrottlingTimer) {
+            frameThrottlingTimer->stop();
+        }
+        return;
+    }
+    const Private *source = frameThrottlingSource();
+    int remaining = 0;
+    switch (source->frameThrottling) {
+    case FrameThrottling::None:
+        sendFrameCallbacks(msec);
+        return;
+    case FrameThrottling::LowRate:
+        if (!sinceFrameCallbacks.isValid() || sinceFrameCallbacks.elapsed() >= source->frameThrottlingInterval) {
+            sendFrameCallbacks(msec);
+            return;
+        }
+        remaining = source->frameThrottlingInterval - int(sinceFrameCallbacks.elapsed());
+        break;
+    case FrameThrottling::Suspended:
+        if (source->frameSuspendTimeout <= 0 || (frameThrottlingTimer && frameThrottlingTimer->isActive())) {
+            break;
+        }
+        remaining = source->frameSuspendTimeout;
+        break;
+    }
+    // the held callbacks get the timestamp of this frame advanced by the time they are held
+    lastFrameTime = msec;
+    sinceLastFrame.start();
+    if (remaining <= 0) {
+        return;
+    }
+    if (!frameThrottlingTimer) {
+        Q_Q(SurfaceInterface);
+        frameThrottlingTimer = new QTimer(q);
+        frameThrottlingTimer->setSingleShot(true);
+        QObject::connect(frameThrottlingTimer, &QTimer::timeout, q,
+            [this] {
+                sendFrameCallbacks(frameTime());
+            }
+        );
+    }
+    frameThrottlingTimer->start(remaining);
+}
+
+void SurfaceInterface::Private::sendFrameCallbacks(quint32 msec)
+{
+    frameCallbacksDue = false;
+    if (frameThrottlingTimer) {
+        frameThrottlingTimer->stop();
+    }
+    if (current.callbacks.isEmpty()) {
+        return;
+    }
+    sinceFrameCallbacks.start();
+    while (!current.callbacks.isEmpty()) {
+        wl_resource *r = current.callbacks.takeFirst();
         wl_callback_send_done(r, msec);
         wl_resource_destroy(r);
     }
+    Q_Q(SurfaceInterface);
+    q->client()->scheduleFlush();
+}
+
+void SurfaceInterface::Private::frameThrottlingChanged()
+{
+    if (frameThrottlingTimer) {
+        frameThrottlingTimer->stop();
+    }
+    throttleFrameCallbacks(frameTime());
+    for (auto it = current.children.constBegin(); it != current.children.constEnd(); ++it) {
+        const auto &child = *it;
+        if (child.isNull() || child->d_func()->surface.isNull()) {
+            continue;
+        }
+        child->d_func()->surface->d_func()->frameThrottlingChanged();
+    }
+}
+
+quint32 SurfaceInterface::Private::frameTime() const
+{
+    if (!sinceLastFrame.isValid()) {
+        return lastFrameTime;
+    }
+    return lastFrameTime + quint32(sinceLastFrame.elapsed());
+}
+
+void SurfaceInterface::setFrameThrottling(FrameThrottling policy)
+{
+    Q_D();
+    if (d->frameThrottling == policy) {
+        return;
+    }
+    d->frameThrottling = policy;
+    d->frameThrottlingChanged();
+}
+
+SurfaceInterface::FrameThrottling SurfaceInterface::frameThrottling() const
+{
+    Q_D();
+    return d->frameThrottling;
+}
+
+void SurfaceInterface::setFrameThrottlingInterval(int interval)
+{
+    Q_D();
+    if (d->frameThrottlingInterval == interval) {
+        return;
+    }
+    d->frameThrottlingInterval = interval;
+    d->frameThrottlingChanged();
+}
+
+int SurfaceInterface::frameThrottlingInterval() const
+{
+    Q_D();
+    return d->frameThrottlingInterval;
+}
+
+void SurfaceInterface::setFrameSuspendTimeout(int timeout)
+{
+    Q_D();
+    if (d->frameSuspendTimeout == timeout) {
+        return;
+    }
+    d->frameSuspendTimeout = timeout;
+    d->frameThrottlingChanged();
+}
+
+int SurfaceInterface::frameSuspendTimeout() const
+{
+    Q_D();
+    return d->frameSuspendTimeout;
+}
+
+void SurfaceInterface::presented(OutputInterface *output, std::chrono::nanoseconds timestamp, std::chrono::nanoseconds refresh,
+                                 quint64 sequence, PresentationInterface::Kinds kinds)
+{
+    Q_D();
+    const bool needsFlush = !d->current.presentationFeedbacks.isEmpty();
+    if (needsFlush) {
+        // the wl_resource_destroy goes into destroyPresentationFeedback
+        QList<wl_resource*> feedbacks;
+        feedbacks.swap(d->current.presentationFeedbacks);
+        const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timestamp);
+        const quint64 tvSec = seconds.count();
+        const quint32 tvNsec = (timestamp - seconds).count();
+        const QVector<wl_resource*> outputs = output ? output->clientResources(client()) : QVector<wl_resource*>();
+        for (wl_resource *r : qAsConst(feedbacks)) {
+            for (wl_resource *o : outputs) {
+                wp_presentation_feedback_send_sync_output(r, o);
+            }
+            wp_presentation_feedback_send_presented(r, tvSec >> 32, tvSec & 0xffffffff, tvNsec, uint32_t(refresh.count()),
+                                                    sequence >> 32, sequence & 0xffffffff, uint32_t(kinds));
+            wl_resource_destroy(r);
+        }
+    }
     for (auto it = d->current.children.constBegin(); it != d->current.children.constEnd(); ++it) {
         const auto &subSurface = *it;
         if (subSurface.isNull() || subSurface->d_func()->surface.isNull()) {
             continue;
         }
-        subSurface->d_func()->surface->frameRendered(msec);
+        subSurface->d_func()->surface->presented(output, timestamp, refresh, sequence, kinds);
+    }
+    if (needsFlush) {
+        client()->scheduleFlush();
+    }
+}
+
+void SurfaceInterface::presentationDiscarded()
+{
+    Q_D();
+    const bool needsFlush = !d->current.presentationFeedbacks.isEmpty();
+    d->discardPresentationFeedback(&d->current);
+    for (auto it = d->current.children.constBegin(); it != d->current.children.constEnd(); ++it) {
+        const auto &subSurface = *it;
+        if (subSurface.isNull() || subSurface->d_func()->surface.isNull()) {
+            continue;
+        }
+        subSurface->d_func()->surface->presentationDiscarded();
     }
-    if (needsFlush)  {
-        client()->flush();
+    if (needsFlush) {
+        client()->scheduleFlush();
+    }
+}
+
+void SurfaceInterface::Private::discardPresentationFeedback(State *state)
+{
+    if (state->presentationFeedbacks.isEmpty()) {
+        return;
+    }
+    // the wl_resource_destroy goes into destroyPresentationFeedback
+    QList<wl_resource*> feedbacks;
+    feedbacks.swap(state->presentationFeedbacks);
+    for (wl_resource *r : qAsConst(feedbacks)) {
+        wp_presentation_feedback_send_discarded(r);
+        wl_resource_destroy(r);
     }
 }
 
 void SurfaceInterface::Private::destroy()
 {
-    // copy all existing callbacks to new list and clear existing lists
-    // the wl_resource_destroy on the callback resource goes into destroyFrameCallback
-    // which would modify the list we are iterating on
-    QList<wl_resource *> callbacksToDestroy;
-    callbacksToDestroy << current.callbacks;
-    current.callbacks.clear();
-    callbacksToDestroy << pending.callbacks;
-    pending.callbacks.clear();
-    callbacksToDestroy << subSurfacePending.callbacks;
-    subSurfacePending.callbacks.clear();
-    for (auto it = callbacksToDestroy.constBegin(), end = callbacksToDestroy.constEnd(); it != end; it++) {
-        wl_resource_destroy(*it);
+    // the wl_resource_destroy on the callback resource goes into destroyFrameCallback,
+    // which is fine as the callback is already taken out of the list
+    for (State *state : {&current, &pending, &subSurfacePending}) {
+        while (!state->callbacks.isEmpty()) {
+            wl_resource_destroy(state->callbacks.takeFirst());
+        }
     }
+    discardPresentationFeedback(&current);
+    discardPresentationFeedback(&pending);
+    discardPresentationFeedback(&subSurfacePending);
     if (current.buffer) {
         current.buffer->unref();
     }
@@ -332,36 +650,38 @@ void SurfaceInterface::Private::destroy()
 void SurfaceInterface::Private::swapStates(State *source, State *target, bool emitChanged)
 {
     Q_Q(SurfaceInterface);
-    bool bufferChanged = source->bufferIsSet;
-    const bool opaqueRegionChanged = source->opaqueIsSet;
-    const bool inputRegionChanged = source->inputIsSet;
-    const bool scaleFactorChanged = source->scaleIsSet && (target->scale != source->scale);
-    const bool transformChanged = source->transformIsSet && (target->transform != source->transform);
-    const bool shadowChanged = source->shadowIsSet;
-    const bool blurChanged = source->blurIsSet;
-    const bool contrastChanged = source->contrastIsSet;
-    const bool slideChanged = source->slideIsSet;
-    const bool childrenChanged = source->childrenChanged;
+    const quint32 changes = source->changes;
+    bool bufferChanged = changes & State::BufferChange;
+    const bool opaqueRegionChanged = changes & State::OpaqueChange;
+    const bool inputRegionChanged = changes & State::InputChange;
+    const bool scaleFactorChanged = (changes & State::ScaleChange) && (target->scale != source->scale);
+    const bool transformChanged = (changes & State::TransformChange) && (target->transform != source->transform);
+    const bool shadowChanged = changes & State::ShadowChange;
+    const bool blurChanged = changes & State::BlurChange;
+    const bool contrastChanged = changes & State::ContrastChange;
+    const bool slideChanged = changes & State::SlideChange;
+    const bool childrenChanged = changes & State::ChildrenChange;
     bool sizeChanged = false;
+    const QSize oldSurfaceSize = q->size();
+    const bool wasMapped = emitChanged && q->isMapped();
     auto buffer = target->buffer;
     if (bufferChanged) {
         // TODO: is the reffing correct for subsurfaces?
         QSize oldSize;
         if (target->buffer) {
             oldSize = target->buffer->size();
-            if (emitChanged) {
+        }
+        if (emitChanged) {
+            // reference before unreferencing, attaching the same wl_buffer again keeps it
+            // referenced, but marks it as used again if it got released early
+            if (source->buffer) {
+                source->buffer->refAttached();
+            }
+            if (target->buffer) {
                 target->buffer->unref();
-                QObject::disconnect(target->buffer, &BufferInterface::sizeChanged, q, &SurfaceInterface::sizeChanged);
-            } else {
-                delete target->buffer;
-                target->buffer = nullptr;
             }
         }
         if (source->buffer) {
-            if (emitChanged) {
-                source->buffer->ref();
-                QObject::connect(source->buffer, &BufferInterface::sizeChanged, q, &SurfaceInterface::sizeChanged);
-            }
             const QSize newSize = source->buffer->size();
             sizeChanged = newSize.isValid() && newSize != oldSize;
         }
@@ -371,52 +691,60 @@ void SurfaceInterface::Private::swapStates(State *source, State *target, bool em
         }
         buffer = source->buffer;
     }
-    // copy values
+    // move the changed values, only the fields marked as changed need to be reset in the source
+    // swapping keeps the allocated capacity of the damage rectangles for the next commit
     if (bufferChanged) {
         target->buffer = buffer;
-        target->damage = source->damage;
-        target->bufferDamage = source->bufferDamage;
-        target->bufferIsSet = source->bufferIsSet;
+        std::swap(target->damageRects, source->damageRects);
+        std::swap(target->bufferDamageRects, source->bufferDamageRects);
     }
+    source->damageRects.clear();
+    source->bufferDamageRects.clear();
+    source->buffer = nullptr;
+    source->offset = QPoint();
     if (childrenChanged) {
-        target->childrenChanged = source->childrenChanged;
+        // the source keeps the children as reference for further changes
         target->children = source->children;
     }
-    target->callbacks.append(source->callbacks);
-
+    if (changes != 0 || !source->presentationFeedbacks.isEmpty()) {
+        // the content the feedback got requested for is replaced before being presented
+        discardPresentationFeedback(target);
+        std::swap(target->presentationFeedbacks, source->presentationFeedbacks);
+    }
+    target->callbacks.splice(source->callbacks);
     if (shadowChanged) {
-        target->shadow = source->shadow;
-        target->shadowIsSet = true;
+        target->shadow = std::move(source->shadow);
     }
     if (blurChanged) {
-        target->blur = source->blur;
-        target->blurIsSet = true;
+        target->blur = std::move(source->blur);
     }
     if (contrastChanged) {
-        target->contrast = source->contrast;
-        target->contrastIsSet = true;
+        target->contrast = std::move(source->contrast);
     }
     if (slideChanged) {
-        target->slide = source->slide;
-        target->slideIsSet = true;
+        target->slide = std::move(source->slide);
     }
     if (inputRegionChanged) {
-        target->input = source->input;
+        target->input = std::move(source->input);
         target->inputIsInfinite = source->inputIsInfinite;
-        target->inputIsSet = true;
+        source->input = QRegion();
+        source->inputIsInfinite = true;
     }
     if (opaqueRegionChanged) {
-        target->opaque = source->opaque;
-        target->opaqueIsSet = true;
+        target->opaque = std::move(source->opaque);
+        source->opaque = QRegion();
     }
     if (scaleFactorChanged) {
         target->scale = source->scale;
-        target->scaleIsSet = true;
     }
     if (transformChanged) {
         target->transform = source->transform;
-        target->transformIsSet = true;
     }
+    source->scale = 1;
+    source->transform = OutputInterface::Transform::Normal;
+    // the target gets applied to current by a later swap, e.g. the cached state of a sub-surface
+    target->changes |= bufferChanged ? changes : (changes & ~quint32(State::BufferChange));
+    source->changes = 0;
     if (!lockedPointer.isNull()) {
         lockedPointer->d_func()->commit();
     }
@@ -424,8 +752,6 @@ void SurfaceInterface::Private::swapStates(State *source, State *target, bool em
         confinedPointer->d_func()->commit();
     }
 
-    *source = State{};
-    source->children = target->children;
     if (opaqueRegionChanged) {
         emit q->opaqueChanged(target->opaque);
     }
@@ -440,38 +766,28 @@ void SurfaceInterface::Private::swapStates(State *source, State *target, bool em
     }
     if (transformChanged) {
         emit q->transformChanged(target->transform);
+        if (buffer && !sizeChanged && !scaleFactorChanged && emitChanged && q->size() != oldSurfaceSize) {
+            emit q->sizeChanged();
+        }
     }
     if (bufferChanged && emitChanged) {
-        if (target->buffer && (!target->damage.isEmpty() || !target->bufferDamage.isEmpty())) {
-            const QRegion windowRegion = QRegion(0, 0, q->size().width(), q->size().height());
-            if (!windowRegion.isEmpty()) {
-                QRegion bufferDamage;
-                if (!target->bufferDamage.isEmpty()) {
-                    typedef OutputInterface::Transform Tr;
-                    const Tr tr = target->transform;
-                    const qint32 sc = target->scale;
-                    if (tr == Tr::Rotated90 || tr == Tr::Rotated270 ||
-                            tr == Tr::Flipped90 || tr == Tr::Flipped270) {
-                        // calculate transformed + scaled buffer damage
-                        for (const auto &rect : target->bufferDamage) {
-                            const auto add = QRegion(rect.x() / sc, rect.y() / sc, rect.height() / sc, rect.width() / sc);
-                            bufferDamage = bufferDamage.united(add);
-                        }
-                    } else if (sc != 1) {
-                        // calculate scaled buffer damage
-                        for (const auto &rect : target->bufferDamage) {
-                            const auto add = QRegion(rect.x() / sc, rect.y() / sc, rect.width() / sc, rect.height() / sc);
-                            bufferDamage = bufferDamage.united(add);
-                        }
-                    } else {
-                        bufferDamage = target->bufferDamage;
-                    }
-                }
-                target->damage = windowRegion.intersected(target->damage.united(bufferDamage));
+        damageRegionValid = false;
+        if (target->buffer && (!target->damageRects.isEmpty() || !target->bufferDamageRects.isEmpty())) {
+            const QRect windowRect = QRect(QPoint(0, 0), q->size());
+            if (!windowRect.isEmpty()) {
+                combineDamage(target, windowRect);
                 if (emitChanged) {
                     subSurfaceIsMapped = true;
-                    trackedDamage = trackedDamage.united(target->damage);
-                    emit q->damaged(target->damage);
+                    trackedDamageRects.add(target->damageRects);
+                    if (trackedDamageRects.count() > s_maxTrackedDamageRects) {
+                        // bounds the memory if the compositor never requests the tracked damage
+                        q->trackedDamage();
+                    }
+                    // building the QRegion allocates, only do it for someone listening
+                    static const QMetaMethod damagedSignal = QMetaMethod::fromSignal(&SurfaceInterface::damaged);
+                    if (q->isSignalConnected(damagedSignal)) {
+                        emit q->damaged(damageRegion());
+                    }
                     // workaround for https://bugreports.qt.io/browse/QTBUG-52092
                     // if the surface is a sub-surface, but the main surface is not yet mapped, fake frame rendered
                     if (subSurface) {
@@ -481,6 +797,9 @@ void SurfaceInterface::Private::swapStates(State *source, State *target, bool em
                         }
                     }
                 }
+            } else {
+                target->damageRects.clear();
+                target->bufferDamageRects.clear();
             }
         } else if (!target->buffer && emitChanged) {
             subSurfaceIsMapped = false;
@@ -490,6 +809,18 @@ void SurfaceInterface::Private::swapStates(State *source, State *target, bool em
     if (!emitChanged) {
         return;
     }
+    if (inputRegionChanged || childrenChanged || q->isMapped() != wasMapped) {
+        invalidateInputShapes();
+    }
+    if (bufferChanged || scaleFactorChanged || transformChanged) {
+        const QSize surfaceSize = q->size();
+        if (surfaceSize != oldSurfaceSize) {
+            // covers unmapping and the area uncovered by shrinking
+            addDamageHistory(damageRegion() + QRect(QPoint(0, 0), oldSurfaceSize) + QRect(QPoint(0, 0), surfaceSize));
+        } else {
+            addDamageHistory(target->damageRects);
+        }
+    }
     if (sizeChanged) {
         emit q->sizeChanged();
     }
@@ -516,6 +847,8 @@ void SurfaceInterface::Private::commit()
     if (!subSurface.isNull() && subSurface->isSynchronized()) {
         swapStates(&pending, &subSurfacePending, false);
     } else {
+        committing = true;
+        damageHistoryEntryOpen = false;
         swapStates(&pending, &current, true);
         if (!subSurface.isNull()) {
             subSurface->d_func()->commit();
@@ -529,6 +862,7 @@ void SurfaceInterface::Private::commit()
             }
             subSurface->d_func()->commit();
         }
+        committing = false;
     }
     if (role) {
         role->commit();
@@ -541,6 +875,8 @@ void SurfaceInterface::Private::commitSubSurface()
     if (subSurface.isNull() || !subSurface->isSynchronized()) {
         return;
     }
+    committing = true;
+    damageHistoryEntryOpen = false;
     swapStates(&subSurfacePending, &current, true);
     // "The cached state is applied to the sub-surface immediately after the parent surface's state is applied"
     for (auto it = current.children.constBegin(); it != current.children.constEnd(); ++it) {
@@ -550,31 +886,194 @@ void SurfaceInterface::Private::commitSubSurface()
         }
         subSurface->d_func()->commit();
     }
+    committing = false;
+}
+
+void SurfaceInterface::Private::addDamageHistory(const QRegion &region)
+{
+    DamageAccumulator damage;
+    damage.add(region);
+    addDamageHistory(damage);
+}
+
+void SurfaceInterface::Private::addDamageHistory(const DamageAccumulator &damage, const QPoint &offset)
+{
+    if (damage.isEmpty()) {
+        return;
+    }
+    // the entries are reused, which keeps the capacity of their rectangles
+    if (committing && damageHistoryEntryOpen) {
+        damageHistory[commitSequence % s_damageHistorySize].add(damage, offset);
+    } else {
+        commitSequence++;
+        DamageAccumulator &entry = damageHistory[commitSequence % s_damageHistorySize];
+        entry.clear();
+        entry.add(damage, offset);
+        damageHistoryEntryOpen = committing;
+    }
+    if (subSurface.isNull()) {
+        return;
+    }
+    // everything changing the area covered by this surface adds damage
+    subSurface->d_func()->boundingRect = boundingRect();
+    const auto parent = subSurface->parentSurface();
+    if (!parent.isNull()) {
+        parent->d_func()->addDamageHistory(damage, offset + subSurface->position());
+    }
+}
+
+QRegion SurfaceInterface::Private::damageRegion() const
+{
+    if (!damageRegionValid) {
+        damageRegionCache = current.damageRects.toRegion();
+        damageRegionValid = true;
+    }
+    return damageRegionCache;
+}
+
+QRect SurfaceInterface::Private::boundingRect() const
+{
+    QRect rect(QPoint(0, 0), current.buffer ? surfaceSizeForBuffer(current.buffer->size(), current.scale, current.transform) : QSize());
+    for (const auto &child : current.children) {
+        if (child.isNull() || child->surface().isNull() || !child->surface()->isMapped()) {
+            continue;
+        }
+        rect |= child->surface()->d_func()->boundingRect().translated(child->position());
+    }
+    return rect;
+}
+
+void SurfaceInterface::Private::invalidateInputShapes()
+{
+    // the shapes of the parent surfaces contain this surface, so they need to be rebuilt as well
+    inputShapesValid = false;
+    if (subSurface.isNull()) {
+        return;
+    }
+    const auto parent = subSurface->parentSurface();
+    if (!parent.isNull()) {
+        parent->d_func()->invalidateInputShapes();
+    }
+}
+
+void SurfaceInterface::Private::collectInputShapes(QVector<InputShape> &shapes, const QPoint &offset)
+{
+    // same order as a recursive search, the top most child is last in list
+    for (auto it = current.children.crbegin(); it != current.children.crend(); ++it) {
+        const auto &child = *it;
+        if (child.isNull() || child->surface().isNull() || !child->surface()->isMapped()) {
+            continue;
+        }
+        child->surface()->d_func()->collectInputShapes(shapes, offset + child->position());
+    }
+    Q_Q(SurfaceInterface);
+    const QSize size = q->size();
+    if (size.isEmpty()) {
+        return;
+    }
+    shapes.append(InputShape{q, QRectF(offset, size), offset, current.input, current.inputIsInfinite});
+}
+
+void SurfaceInterface::Private::updateInputShapes()
+{
+    inputShapes.clear();
+    inputSlabEdges.clear();
+    inputSlabs.clear();
+    inputShapesValid = true;
+    collectInputShapes(inputShapes, QPoint(0, 0));
+    if (inputShapes.isEmpty()) {
+        return;
+    }
+    for (const InputShape &shape : qAsConst(inputShapes)) {
+        inputSlabEdges << shape.geometry.left() << shape.geometry.right();
+    }
+    std::sort(inputSlabEdges.begin(), inputSlabEdges.end());
+    inputSlabEdges.erase(std::unique(inputSlabEdges.begin(), inputSlabEdges.end()), inputSlabEdges.end());
+    inputSlabs.resize(inputSlabEdges.count() - 1);
+    for (int i = 0; i < inputShapes.count(); ++i) {
+        const QRectF &geometry = inputShapes.at(i).geometry;
+        // QRectF::contains includes the right edge, so shapes touching a slab are part of it
+        const int first = std::lower_bound(inputSlabEdges.constBegin(), inputSlabEdges.constEnd(), geometry.left()) - inputSlabEdges.constBegin();
+        for (int slab = qMax(0, first - 1); slab < inputSlabs.count() && inputSlabEdges.at(slab) <= geometry.right(); ++slab) {
+            inputSlabs[slab].append(i);
+        }
+    }
+}
+
+SurfaceInterface *SurfaceInterface::Private::inputShapeAt(const QPointF &position)
+{
+    if (!inputShapesValid) {
+        updateInputShapes();
+    }
+    if (inputSlabs.isEmpty() || position.x() < inputSlabEdges.first() || position.x() > inputSlabEdges.last()) {
+        return nullptr;
+    }
+    const int edge = std::upper_bound(inputSlabEdges.constBegin(), inputSlabEdges.constEnd(), position.x()) - inputSlabEdges.constBegin();
+    const int slab = qMin(edge - 1, inputSlabs.count() - 1);
+    for (int index : inputSlabs.at(slab)) {
+        const InputShape &shape = inputShapes.at(index);
+        if (shape.geometry.contains(position) &&
+                (shape.inputIsInfinite || shape.input.contains((position - shape.offset).toPoint()))) {
+            return shape.surface;
+        }
+    }
+    return nullptr;
+}
+
+void SurfaceInterface::Private::combineDamage(State *state, const QRect &clip)
+{
+    // buffer damage in surface-local coordinates, the inverse of mapToBuffer
+    const Transform tr = state->transform;
+    const qint32 sc = state->scale;
+    const QSize surfaceSize = surfaceSizeForBuffer(state->buffer->size(), sc, tr);
+    // combined in place, which keeps the capacity of the vectors for further commits
+    DamageAccumulator &damage = state->damageRects;
+    for (const auto &rect : state->bufferDamageRects.rects()) {
+        // rounded outwards, partially damaged surface pixels are damaged
+        const QPoint p1 = bufferToSurface(tr, surfaceSize, QPoint(divideFloor(rect.x(), sc), divideFloor(rect.y(), sc)));
+        const QPoint p2 = bufferToSurface(tr, surfaceSize, QPoint(divideCeil(rect.x() + rect.width(), sc),
+                                                                  divideCeil(rect.y() + rect.height(), sc)));
+        damage.add(QRect(QPoint(qMin(p1.x(), p2.x()), qMin(p1.y(), p2.y())),
+                         QSize(qAbs(p2.x() - p1.x()), qAbs(p2.y() - p1.y()))));
+    }
+    state->bufferDamageRects.clear();
+
+    // the CompositorInterface can be destroyed before its surfaces
+    const int maxRects = compositor ? compositor->damageRectsThreshold() : DamageAccumulator::s_defaultMaxRects;
+    const qreal maxAreaOverhead = compositor ? compositor->damageAreaOverhead() : DamageAccumulator::s_defaultMaxAreaOverhead;
+    damageStatistics.commits++;
+    damageStatistics.rects += damage.count();
+    damageStatistics.maxRectsPerCommit = qMax(damageStatistics.maxRectsPerCommit, quint64(damage.count()));
+    if (damage.simplify(maxRects, maxAreaOverhead)) {
+        damageStatistics.boundingBoxCommits++;
+    }
+    damage.intersect(clip);
 }
 
 void SurfaceInterface::Private::damage(const QRect &rect)
 {
-    pending.damage = pending.damage.united(rect);
+    pending.damageRects.add(rect);
 }
 
 void SurfaceInterface::Private::damageBuffer(const QRect &rect)
 {
-    if (!pending.bufferIsSet || (pending.bufferIsSet && !pending.buffer)) {
+    if (!(pending.changes & State::BufferChange) || !pending.buffer) {
         // TODO: should we send an error?
         return;
     }
-    pending.bufferDamage = pending.bufferDamage.united(rect);
+    pending.bufferDamageRects.add(rect);
 }
 
 void SurfaceInterface::Private::setScale(qint32 scale)
 {
     pending.scale = scale;
-    pending.scaleIsSet = true;
+    pending.changes |= State::ScaleChange;
 }
 
 void SurfaceInterface::Private::setTransform(OutputInterface::Transform transform)
 {
     pending.transform = transform;
+    pending.changes |= State::TransformChange;
 }
 
 void SurfaceInterface::Private::addFrameCallback(uint32_t callback)
@@ -585,27 +1084,40 @@ void SurfaceInterface::Private::addFrameCallback(uint32_t callback)
         return;
     }
     wl_resource_set_implementation(r, nullptr, this, destroyFrameCallback);
-    pending.callbacks << r;
+    pending.callbacks.append(r);
+}
+
+void SurfaceInterface::Private::addPresentationFeedback(uint32_t id)
+{
+    wl_resource *r = client->createResource(&wp_presentation_feedback_interface, 1, id);
+    if (!r) {
+        wl_resource_post_no_memory(resource);
+        return;
+    }
+    wl_resource_set_implementation(r, nullptr, this, destroyPresentationFeedback);
+    pending.presentationFeedbacks << r;
 }
 
 void SurfaceInterface::Private::attachBuffer(wl_resource *buffer, const QPoint &offset)
 {
-    pending.bufferIsSet = true;
+    pending.changes |= State::BufferChange;
     pending.offset = offset;
-    if (pending.buffer) {
-        delete pending.buffer;
-    }
     if (!buffer) {
         // got a null buffer, deletes content in next frame
         pending.buffer = nullptr;
-        pending.damage = QRegion();
-        pending.bufferDamage = QRegion();
+        pending.damageRects.clear();
+        pending.bufferDamageRects.clear();
         return;
     }
     Q_Q(SurfaceInterface);
-    pending.buffer = new BufferInterface(buffer, q);
+    pending.buffer = BufferInterface::attach(buffer, q);
+    if (connectedBuffers.contains(pending.buffer)) {
+        return;
+    }
+    connectedBuffers.insert(pending.buffer);
     QObject::connect(pending.buffer, &BufferInterface::aboutToBeDestroyed, q,
         [this](BufferInterface *buffer) {
+            connectedBuffers.remove(buffer);
             if (pending.buffer == buffer) {
                 pending.buffer = nullptr;
             }
@@ -618,14 +1130,29 @@ void SurfaceInterface::Private::attachBuffer(wl_resource *buffer, const QPoint &
             }
         }
     );
+    // connected once instead of on each commit, connecting allocates
+    BufferInterface *b = pending.buffer;
+    QObject::connect(b, &BufferInterface::sizeChanged, q,
+        [this, b] {
+            if (current.buffer == b) {
+                emit q_func()->sizeChanged();
+            }
+        }
+    );
 }
 
 void SurfaceInterface::Private::destroyFrameCallback(wl_resource *r)
+{
+    // the callback might be in any of the states, the intrusive list does not need to know which
+    FrameCallbackList::remove(r);
+}
+
+void SurfaceInterface::Private::destroyPresentationFeedback(wl_resource *r)
 {
     auto s = cast<Private>(r);
-    s->current.callbacks.removeAll(r);
-    s->pending.callbacks.removeAll(r);
-    s->subSurfacePending.callbacks.removeAll(r);
+    s->current.presentationFeedbacks.removeAll(r);
+    s->pending.presentationFeedbacks.removeAll(r);
+    s->subSurfacePending.presentationFeedbacks.removeAll(r);
 }
 
 void SurfaceInterface::Private::attachCallback(wl_client *client, wl_resource *resource, wl_resource *buffer, int32_t sx, int32_t sy)
@@ -663,7 +1190,7 @@ void SurfaceInterface::Private::opaqueRegionCallback(wl_client *client, wl_resou
 
 void SurfaceInterface::Private::setOpaque(const QRegion &region)
 {
-    pending.opaqueIsSet = true;
+    pending.changes |= State::OpaqueChange;
     pending.opaque = region;
 }
 
@@ -677,7 +1204,7 @@ void SurfaceInterface::Private::inputRegionCallback(wl_client *client, wl_resour
 
 void SurfaceInterface::Private::setInput(const QRegion &region, bool isInfinite)
 {
-    pending.inputIsSet = true;
+    pending.changes |= State::InputChange;
     pending.inputIsInfinite = isInfinite;
     pending.input = region;
 }
@@ -703,7 +1230,7 @@ void SurfaceInterface::Private::bufferScaleCallback(wl_client *client, wl_resour
 QRegion SurfaceInterface::damage() const
 {
     Q_D();
-    return d->current.damage;
+    return d->damageRegion();
 }
 
 QRegion SurfaceInterface::opaque() const
@@ -778,9 +1305,8 @@ QPointer< SubSurfaceInterface > SurfaceInterface::subSurface() const
 QSize SurfaceInterface::size() const
 {
     Q_D();
-    // TODO: apply transform to the buffer size
     if (d->current.buffer) {
-        return d->current.buffer->size() / scale();
+        return surfaceSizeForBuffer(d->current.buffer->size(), d->current.scale, d->current.transform);
     }
     return QSize();
 }
@@ -823,6 +1349,10 @@ bool SurfaceInterface::isMapped() const
 QRegion SurfaceInterface::trackedDamage() const
 {
     Q_D();
+    if (!d->trackedDamageRects.isEmpty()) {
+        d->trackedDamage = d->trackedDamage.united(d->trackedDamageRects.toRegion());
+        d->trackedDamageRects.clear();
+    }
     return d->trackedDamage;
 }
 
@@ -830,6 +1360,42 @@ void SurfaceInterface::resetTrackedDamage()
 {
     Q_D();
     d->trackedDamage = QRegion();
+    d->trackedDamageRects.clear();
+}
+
+SurfaceInterface::DamageStatistics SurfaceInterface::damageStatistics() const
+{
+    Q_D();
+    return d->damageStatistics;
+}
+
+void SurfaceInterface::resetDamageStatistics()
+{
+    Q_D();
+    d->damageStatistics = DamageStatistics();
+}
+
+quint64 SurfaceInterface::commitSequence() const
+{
+    Q_D();
+    return d->commitSequence;
+}
+
+QRegion SurfaceInterface::damageSince(quint64 sequence) const
+{
+    Q_D();
+    if (sequence >= d->commitSequence) {
+        return QRegion();
+    }
+    if (d->commitSequence - sequence > quint64(Private::s_damageHistorySize)) {
+        // no longer in the history
+        return d->boundingRect();
+    }
+    DamageAccumulator damage;
+    for (quint64 i = sequence + 1; i <= d->commitSequence; ++i) {
+        damage.add(d->damageHistory.at(i % Private::s_damageHistorySize));
+    }
+    return damage.toRegion();
 }
 
 QVector<OutputInterface *> SurfaceInterface::outputs() const
@@ -876,6 +1442,31 @@ void SurfaceInterface::setOutputs(const QVector<OutputInterface *> &outputs)
     d->outputs = outputs;
 }
 
+QRegion SurfaceInterface::mapToBuffer(const QRegion &region) const
+{
+    Q_D();
+    if (!d->current.buffer || region.isEmpty()) {
+        return QRegion();
+    }
+    const Transform tr = d->current.transform;
+    const qint32 sc = d->current.scale;
+    const QSize bufferSize = d->current.buffer->size();
+    const QSize surfaceSize = surfaceSizeForBuffer(bufferSize, sc, tr);
+    const QRect bounds(QPoint(0, 0), bufferSize);
+    if (tr == Transform::Normal && sc == 1) {
+        return region.intersected(bounds);
+    }
+    QRegion mapped;
+    for (const QRect &rect : region) {
+        const QPoint p1 = surfaceToBuffer(tr, surfaceSize, rect.topLeft());
+        const QPoint p2 = surfaceToBuffer(tr, surfaceSize, QPoint(rect.x() + rect.width(), rect.y() + rect.height()));
+        const QRect r(QPoint(qMin(p1.x(), p2.x()) * sc, qMin(p1.y(), p2.y()) * sc),
+                      QSize(qAbs(p2.x() - p1.x()) * sc, qAbs(p2.y() - p1.y()) * sc));
+        mapped += r.intersected(bounds);
+    }
+    return mapped;
+}
+
 SurfaceInterface *SurfaceInterface::surfaceAt(const QPointF &position)
 {
     if (!isMapped()) {
@@ -904,31 +1495,11 @@ SurfaceInterface *SurfaceInterface::surfaceAt(const QPointF &position)
 
 SurfaceInterface *SurfaceInterface::inputSurfaceAt(const QPointF &position)
 {
-    // TODO: Most of this is very similar to SurfaceInterface::surfaceAt
-    //       Is there a way to reduce the code duplication?
     if (!isMapped()) {
         return nullptr;
     }
     Q_D();
-    // go from top to bottom. Top most child is last in list
-    QListIterator<QPointer<SubSurfaceInterface>> it(d->current.children);
-    it.toBack();
-    while (it.hasPrevious()) {
-        const auto &current = it.previous();
-        auto surface = current->surface();
-        if (surface.isNull()) {
-            continue;
-        }
-        if (auto s = surface->inputSurfaceAt(position - current->position())) {
-            return s;
-        }
-    }
-    // check whether the geometry and input region contain the pos
-    if (!size().isEmpty() && QRectF(QPoint(0, 0), size()).contains(position) &&
-            (inputIsInfinite() || input().contains(position.toPoint()))) {
-        return this;
-    }
-    return nullptr;
+    return d->inputShapeAt(position);
 }
 
 QPointer<LockedPointerInterface> SurfaceInterface::lockedPointer() const
@@ -22,11 +22,14 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "resource.h"
 #include "output_interface.h"
+#include "presentation_interface.h"
 
 #include <QObject>
 #include <QPointer>
 #include <QRegion>
 
+#include <chrono>
+
 #include <KWayland/Server/kwaylandserver_export.h>
 
 namespace KWayland
@@ -94,7 +97,110 @@ class KWAYLANDSERVER_EXPORT SurfaceInterface : public Resource
 public:
     virtual ~SurfaceInterface();
 
+    /**
+     * Sends the frame callbacks of the current state of this SurfaceInterface and of its
+     * sub-surfaces with the timestamp @p msec, unless the frame throttling policy holds
+     * them back.
+     * @see setFrameThrottling
+     **/
     void frameRendered(quint32 msec);
+    /**
+     * Reports that the content of the current state of this SurfaceInterface and of its
+     * sub-surfaces got presented on @p output to the clients which requested presentation
+     * feedback for it.
+     *
+     * The @p timestamp is the time the content turned into light, in the domain of
+     * PresentationInterface::clockId. The @p refresh is the duration until the next
+     * possible presentation on @p output, or @c 0 if it is not known. The @p sequence is
+     * the vertical retrace counter of @p output, it should be @c 0 if @p kinds does not
+     * contain PresentationInterface::Kind::Vsync.
+     *
+     * The feedback gets destroyed afterwards, so it is reported once per commit.
+     * @see presentationDiscarded
+     * @see PresentationInterface
+     * @since 5.67
+     **/
+    void presented(OutputInterface *output, std::chrono::nanoseconds timestamp, std::chrono::nanoseconds refresh,
+                   quint64 sequence, PresentationInterface::Kinds kinds);
+    /**
+     * Reports to the clients which requested presentation feedback for the current state
+     * of this SurfaceInterface and of its sub-surfaces that the content did not get
+     * presented, e.g. because the surface is not visible.
+     * @see presented
+     * @since 5.67
+     **/
+    void presentationDiscarded();
+
+    /**
+     * Policies to throttle the frame callbacks sent by frameRendered.
+     * @see setFrameThrottling
+     * @since 5.67
+     **/
+    enum class FrameThrottling {
+        /**
+         * frameRendered sends the frame callbacks right away.
+         **/
+        None,
+        /**
+         * Frame callbacks are sent at most once per frameThrottlingInterval, callbacks
+         * requested in between are held and sent once the interval elapsed.
+         **/
+        LowRate,
+        /**
+         * Frame callbacks are held until the policy changes or, if set, the
+         * frameSuspendTimeout elapsed.
+         **/
+        Suspended
+    };
+    Q_ENUM(FrameThrottling)
+    /**
+     * Sets the @p policy to throttle the frame callbacks of this SurfaceInterface, e.g.
+     * to prevent occluded or minimized windows from rendering at full rate. The policy
+     * applies to the complete sub-surface tree, a sub-surface uses the strictest policy
+     * of itself and its parent surfaces.
+     *
+     * Frame callbacks held by the previous policy get sent if the new policy allows it.
+     *
+     * The default is FrameThrottling::None.
+     * @see frameThrottling
+     * @see setFrameThrottlingInterval
+     * @see setFrameSuspendTimeout
+     * @since 5.67
+     **/
+    void setFrameThrottling(FrameThrottling policy);
+    /**
+     * @returns the frame throttling policy set on this SurfaceInterface, not taking the
+     * parent surfaces into account
+     * @see setFrameThrottling
+     * @since 5.67
+     **/
+    FrameThrottling frameThrottling() const;
+    /**
+     * Sets the minimum @p interval in msec between two frame callbacks for the policy
+     * FrameThrottling::LowRate. The default is @c 1000.
+     * @see setFrameThrottling
+     * @since 5.67
+     **/
+    void setFrameThrottlingInterval(int interval);
+    /**
+     * @see setFrameThrottlingInterval
+     * @since 5.67
+     **/
+    int frameThrottlingInterval() const;
+    /**
+     * Sets the @p timeout in msec after which frame callbacks held by the policy
+     * FrameThrottling::Suspended get sent anyway. This allows clients which wait for the
+     * frame callback to make progress now and then. A @p timeout of @c 0 holds the frame
+     * callbacks until the policy changes. The default is @c 0.
+     * @see setFrameThrottling
+     * @since 5.67
+     **/
+    void setFrameSuspendTimeout(int timeout);
+    /**
+     * @see setFrameSuspendTimeout
+     * @since 5.67
+     **/
+    int frameSuspendTimeout() const;
 
     QRegion damage() const;
     QRegion opaque() const;
@@ -199,6 +305,93 @@ public:
      **/
     void resetTrackedDamage();
 
+    /**
+     * Statistics about the damage sent by the client, meant for tuning the damage policy
+     * of the CompositorInterface.
+     * @see damageStatistics
+     * @since 5.67
+     **/
+    struct DamageStatistics {
+        /**
+         * Number of committed BufferInterfaces with damage.
+         **/
+        quint64 commits = 0;
+        /**
+         * Number of damage rectangles sent by the client in these commits.
+         **/
+        quint64 rects = 0;
+        /**
+         * Highest number of damage rectangles in a single commit.
+         **/
+        quint64 maxRectsPerCommit = 0;
+        /**
+         * Number of commits for which the bounding box of the damage rectangles got used
+         * instead of the exact region.
+         **/
+        quint64 boundingBoxCommits = 0;
+    };
+    /**
+     * @returns Statistics about the damage since creation or the last call to resetDamageStatistics
+     * @see CompositorInterface::setDamageRectsThreshold
+     * @see CompositorInterface::setDamageAreaOverhead
+     * @since 5.67
+     **/
+    DamageStatistics damageStatistics() const;
+    /**
+     * Resets the damageStatistics.
+     * @since 5.67
+     **/
+    void resetDamageStatistics();
+
+    /**
+     * The sequence number of the last commit which damaged this SurfaceInterface or one of
+     * its sub-surfaces. It starts at @c 0 and increases with each such commit. Synchronized
+     * sub-surfaces applied together with their parent share the commit sequence of the parent.
+     *
+     * A compositor repainting based on the buffer age can remember the commitSequence
+     * at the time it rendered into a buffer and pass it to damageSince when reusing the buffer.
+     *
+     * @see damageSince
+     * @since 5.67
+     **/
+    quint64 commitSequence() const;
+
+    /**
+     * Returns the damage of all commits after the commit with the given @p sequence in
+     * surface-local coordinates. The damage includes the damage of all sub-surfaces, the
+     * geometry a sub-surface is moved away from or an unmapped sub-surface covered as well
+     * as the area uncovered by a surface getting smaller.
+     *
+     * Only the damage of the last commits is kept. If the damage since @p sequence is no
+     * longer available, the geometry of the SurfaceInterface including all its sub-surfaces
+     * is returned.
+     *
+     * In contrast to trackedDamage the compositor does not need to reset the damage and the
+     * damage can be queried for multiple buffers.
+     *
+     * @param sequence A value previously returned by commitSequence
+     * @returns Combined damage since the commit @p sequence, an empty region if there was none
+     * @see commitSequence
+     * @since 5.67
+     **/
+    QRegion damageSince(quint64 sequence) const;
+
+    /**
+     * Maps the @p region from surface-local coordinates to the coordinates of the currently
+     * attached BufferInterface, taking the buffer scale and buffer transform into account.
+     * The result is clipped to the size of the BufferInterface.
+     *
+     * This allows to e.g. only upload the damaged parts of a shared memory buffer:
+     * @code
+     * surface->buffer()->copyTo(staging, stride, surface->mapToBuffer(surface->damage()));
+     * @endcode
+     *
+     * @returns @p region in buffer coordinates, an empty region if no buffer is attached
+     * @see BufferInterface::copyTo
+     * @since 5.67
+     **/
+    QRegion mapToBuffer(const QRegion &region) const;
+
     /**
      * Finds the SurfaceInterface at the given @p position in surface-local coordinates.
      * This can be either a descendant SurfaceInterface honoring the stacking order or
@@ -366,6 +559,7 @@ Q_SIGNALS:
     void committed();
 
 private:
+    friend class BufferInterface;
     friend class CompositorInterface;
     friend class SubSurfaceInterface;
     friend class ShadowManagerInterface;
@@ -374,6 +568,7 @@ private:
     friend class ContrastManagerInterface;
     friend class IdleInhibitManagerUnstableV1Interface;
     friend class PointerConstraintsUnstableV1Interface;
+    friend class PresentationInterface;
     friend class SurfaceRole;
     explicit SurfaceInterface(CompositorInterface *parent, wl_resource *parentResource);
 
@@ -21,13 +21,18 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #define WAYLAND_SERVER_SURFACE_INTERFACE_P_H
 
 #include "surface_interface.h"
+#include "damageaccumulator_p.h"
 #include "resource_p.h"
 // Qt
+#include <QElapsedTimer>
 #include <QHash>
+#include <QSet>
 #include <QVector>
 // Wayland
 #include <wayland-server.h>
 
+class QTimer;
+
 namespace KWayland
 {
 namespace Server
@@ -36,28 +41,92 @@ namespace Server
 class IdleInhibitorInterface;
 class SurfaceRole;
 
+/**
+ * Intrusive list of wl_callback resources, linked through the link of the wl_resource.
+ * Adding a callback, moving all callbacks to another list and removing a destroyed
+ * callback neither allocate nor search.
+ *
+ * Copying a list yields an empty list, a callback can only be part of one list.
+ **/
+class FrameCallbackList
+{
+public:
+    FrameCallbackList() {
+        wl_list_init(&m_list);
+    }
+    FrameCallbackList(const FrameCallbackList &other) {
+        Q_UNUSED(other)
+        wl_list_init(&m_list);
+    }
+    FrameCallbackList &operator=(const FrameCallbackList &other) {
+        Q_UNUSED(other)
+        return *this;
+    }
+
+    bool isEmpty() const {
+        return wl_list_empty(&m_list);
+    }
+    void append(wl_resource *callback) {
+        wl_list_insert(m_list.prev, wl_resource_get_link(callback));
+    }
+    /**
+     * Moves all callbacks of @p other to the end of this list.
+     **/
+    void splice(FrameCallbackList &other) {
+        wl_list_insert_list(m_list.prev, &other.m_list);
+        wl_list_init(&other.m_list);
+    }
+    wl_resource *takeFirst() {
+        wl_list *link = m_list.next;
+        unlink(link);
+        return wl_resource_from_link(link);
+    }
+    /**
+     * Removes the @p callback from the list it is part of, to be called when it gets destroyed.
+     **/
+    static void remove(wl_resource *callback) {
+        unlink(wl_resource_get_link(callback));
+    }
+
+private:
+    static void unlink(wl_list *link) {
+        wl_list_remove(link);
+        // keeps removing the callback again valid
+        wl_list_init(link);
+    }
+    wl_list m_list;
+};
+
 class SurfaceInterface::Private : public Resource::Private
 {
 public:
     struct State {
-        QRegion damage = QRegion();
-        QRegion bufferDamage = QRegion();
+        enum Change {
+            BufferChange = 1 << 0,
+            OpaqueChange = 1 << 1,
+            InputChange = 1 << 2,
+            ScaleChange = 1 << 3,
+            TransformChange = 1 << 4,
+            ShadowChange = 1 << 5,
+            BlurChange = 1 << 6,
+            ContrastChange = 1 << 7,
+            SlideChange = 1 << 8,
+            ChildrenChange = 1 << 9
+        };
+        // bitmask of the Changes set since the last commit
+        quint32 changes = 0;
+        // damage rectangles as sent by the client, on the current state they hold the
+        // combined damage of the commit in surface-local coordinates
+        DamageAccumulator damageRects;
+        DamageAccumulator bufferDamageRects;
         QRegion opaque = QRegion();
         QRegion input = QRegion();
-        bool inputIsSet = false;
-        bool opaqueIsSet = false;
-        bool bufferIsSet = false;
-        bool shadowIsSet = false;
-        bool blurIsSet = false;
-        bool contrastIsSet = false;
-        bool slideIsSet = false;
         bool inputIsInfinite = true;
-        bool childrenChanged = false;
-        bool scaleIsSet = false;
-        bool transformIsSet = false;
         qint32 scale = 1;
         OutputInterface::Transform transform = OutputInterface::Transform::Normal;
-        QList<wl_resource*> callbacks = QList<wl_resource*>();
+        FrameCallbackList callbacks;
+        // wp_presentation_feedback resources for the content of this state
+        QList<wl_resource*> presentationFeedbacks;
         QPoint offset = QPoint();
         BufferInterface *buffer = nullptr;
         // stacking order: bottom (first) -> top (last)
@@ -83,17 +152,88 @@ public:
     void installPointerConstraint(LockedPointerInterface *lock);
     void installPointerConstraint(ConfinedPointerInterface *confinement);
     void installIdleInhibitor(IdleInhibitorInterface *inhibitor);
+    void addPresentationFeedback(uint32_t id);
 
     void commitSubSurface();
     void commit();
 
+    /**
+     * Adds @p region in surface-local coordinates to the damage history and to the
+     * history of the parent surfaces.
+     **/
+    void addDamageHistory(const QRegion &region);
+    void addDamageHistory(const DamageAccumulator &damage, const QPoint &offset = QPoint());
+    /**
+     * The damage of the current state, the QRegion is only built when requested.
+     **/
+    QRegion damageRegion() const;
+    /**
+     * The geometry of the surface and its mapped sub-surfaces in surface-local coordinates.
+     **/
+    QRect boundingRect() const;
+
+    /**
+     * A mapped surface of the sub-surface tree in surface-local coordinates of this surface.
+     **/
+    struct InputShape {
+        SurfaceInterface *surface;
+        QRectF geometry;
+        QPoint offset;
+        QRegion input;
+        bool inputIsInfinite;
+    };
+    /**
+     * Marks the input shapes of this surface and of all parent surfaces as outdated.
+     **/
+    void invalidateInputShapes();
+    /**
+     * @returns the input receiving surface at @p position, rebuilding the input shapes if needed
+     **/
+    SurfaceInterface *inputShapeAt(const QPointF &position);
+
+    /**
+     * @returns the surface of this sub-surface tree whose frame throttling policy applies
+     * to this surface, that is the one with the strictest policy
+     **/
+    const Private *frameThrottlingSource() const;
+    /**
+     * Sends the due frame callbacks with the timestamp @p msec or holds them back
+     * according to the frame throttling policy.
+     **/
+    void throttleFrameCallbacks(quint32 msec);
+    void sendFrameCallbacks(quint32 msec);
+    /**
+     * Re-evaluates the held frame callbacks of this surface and its sub-surfaces.
+     **/
+    void frameThrottlingChanged();
+    /**
+     * @returns the timestamp of the last frameRendered advanced by the time passed since
+     **/
+    quint32 frameTime() const;
+
     SurfaceRole *role = nullptr;
+    // unlike global this gets reset when the CompositorInterface is destroyed before the surface
+    QPointer<CompositorInterface> compositor;
 
     State current;
     State pending;
     State subSurfacePending;
     QPointer<SubSurfaceInterface> subSurface;
-    QRegion trackedDamage;
+    // the damage rectangles of the latest commits get united into trackedDamage when requested
+    mutable QRegion trackedDamage;
+    mutable DamageAccumulator trackedDamageRects;
+    static const int s_maxTrackedDamageRects = 64;
+    mutable QRegion damageRegionCache;
+    mutable bool damageRegionValid = false;
+    DamageStatistics damageStatistics;
+
+    // damage of the last commits, the damage of commit sequence n is at n % s_damageHistorySize
+    static const int s_damageHistorySize = 16;
+    QVector<DamageAccumulator> damageHistory = QVector<DamageAccumulator>(s_damageHistorySize);
+    quint64 commitSequence = 0;
+    // damage of the sub-surfaces committed along with this surface goes into the same entry
+    bool committing = false;
+    bool damageHistoryEntryOpen = false;
 
     // workaround for https://bugreports.qt.io/browse/QTBUG-52192
     // A subsurface needs to be considered mapped even if it doesn't have a buffer attached
@@ -101,12 +241,34 @@ public:
     // waiting on the frame callback of the never visible surface
     bool subSurfaceIsMapped = true;
 
+    // the flattened sub-surface tree used by inputSurfaceAt, top most surface first
+    QVector<InputShape> inputShapes;
+    // the sorted x coordinates of all shape edges, they split the tree into vertical slabs
+    // inputSlabs[i] holds the shapes overlapping the slab between edge i and i + 1 in stacking order
+    QVector<qreal> inputSlabEdges;
+    QVector<QVector<int>> inputSlabs;
+    bool inputShapesValid = false;
+
+    FrameThrottling frameThrottling = FrameThrottling::None;
+    int frameThrottlingInterval = 1000;
+    int frameSuspendTimeout = 0;
+    // frameRendered got called for the current callbacks, but they got held back
+    bool frameCallbacksDue = false;
+    quint32 lastFrameTime = 0;
+    // started when lastFrameTime got set for held frame callbacks
+    QElapsedTimer sinceLastFrame;
+    QElapsedTimer sinceFrameCallbacks;
+    // sends the held frame callbacks, created on first use
+    QTimer *frameThrottlingTimer = nullptr;
+
     QVector<OutputInterface *> outputs;
 
     QPointer<LockedPointerInterface> lockedPointer;
     QPointer<ConfinedPointerInterface> confinedPointer;
     QHash<OutputInterface*, QMetaObject::Connection> outputDestroyedConnections;
     QVector<IdleInhibitorInterface*> idleInhibitors;
+    // BufferInterfaces we are connected to, a wl_buffer keeps its BufferInterface across attaches
+    QSet<BufferInterface*> connectedBuffers;
 
     SurfaceInterface *dataProxy = nullptr;
 
@@ -118,16 +280,28 @@ private:
         return reinterpret_cast<SurfaceInterface *>(q);
     }
     void swapStates(State *source, State *target, bool emitChanged);
+    /**
+     * Combines the damage rectangles of @p state in place into the damage of the commit,
+     * clipped to @p clip in surface-local coordinates.
+     **/
+    void combineDamage(State *state, const QRect &clip);
+    void updateInputShapes();
+    void collectInputShapes(QVector<InputShape> &shapes, const QPoint &offset);
     void damage(const QRect &rect);
     void damageBuffer(const QRect &rect);
     void setScale(qint32 scale);
     void setTransform(OutputInterface::Transform transform);
     void addFrameCallback(uint32_t callback);
+    /**
+     * Sends discarded to all presentation feedbacks of @p state and destroys them.
+     **/
+    void discardPresentationFeedback(State *state);
     void attachBuffer(wl_resource *buffer, const QPoint &offset);
     void setOpaque(const QRegion &region);
     void setInput(const QRegion &region, bool isInfinite);
 
     static void destroyFrameCallback(wl_resource *r);
+    static void destroyPresentationFeedback(wl_resource *r);
 
     static void attachCallback(wl_client *client, wl_resource *resource, wl_resource *buffer, int32_t sx, int32_t sy);
     static void damageCallback(wl_client *client, wl_resource *resource, int32_t x, int32_t y, int32_t width, int32_t height);
@@ -0,0 +1,871 @@
+/********************************************************************
+Copyright 2020  agent <agent@local>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) version 3, or any
+later version accepted by the membership of KDE e.V. (or its
+successor approved by the membership of KDE e.V.), which shall
+act as a proxy defined in Section 6 of version 3 of the license.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#include "pixelconverter_p.h"
+
+#include <QRgb>
+// std
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define KWAYLAND_PIXELCONVERTER_X86 1
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define KWAYLAND_PIXELCONVERTER_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace KWayland
+{
+
+namespace
+{
+
+constexpr quint32 fourcc(char a, char b, char c, char d)
+{
+    return quint32(a) | (quint32(b) << 8) | (quint32(c) << 16) | (quint32(d) << 24);
+}
+
+// wl_shm formats, apart from the two mandatory formats they are identical to the drm fourcc codes
+enum ShmFormat : quint32 {
+    Argb8888 = 0,
+    Xrgb8888 = 1,
+    Abgr8888 = fourcc('A', 'B', '2', '4'),
+    Xbgr8888 = fourcc('X', 'B', '2', '4'),
+    Rgb565 = fourcc('R', 'G', '1', '6'),
+    Argb2101010 = fourcc('A', 'R', '3', '0'),
+    Xrgb2101010 = fourcc('X', 'R', '3', '0'),
+    Abgr2101010 = fourcc('A', 'B', '3', '0'),
+    Xbgr2101010 = fourcc('X', 'B', '3', '0'),
+    Argb16161616f = fourcc('A', 'R', '4', 'H'),
+    Xrgb16161616f = fourcc('X', 'R', '4', 'H'),
+    Abgr16161616f = fourcc('A', 'B', '4', 'H'),
+    Xbgr16161616f = fourcc('X', 'B', '4', 'H')
+};
+
+const quint32 s_opaque = 0xff000000;
+
+inline quint32 load32(const uchar *source)
+{
+    quint32 p;
+    memcpy(&p, source, sizeof(p));
+    return p;
+}
+
+inline quint16 load16(const uchar *source)
+{
+    quint16 p;
+    memcpy(&p, source, sizeof(p));
+    return p;
+}
+
+inline void store32(uchar *destination, quint32 p)
+{
+    memcpy(destination, &p, sizeof(p));
+}
+
+inline quint32 swapRedBlue(quint32 p)
+{
+    return (p & 0xff00ff00) | ((p >> 16) & 0xff) | ((p & 0xff) << 16);
+}
+
+// byte order R, G, B, A into 0xAARRGGBB
+inline quint32 rgbaToArgb(quint32 p)
+{
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    return (p << 24) | (p >> 8);
+#else
+    return swapRedBlue(p);
+#endif
+}
+
+inline quint32 rgb565ToRgb32(quint32 c)
+{
+    // replicates the most significant bits into the lower bits, like QImage does
+    return s_opaque
+        | ((c << 8) & 0xf80000) | ((c << 3) & 0x70000)
+        | ((c << 5) & 0xfc00) | ((c >> 1) & 0x300)
+        | ((c << 3) & 0xf8) | ((c >> 2) & 0x7);
+}
+
+template <bool bgr, bool opaque>
+inline quint32 rgb30ToArgb32(quint32 c)
+{
+    quint32 a = s_opaque;
+    if (!opaque) {
+        a = c >> 30;
+        a |= a << 2;
+        a |= a << 4;
+        a <<= 24;
+    }
+    if (bgr) {
+        return a | ((c << 14) & 0xff0000) | ((c >> 4) & 0xff00) | ((c >> 22) & 0xff);
+    }
+    return a | ((c >> 6) & 0xff0000) | ((c >> 4) & 0xff00) | ((c >> 2) & 0xff);
+}
+
+inline float halfToFloat(quint16 h)
+{
+    const quint32 sign = quint32(h & 0x8000) << 16;
+    quint32 exponent = (h >> 10) & 0x1f;
+    quint32 mantissa = h & 0x3ff;
+    quint32 bits;
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            bits = sign;
+        } else {
+            // subnormal, normalize it
+            exponent = 127 - 15 + 1;
+            while (!(mantissa & 0x400)) {
+                mantissa <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+    } else if (exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+inline quint32 floatToByte(float f)
+{
+    // also maps NaN to 0
+    if (!(f > 0.0f)) {
+        return 0;
+    }
+    if (f >= 1.0f) {
+        return 255;
+    }
+    return quint32(f * 255.0f + 0.5f);
+}
+
+// scalar implementations, also used for the remaining pixels of the vectorized ones
+
+void copyScalar(uchar *destination, const uchar *source, int width)
+{
+    memcpy(destination, source, width * 4);
+}
+
+template <bool swap, bool opaque>
+void rgba8888Scalar(uchar *destination, const uchar *source, int width)
+{
+    for (int i = 0; i < width; ++i) {
+        quint32 p = load32(source + i * 4);
+        if (swap) {
+            p = swapRedBlue(p);
+        }
+        if (opaque) {
+            p |= s_opaque;
+        }
+        store32(destination + i * 4, p);
+    }
+}
+
+void rgb565Scalar(uchar *destination, const uchar *source, int width)
+{
+    for (int i = 0; i < width; ++i) {
+        store32(destination + i * 4, rgb565ToRgb32(load16(source + i * 2)));
+    }
+}
+
+template <bool bgr, bool opaque>
+void rgb30Scalar(uchar *destination, const uchar *source, int width)
+{
+    for (int i = 0; i < width; ++i) {
+        store32(destination + i * 4, rgb30ToArgb32<bgr, opaque>(load32(source + i * 4)));
+    }
+}
+
+template <bool bgr, bool opaque>
+void rgba16fScalar(uchar *destination, const uchar *source, int width)
+{
+    for (int i = 0; i < width; ++i) {
+        const uchar *s = source + i * 8;
+        // memory order is b, g, r, a for the argb formats
+        const quint32 c0 = floatToByte(halfToFloat(load16(s)));
+        const quint32 g = floatToByte(halfToFloat(load16(s + 2)));
+        const quint32 c2 = floatToByte(halfToFloat(load16(s + 4)));
+        const quint32 a = opaque ? 0xff : floatToByte(halfToFloat(load16(s + 6)));
+        const quint32 r = bgr ? c0 : c2;
+        const quint32 b = bgr ? c2 : c0;
+        store32(destination + i * 4, (a << 24) | (r << 16) | (g << 8) | b);
+    }
+}
+
+// QImage rows into WL_SHM_FORMAT_ARGB8888
+template <bool swap, bool premultiply>
+void imageRowScalar(uchar *destination, const uchar *source, int width)
+{
+    for (int i = 0; i < width; ++i) {
+        quint32 p = load32(source + i * 4);
+        if (swap) {
+            p = rgbaToArgb(p);
+        }
+        if (premultiply) {
+            p = qPremultiply(p);
+        }
+        store32(destination + i * 4, p);
+    }
+}
+
+#if KWAYLAND_PIXELCONVERTER_X86
+
+inline __m128i swapRedBlueSse2(__m128i p)
+{
+    const __m128i greenAlpha = _mm_set1_epi32(0xff00ff00);
+    const __m128i redBlue = _mm_andnot_si128(greenAlpha, p);
+    return _mm_or_si128(_mm_and_si128(p, greenAlpha),
+                        _mm_or_si128(_mm_srli_epi32(redBlue, 16), _mm_slli_epi32(redBlue, 16)));
+}
+
+__attribute__((target("avx2"))) inline __m256i swapRedBlueAvx2(__m256i p)
+{
+    const __m256i greenAlpha = _mm256_set1_epi32(0xff00ff00);
+    const __m256i redBlue = _mm256_andnot_si256(greenAlpha, p);
+    return _mm256_or_si256(_mm256_and_si256(p, greenAlpha),
+                           _mm256_or_si256(_mm256_srli_epi32(redBlue, 16), _mm256_slli_epi32(redBlue, 16)));
+}
+
+template <bool swap, bool opaque>
+void rgba8888Sse2(uchar *destination, const uchar *source, int width)
+{
+    const __m128i alpha = _mm_set1_epi32(s_opaque);
+    int i = 0;
+    for (; i + 4 <= width; i += 4) {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+        if (swap) {
+            p = swapRedBlueSse2(p);
+        }
+        if (opaque) {
+            p = _mm_or_si128(p, alpha);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), p);
+    }
+    rgba8888Scalar<swap, opaque>(destination + i * 4, source + i * 4, width - i);
+}
+
+inline __m128i rgb565ToRgb32Sse2(__m128i c)
+{
+    const __m128i r = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(c, 8), _mm_set1_epi32(0xf80000)),
+                                   _mm_and_si128(_mm_slli_epi32(c, 3), _mm_set1_epi32(0x70000)));
+    const __m128i g = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(c, 5), _mm_set1_epi32(0xfc00)),
+                                   _mm_and_si128(_mm_srli_epi32(c, 1), _mm_set1_epi32(0x300)));
+    const __m128i b = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(c, 3), _mm_set1_epi32(0xf8)),
+                                   _mm_and_si128(_mm_srli_epi32(c, 2), _mm_set1_epi32(0x7)));
+    return _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, _mm_set1_epi32(s_opaque)));
+}
+
+void rgb565Sse2(uchar *destination, const uchar *source, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 8 <= width; i += 8) {
+        const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), rgb565ToRgb32Sse2(_mm_unpacklo_epi16(p, zero)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4 + 16), rgb565ToRgb32Sse2(_mm_unpackhi_epi16(p, zero)));
+    }
+    rgb565Scalar(destination + i * 4, source + i * 2, width - i);
+}
+
+template <bool bgr, bool opaque>
+void rgb30Sse2(uchar *destination, const uchar *source, int width)
+{
+    const __m128i byte = _mm_set1_epi32(0xff);
+    int i = 0;
+    for (; i + 4 <= width; i += 4) {
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+        __m128i a;
+        if (opaque) {
+            a = _mm_set1_epi32(s_opaque);
+        } else {
+            a = _mm_srli_epi32(c, 30);
+            a = _mm_or_si128(a, _mm_slli_epi32(a, 2));
+            a = _mm_or_si128(a, _mm_slli_epi32(a, 4));
+            a = _mm_slli_epi32(a, 24);
+        }
+        const __m128i g = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(c, 12), byte), 8);
+        __m128i r;
+        __m128i b;
+        if (bgr) {
+            r = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(c, 2), byte), 16);
+            b = _mm_and_si128(_mm_srli_epi32(c, 22), byte);
+        } else {
+            r = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(c, 22), byte), 16);
+            b = _mm_and_si128(_mm_srli_epi32(c, 2), byte);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4),
+                         _mm_or_si128(_mm_or_si128(a, r), _mm_or_si128(g, b)));
+    }
+    rgb30Scalar<bgr, opaque>(destination + i * 4, source + i * 4, width - i);
+}
+
+template <bool swap, bool opaque>
+__attribute__((target("avx2"))) void rgba8888Avx2(uchar *destination, const uchar *source, int width)
+{
+    const __m256i alpha = _mm256_set1_epi32(s_opaque);
+    int i = 0;
+    for (; i + 8 <= width; i += 8) {
+        __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4));
+        if (swap) {
+            p = swapRedBlueAvx2(p);
+        }
+        if (opaque) {
+            p = _mm256_or_si256(p, alpha);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4), p);
+    }
+    rgba8888Scalar<swap, opaque>(destination + i * 4, source + i * 4, width - i);
+}
+
+__attribute__((target("avx2"))) void rgb565Avx2(uchar *destination, const uchar *source, int width)
+{
+    int i = 0;
+    for (; i + 8 <= width; i += 8) {
+        const __m256i c = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2)));
+        const __m256i r = _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi32(c, 8), _mm256_set1_epi32(0xf80000)),
+                                          _mm256_and_si256(_mm256_slli_epi32(c, 3), _mm256_set1_epi32(0x70000)));
+        const __m256i g = _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi32(c, 5), _mm256_set1_epi32(0xfc00)),
+                                          _mm256_and_si256(_mm256_srli_epi32(c, 1), _mm256_set1_epi32(0x300)));
+        const __m256i b = _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi32(c, 3), _mm256_set1_epi32(0xf8)),
+                                          _mm256_and_si256(_mm256_srli_epi32(c, 2), _mm256_set1_epi32(0x7)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4),
+                            _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, _mm256_set1_epi32(s_opaque))));
+    }
+    rgb565Scalar(destination + i * 4, source + i * 2, width - i);
+}
+
+template <bool bgr, bool opaque>
+__attribute__((target("avx2"))) void rgb30Avx2(uchar *destination, const uchar *source, int width)
+{
+    const __m256i byte = _mm256_set1_epi32(0xff);
+    int i = 0;
+    for (; i + 8 <= width; i += 8) {
+        const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4));
+        __m256i a;
+        if (opaque) {
+            a = _mm256_set1_epi32(s_opaque);
+        } else {
+            a = _mm256_srli_epi32(c, 30);
+            a = _mm256_or_si256(a, _mm256_slli_epi32(a, 2));
+            a = _mm256_or_si256(a, _mm256_slli_epi32(a, 4));
+            a = _mm256_slli_epi32(a, 24);
+        }
+        const __m256i g = _mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(c, 12), byte), 8);
+        __m256i r;
+        __m256i b;
+        if (bgr) {
+            r = _mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(c, 2), byte), 16);
+            b = _mm256_and_si256(_mm256_srli_epi32(c, 22), byte);
+        } else {
+            r = _mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(c, 22), byte), 16);
+            b = _mm256_and_si256(_mm256_srli_epi32(c, 2), byte);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4),
+                            _mm256_or_si256(_mm256_or_si256(a, r), _mm256_or_si256(g, b)));
+    }
+    rgb30Scalar<bgr, opaque>(destination + i * 4, source + i * 4, width - i);
+}
+
+template <bool bgr, bool opaque>
+__attribute__((target("avx2,f16c"))) void rgba16fAvx2(uchar *destination, const uchar *source, int width)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 scale = _mm256_set1_ps(255.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m128i redBlue = _mm_set1_epi32(0x00ff00ff);
+    int i = 0;
+    for (; i + 4 <= width; i += 4) {
+        __m128i packed[2];
+        for (int j = 0; j < 2; ++j) {
+            // two pixels with four channels each
+            __m256 f = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 8 + j * 16)));
+            // max returns the second operand for NaN
+            f = _mm256_min_ps(_mm256_max_ps(f, zero), one);
+            const __m256i c = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(f, scale), half));
+            packed[j] = _mm_packus_epi32(_mm256_castsi256_si128(c), _mm256_extracti128_si256(c, 1));
+        }
+        __m128i p = _mm_packus_epi16(packed[0], packed[1]);
+        if (bgr) {
+            const __m128i rb = _mm_and_si128(p, redBlue);
+            p = _mm_or_si128(_mm_andnot_si128(redBlue, p),
+                             _mm_or_si128(_mm_srli_epi32(rb, 16), _mm_slli_epi32(rb, 16)));
+        }
+        if (opaque) {
+            p = _mm_or_si128(p, _mm_set1_epi32(s_opaque));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), p);
+    }
+    rgba16fScalar<bgr, opaque>(destination + i * 4, source + i * 8, width - i);
+}
+
+// multiplies two pixels unpacked to 16 bit per channel with their alpha, (c * a + ((c * a) >> 8) + 0x80) >> 8
+inline __m128i premultiplySse2(__m128i p)
+{
+    const __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(p, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    p = _mm_mullo_epi16(p, alpha);
+    p = _mm_add_epi16(p, _mm_srli_epi16(p, 8));
+    p = _mm_add_epi16(p, _mm_set1_epi16(0x80));
+    return _mm_srli_epi16(p, 8);
+}
+
+template <bool swap, bool premultiply>
+void imageRowSse2(uchar *destination, const uchar *source, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set1_epi32(s_opaque);
+    int i = 0;
+    for (; i + 4 <= width; i += 4) {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+        if (swap) {
+            p = swapRedBlueSse2(p);
+        }
+        if (premultiply) {
+            const __m128i lo = premultiplySse2(_mm_unpacklo_epi8(p, zero));
+            const __m128i hi = premultiplySse2(_mm_unpackhi_epi8(p, zero));
+            // the alpha channel got multiplied with itself
+            p = _mm_or_si128(_mm_andnot_si128(alphaMask, _mm_packus_epi16(lo, hi)), _mm_and_si128(p, alphaMask));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), p);
+    }
+    imageRowScalar<swap, premultiply>(destination + i * 4, source + i * 4, width - i);
+}
+
+__attribute__((target("avx2"))) inline __m256i premultiplyAvx2(__m256i p)
+{
+    const __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(p, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    p = _mm256_mullo_epi16(p, alpha);
+    p = _mm256_add_epi16(p, _mm256_srli_epi16(p, 8));
+    p = _mm256_add_epi16(p, _mm256_set1_epi16(0x80));
+    return _mm256_srli_epi16(p, 8);
+}
+
+template <bool swap, bool premultiply>
+__attribute__((target("avx2"))) void imageRowAvx2(uchar *destination, const uchar *source, int width)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaMask = _mm256_set1_epi32(s_opaque);
+    int i = 0;
+    for (; i + 8 <= width; i += 8) {
+        __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4));
+        if (swap) {
+            p = swapRedBlueAvx2(p);
+        }
+        if (premultiply) {
+            // unpacking and packing work per 128 bit lane, so the pixel order is kept
+            const __m256i lo = premultiplyAvx2(_mm256_unpacklo_epi8(p, zero));
+            const __m256i hi = premultiplyAvx2(_mm256_unpackhi_epi8(p, zero));
+            p = _mm256_or_si256(_mm256_andnot_si256(alphaMask, _mm256_packus_epi16(lo, hi)), _mm256_and_si256(p, alphaMask));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4), p);
+    }
+    imageRowSse2<swap, premultiply>(destination + i * 4, source + i * 4, width - i);
+}
+
+bool cpuSupportsAvx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+}
+
+#endif
+
+#if KWAYLAND_PIXELCONVERTER_NEON
+
+template <bool swap, bool opaque>
+void rgba8888Neon(uchar *destination, const uchar *source, int width)
+{
+    int i = 0;
+    for (; i + 16 <= width; i += 16) {
+        uint8x16x4_t p = vld4q_u8(source + i * 4);
+        if (swap) {
+            const uint8x16_t c = p.val[0];
+            p.val[0] = p.val[2];
+            p.val[2] = c;
+        }
+        if (opaque) {
+            p.val[3] = vdupq_n_u8(0xff);
+        }
+        vst4q_u8(destination + i * 4, p);
+    }
+    rgba8888Scalar<swap, opaque>(destination + i * 4, source + i * 4, width - i);
+}
+
+void rgb565Neon(uchar *destination, const uchar *source, int width)
+{
+    int i = 0;
+    for (; i + 8 <= width; i += 8) {
+        const uint16x8_t c = vld1q_u16(reinterpret_cast<const uint16_t*>(source + i * 2));
+        const uint16x8_t r = vshrq_n_u16(c, 11);
+        const uint16x8_t g = vandq_u16(vshrq_n_u16(c, 5), vdupq_n_u16(0x3f));
+        const uint16x8_t b = vandq_u16(c, vdupq_n_u16(0x1f));
+        uint8x8x4_t p;
+        p.val[0] = vmovn_u16(vorrq_u16(vshlq_n_u16(b, 3), vshrq_n_u16(b, 2)));
+        p.val[1] = vmovn_u16(vorrq_u16(vshlq_n_u16(g, 2), vshrq_n_u16(g, 4)));
+        p.val[2] = vmovn_u16(vorrq_u16(vshlq_n_u16(r, 3), vshrq_n_u16(r, 2)));
+        p.val[3] = vdup_n_u8(0xff);
+        vst4_u8(destination + i * 4, p);
+    }
+    rgb565Scalar(destination + i * 4, source + i * 2, width - i);
+}
+
+template <bool bgr, bool opaque>
+void rgb30Neon(uchar *destination, const uchar *source, int width)
+{
+    const uint32x4_t byte = vdupq_n_u32(0xff);
+    int i = 0;
+    for (; i + 4 <= width; i += 4) {
+        const uint32x4_t c = vld1q_u32(reinterpret_cast<const uint32_t*>(source + i * 4));
+        uint32x4_t a;
+        if (opaque) {
+            a = vdupq_n_u32(s_opaque);
+        } else {
+            a = vshrq_n_u32(c, 30);
+            a = vorrq_u32(a, vshlq_n_u32(a, 2));
+            a = vorrq_u32(a, vshlq_n_u32(a, 4));
+            a = vshlq_n_u32(a, 24);
+        }
+        const uint32x4_t g = vshlq_n_u32(vandq_u32(vshrq_n_u32(c, 12), byte), 8);
+        uint32x4_t r;
+        uint32x4_t b;
+        if (bgr) {
+            r = vshlq_n_u32(vandq_u32(vshrq_n_u32(c, 2), byte), 16);
+            b = vandq_u32(vshrq_n_u32(c, 22), byte);
+        } else {
+            r = vshlq_n_u32(vandq_u32(vshrq_n_u32(c, 22), byte), 16);
+            b = vandq_u32(vshrq_n_u32(c, 2), byte);
+        }
+        vst1q_u32(reinterpret_cast<uint32_t*>(destination + i * 4), vorrq_u32(vorrq_u32(a, r), vorrq_u32(g, b)));
+    }
+    rgb30Scalar<bgr, opaque>(destination + i * 4, source + i * 4, width - i);
+}
+
+template <bool bgr, bool opaque>
+void rgba16fNeon(uchar *destination, const uchar *source, int width)
+{
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    const uint8x8_t swapIndex = bgr ? uint8x8_t{2, 1, 0, 3, 6, 5, 4, 7} : uint8x8_t{0, 1, 2, 3, 4, 5, 6, 7};
+    const uint8x8_t alpha = opaque ? uint8x8_t{0, 0, 0, 0xff, 0, 0, 0, 0xff} : vdup_n_u8(0);
+    int i = 0;
+    for (; i + 2 <= width; i += 2) {
+        // two pixels with four channels each
+        const uint16x8_t h = vld1q_u16(reinterpret_cast<const uint16_t*>(source + i * 8));
+        uint32x4_t c[2];
+        for (int j = 0; j < 2; ++j) {
+            float32x4_t f = vcvt_f32_f16(vreinterpret_f16_u16(j == 0 ? vget_low_u16(h) : vget_high_u16(h)));
+            // maxnm returns the number for NaN
+            f = vminq_f32(vmaxnmq_f32(f, zero), one);
+            c[j] = vcvtq_u32_f32(vaddq_f32(vmulq_n_f32(f, 255.0f), half));
+        }
+        uint8x8_t p = vmovn_u16(vcombine_u16(vmovn_u32(c[0]), vmovn_u32(c[1])));
+        p = vorr_u8(vtbl1_u8(p, swapIndex), alpha);
+        vst1_u8(destination + i * 4, p);
+    }
+    rgba16fScalar<bgr, opaque>(destination + i * 4, source + i * 8, width - i);
+}
+
+inline uint8x8_t premultiplyNeon(uint8x8_t c, uint8x8_t a)
+{
+    const uint16x8_t t = vmull_u8(c, a);
+    return vrshrn_n_u16(vsraq_n_u16(t, t, 8), 8);
+}
+
+inline uint8x16_t premultiplyNeon(uint8x16_t c, uint8x16_t a)
+{
+    return vcombine_u8(premultiplyNeon(vget_low_u8(c), vget_low_u8(a)),
+                       premultiplyNeon(vget_high_u8(c), vget_high_u8(a)));
+}
+
+template <bool swap, bool premultiply>
+void imageRowNeon(uchar *destination, const uchar *source, int width)
+{
+    int i = 0;
+    for (; i + 16 <= width; i += 16) {
+        uint8x16x4_t p = vld4q_u8(source + i * 4);
+        if (swap) {
+            const uint8x16_t c = p.val[0];
+            p.val[0] = p.val[2];
+            p.val[2] = c;
+        }
+        if (premultiply) {
+            p.val[0] = premultiplyNeon(p.val[0], p.val[3]);
+            p.val[1] = premultiplyNeon(p.val[1], p.val[3]);
+            p.val[2] = premultiplyNeon(p.val[2], p.val[3]);
+        }
+        vst4q_u8(destination + i * 4, p);
+    }
+    imageRowScalar<swap, premultiply>(destination + i * 4, source + i * 4, width - i);
+}
+
+#endif
+
+PixelConverter::RowFunction scalarFunction(quint32 format)
+{
+    switch (format) {
+    case Argb8888:
+        return copyScalar;
+    case Xrgb8888:
+        return rgba8888Scalar<false, true>;
+    case Abgr8888:
+        return rgba8888Scalar<true, false>;
+    case Xbgr8888:
+        return rgba8888Scalar<true, true>;
+    case Rgb565:
+        return rgb565Scalar;
+    case Argb2101010:
+        return rgb30Scalar<false, false>;
+    case Xrgb2101010:
+        return rgb30Scalar<false, true>;
+    case Abgr2101010:
+        return rgb30Scalar<true, false>;
+    case Xbgr2101010:
+        return rgb30Scalar<true, true>;
+    case Argb16161616f:
+        return rgba16fScalar<false, false>;
+    case Xrgb16161616f:
+        return rgba16fScalar<false, true>;
+    case Abgr16161616f:
+        return rgba16fScalar<true, false>;
+    case Xbgr16161616f:
+        return rgba16fScalar<true, true>;
+    default:
+        return nullptr;
+    }
+}
+
+PixelConverter::RowFunction vectorFunction(quint32 format, PixelConverter::Implementation implementation)
+{
+    switch (implementation) {
+#if KWAYLAND_PIXELCONVERTER_X86
+    case PixelConverter::Implementation::Sse2:
+        switch (format) {
+        case Xrgb8888:
+            return rgba8888Sse2<false, true>;
+        case Abgr8888:
+            return rgba8888Sse2<true, false>;
+        case Xbgr8888:
+            return rgba8888Sse2<true, true>;
+        case Rgb565:
+            return rgb565Sse2;
+        case Argb2101010:
+            return rgb30Sse2<false, false>;
+        case Xrgb2101010:
+            return rgb30Sse2<false, true>;
+        case Abgr2101010:
+            return rgb30Sse2<true, false>;
+        case Xbgr2101010:
+            return rgb30Sse2<true, true>;
+        default:
+            // no half float conversion in SSE2
+            return nullptr;
+        }
+    case PixelConverter::Implementation::Avx2:
+        switch (format) {
+        case Xrgb8888:
+            return rgba8888Avx2<false, true>;
+        case Abgr8888:
+            return rgba8888Avx2<true, false>;
+        case Xbgr8888:
+            return rgba8888Avx2<true, true>;
+        case Rgb565:
+            return rgb565Avx2;
+        case Argb2101010:
+            return rgb30Avx2<false, false>;
+        case Xrgb2101010:
+            return rgb30Avx2<false, true>;
+        case Abgr2101010:
+            return rgb30Avx2<true, false>;
+        case Xbgr2101010:
+            return rgb30Avx2<true, true>;
+        case Argb16161616f:
+            return rgba16fAvx2<false, false>;
+        case Xrgb16161616f:
+            return rgba16fAvx2<false, true>;
+        case Abgr16161616f:
+            return rgba16fAvx2<true, false>;
+        case Xbgr16161616f:
+            return rgba16fAvx2<true, true>;
+        default:
+            return nullptr;
+        }
+#endif
+#if KWAYLAND_PIXELCONVERTER_NEON
+    case PixelConverter::Implementation::Neon:
+        switch (format) {
+        case Xrgb8888:
+            return rgba8888Neon<false, true>;
+        case Abgr8888:
+            return rgba8888Neon<true, false>;
+        case Xbgr8888:
+            return rgba8888Neon<true, true>;
+        case Rgb565:
+            return rgb565Neon;
+        case Argb2101010:
+            return rgb30Neon<false, false>;
+        case Xrgb2101010:
+            return rgb30Neon<false, true>;
+        case Abgr2101010:
+            return rgb30Neon<true, false>;
+        case Xbgr2101010:
+            return rgb30Neon<true, true>;
+        case Argb16161616f:
+            return rgba16fNeon<false, false>;
+        case Xrgb16161616f:
+            return rgba16fNeon<false, true>;
+        case Abgr16161616f:
+            return rgba16fNeon<true, false>;
+        case Xbgr16161616f:
+            return rgba16fNeon<true, true>;
+        default:
+            return nullptr;
+        }
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+#define KWAYLAND_IMAGE_ROW_FUNCTIONS(name) \
+    switch (format) { \
+    case QImage::Format_ARGB32: \
+        return name<false, true>; \
+    case QImage::Format_RGBA8888: \
+        return name<true, true>; \
+    case QImage::Format_RGBA8888_Premultiplied: \
+    case QImage::Format_RGBX8888: \
+        return name<true, false>; \
+    default: \
+        return nullptr; \
+    }
+
+PixelConverter::RowFunction imageRowFunction(QImage::Format format, PixelConverter::Implementation implementation)
+{
+    switch (format) {
+    case QImage::Format_ARGB32_Premultiplied:
+    case QImage::Format_RGB32:
+        return copyScalar;
+    default:
+        break;
+    }
+    switch (implementation) {
+#if KWAYLAND_PIXELCONVERTER_X86
+    case PixelConverter::Implementation::Sse2:
+        KWAYLAND_IMAGE_ROW_FUNCTIONS(imageRowSse2)
+    case PixelConverter::Implementation::Avx2:
+        KWAYLAND_IMAGE_ROW_FUNCTIONS(imageRowAvx2)
+#endif
+#if KWAYLAND_PIXELCONVERTER_NEON
+    case PixelConverter::Implementation::Neon:
+        KWAYLAND_IMAGE_ROW_FUNCTIONS(imageRowNeon)
+#endif
+    default:
+        KWAYLAND_IMAGE_ROW_FUNCTIONS(imageRowScalar)
+    }
+}
+
+#undef KWAYLAND_IMAGE_ROW_FUNCTIONS
+
+}
+
+PixelConverter::PixelConverter(quint32 format, Implementation implementation)
+    : m_format(format)
+{
+    switch (format) {
+    case Argb8888:
+    case Abgr8888:
+    case Argb2101010:
+    case Abgr2101010:
+        m_alpha = true;
+        m_bytesPerPixel = 4;
+        break;
+    case Xrgb8888:
+    case Xbgr8888:
+    case Xrgb2101010:
+    case Xbgr2101010:
+        m_bytesPerPixel = 4;
+        break;
+    case Rgb565:
+        m_bytesPerPixel = 2;
+        break;
+    case Argb16161616f:
+    case Abgr16161616f:
+        m_alpha = true;
+        m_bytesPerPixel = 8;
+        break;
+    case Xrgb16161616f:
+    case Xbgr16161616f:
+        m_bytesPerPixel = 8;
+        break;
+    default:
+        // not supported
+        return;
+    }
+    if (implementation != Implementation::Scalar) {
+        m_function = vectorFunction(format, implementation);
+    }
+    if (!m_function) {
+        // not vectorized in the implementation, e.g. a plain copy
+        m_function = scalarFunction(format);
+    }
+    m_imageFormat = m_alpha ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+}
+
+PixelConverter::PixelConverter(QImage::Format imageFormat, Implementation implementation)
+    : m_function(imageRowFunction(imageFormat, implementation))
+{
+    if (!m_function) {
+        // not supported
+        return;
+    }
+    m_format = Argb8888;
+    m_imageFormat = imageFormat;
+    m_bytesPerPixel = 4;
+    m_alpha = true;
+}
+
+QVector<PixelConverter::Implementation> PixelConverter::supportedImplementations()
+{
+    QVector<Implementation> implementations{Implementation::Scalar};
+#if KWAYLAND_PIXELCONVERTER_X86
+    implementations << Implementation::Sse2;
+    if (cpuSupportsAvx2()) {
+        implementations << Implementation::Avx2;
+    }
+#endif
+#if KWAYLAND_PIXELCONVERTER_NEON
+    implementations << Implementation::Neon;
+#endif
+    return implementations;
+}
+
+PixelConverter::Implementation PixelConverter::bestImplementation()
+{
+    static const Implementation best = supportedImplementations().last();
+    return best;
+}
+
+}
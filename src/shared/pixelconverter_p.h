@@ -0,0 +1,135 @@
+/********************************************************************
+Copyright 2020  agent <agent@local>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) version 3, or any
+later version accepted by the membership of KDE e.V. (or its
+successor approved by the membership of KDE e.V.), which shall
+act as a proxy defined in Section 6 of version 3 of the license.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#ifndef WAYLAND_PIXELCONVERTER_P_H
+#define WAYLAND_PIXELCONVERTER_P_H
+
+#include <QImage>
+#include <QVector>
+
+namespace KWayland
+{
+
+/**
+ * @brief Converts rows of pixels between the wl_shm formats and the 32-bit QImage layouts.
+ *
+ * The server converts wl_shm pixels into the canonical 32-bit layouts: formats with an
+ * alpha channel into QImage::Format_ARGB32_Premultiplied, all other formats into
+ * QImage::Format_RGB32. As all wl_shm formats are premultiplied no (un)premultiplication
+ * is performed in this direction.
+ *
+ * The client converts QImage pixels into WL_SHM_FORMAT_ARGB8888, which has the layout of
+ * QImage::Format_ARGB32_Premultiplied. Non-premultiplied sources get premultiplied with
+ * the same rounding as qPremultiply.
+ *
+ * The conversion is performed by vectorized kernels if the CPU supports it, the best
+ * Implementation is selected at runtime. Each row is converted independently, which
+ * allows to only convert the damaged parts of a buffer.
+ *
+ * The source is compiled into both the client and the server library.
+ *
+ * @internal
+ **/
+class PixelConverter
+{
+public:
+    enum class Implementation {
+        Scalar,
+        Sse2,
+        Avx2,
+        Neon
+    };
+    /**
+     * Converts @p width pixels from @p source into @p destination.
+     **/
+    typedef void (*RowFunction)(uchar *destination, const uchar *source, int width);
+
+    /**
+     * Creates an invalid PixelConverter.
+     **/
+    PixelConverter() = default;
+    /**
+     * Creates a PixelConverter from the wl_shm @p format into imageFormat.
+     **/
+    explicit PixelConverter(quint32 format, Implementation implementation = bestImplementation());
+    /**
+     * Creates a PixelConverter from the 32-bit QImage @p imageFormat into WL_SHM_FORMAT_ARGB8888.
+     **/
+    explicit PixelConverter(QImage::Format imageFormat, Implementation implementation = bestImplementation());
+
+    /**
+     * @returns whether the format passed to the constructor is supported
+     **/
+    bool isValid() const {
+        return m_function != nullptr;
+    }
+    /**
+     * @returns the wl_shm format the pixels get converted from or into
+     **/
+    quint32 format() const {
+        return m_format;
+    }
+    /**
+     * @returns the number of bytes of one pixel in the source format, @c 0 if not supported
+     **/
+    int bytesPerPixel() const {
+        return m_bytesPerPixel;
+    }
+    /**
+     * @returns whether format has an alpha channel
+     **/
+    bool hasAlphaChannel() const {
+        return m_alpha;
+    }
+    /**
+     * @returns the QImage::Format the pixels get converted into or from,
+     * QImage::Format_Invalid if not supported
+     **/
+    QImage::Format imageFormat() const {
+        return m_imageFormat;
+    }
+
+    /**
+     * Converts @p width pixels of the row @p source into @p destination.
+     * The converter must be valid.
+     **/
+    void convertRow(uchar *destination, const uchar *source, int width) const {
+        m_function(destination, source, width);
+    }
+
+    /**
+     * @returns the fastest Implementation supported by the CPU
+     **/
+    static Implementation bestImplementation();
+    /**
+     * @returns all Implementations supported by the CPU
+     **/
+    static QVector<Implementation> supportedImplementations();
+
+private:
+    quint32 m_format = 0;
+    QImage::Format m_imageFormat = QImage::Format_Invalid;
+    int m_bytesPerPixel = 0;
+    bool m_alpha = false;
+    RowFunction m_function = nullptr;
+};
+
+}
+
+#endif